@@ -10,12 +10,15 @@
 
 #pragma once
 
+#include <condition_variable>
 #include <csignal>
 #include <memory>
 #include <mutex>
 #include <string>
 #include <vector>
 
+#include <boost/noncopyable.hpp>
+
 #include <osquery/status.h>
 
 // clang-format off
@@ -185,4 +188,85 @@ using RecursiveMutex = std::recursive_mutex;
 
 /// Helper alias for write locking a recursive mutex.
 using RecursiveLock = std::lock_guard<std::recursive_mutex>;
+
+/**
+ * @brief A read-mostly mutex, held by many readers or a single writer.
+ *
+ * C++11 has no shared mutex, and boost's requires linking boost_thread. A
+ * waiting writer blocks new readers such that writers are not starved.
+ */
+class ReadWriteMutex : private boost::noncopyable {
+ public:
+  /// Take the mutex exclusively.
+  void lock() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    writers_waiting_++;
+    released_.wait(lock, [this]() { return !writer_ && readers_ == 0; });
+    writers_waiting_--;
+    writer_ = true;
+  }
+
+  /// Release an exclusive hold.
+  void unlock() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      writer_ = false;
+    }
+    released_.notify_all();
+  }
+
+  /// Take the mutex shared with other readers.
+  void lock_shared() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    released_.wait(lock,
+                   [this]() { return !writer_ && writers_waiting_ == 0; });
+    readers_++;
+  }
+
+  /// Release a shared hold.
+  void unlock_shared() {
+    bool last = false;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      last = (--readers_ == 0);
+    }
+    if (last) {
+      released_.notify_all();
+    }
+  }
+
+ private:
+  /// Protects the hold state.
+  std::mutex mutex_;
+
+  /// Signaled when a hold is released.
+  std::condition_variable released_;
+
+  /// Number of shared holds.
+  size_t readers_{0};
+
+  /// Number of threads waiting for an exclusive hold.
+  size_t writers_waiting_{0};
+
+  /// True while held exclusively.
+  bool writer_{false};
+};
+
+/// Helper for shared (read) locking a read-mostly mutex.
+class ReadLock : private boost::noncopyable {
+ public:
+  explicit ReadLock(ReadWriteMutex& mutex) : mutex_(mutex) {
+    mutex_.lock_shared();
+  }
+
+  ~ReadLock() {
+    mutex_.unlock_shared();
+  }
+
+ private:
+  ReadWriteMutex& mutex_;
+};
+
+/// Helper alias for exclusive (write) locking a read-mostly mutex.
+using ExclusiveLock = std::lock_guard<ReadWriteMutex>;
 }
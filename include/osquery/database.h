@@ -397,6 +397,9 @@ Status serializeQueryLogItemAsEvents(const QueryLogItem& item,
 Status serializeQueryLogItemAsEventsJSON(const QueryLogItem& i,
                                          std::vector<std::string>& items);
 
+/// A list of database keys and their values.
+using DatabaseValues = std::vector<std::pair<std::string, std::string>>;
+
 /**
  * @brief An osquery backing storage (database) type that persists executions.
  *
@@ -454,6 +457,54 @@ class DatabasePlugin : public Plugin {
     return Status(0, "Not used");
   }
 
+  /**
+   * @brief Lookup several keys within a domain.
+   *
+   * The default implementation performs a get for each key. Plugins with a
+   * batched read should override this method.
+   *
+   * @param domain A string value representing abstract storage indexing.
+   * @param keys The lookup/retrieval keys.
+   * @param values Output, the key and value of each key that exists, in the
+   * order of keys.
+   * @return Failure if the data could not be accessed.
+   */
+  virtual Status getMany(const std::string& domain,
+                         const std::vector<std::string>& keys,
+                         DatabaseValues& values) const;
+
+  /**
+   * @brief Store several values within a domain.
+   *
+   * The default implementation performs a put for each value. Plugins with a
+   * batched write should override this method and write all values at once.
+   */
+  virtual Status putMany(const std::string& domain,
+                         const DatabaseValues& values);
+
+  /**
+   * @brief Scan the keys beginning with a prefix and their values.
+   *
+   * The default implementation performs a get for each scanned key.
+   */
+  virtual Status scanValues(const std::string& domain,
+                            DatabaseValues& results,
+                            const std::string& prefix,
+                            size_t max = 0) const;
+
+  /**
+   * @brief Report statistics about the backing store.
+   *
+   * Plugins may report store-wide counters and per-domain properties, such as
+   * the RocksDB statistics tickers and compaction state.
+   *
+   * @param results Output, a row for each statistic with a "domain", empty
+   * for store-wide statistics, a "name", and an integer "value".
+   */
+  virtual Status stats(QueryData& results) const {
+    return Status(0, "Not used");
+  }
+
   /**
    * @brief Shutdown the database and release initialization resources.
    *
@@ -569,6 +620,34 @@ Status scanDatabaseKeys(const std::string& domain,
                         const std::string& prefix,
                         size_t max = 0);
 
+/**
+ * @brief Lookup several values from the active DatabasePlugin storage.
+ *
+ * Extensions should prefer the bulk database accessors, each is a single
+ * call to the extension manager.
+ *
+ * @param domain A string value representing abstract storage indexing.
+ * @param keys The lookup/retrieval keys.
+ * @param values Output, the key and value of each key that exists.
+ * @return Storage operation status.
+ */
+Status getDatabaseValues(const std::string& domain,
+                         const std::vector<std::string>& keys,
+                         DatabaseValues& values);
+
+/// Set or put several values into the active DatabasePlugin storage.
+Status setDatabaseValues(const std::string& domain,
+                         const DatabaseValues& values);
+
+/// Get the keys with a prefix and their values for a given domain.
+Status scanDatabaseValues(const std::string& domain,
+                          DatabaseValues& values,
+                          const std::string& prefix,
+                          size_t max = 0);
+
+/// Get the statistics reported by the active DatabasePlugin.
+Status getDatabaseStats(QueryData& results);
+
 /// Allow callers to scan each column family and print each value.
 void dumpDatabase();
 }
@@ -322,6 +322,31 @@ class EventPublisherPlugin : public Plugin,
     return restart_count_;
   }
 
+  /// Get the number of times the OS event source overflowed, losing events.
+  size_t overflowCount() const {
+    return overflow_count_;
+  }
+
+  /// Get the number of repeated events merged before they were fired.
+  size_t coalescedCount() const {
+    return coalesced_count_;
+  }
+
+  /// Get the events received in the last second, if the publisher measures it.
+  virtual size_t eventsPerSecond() const {
+    return 0;
+  }
+
+  /// Check if the publisher is serviced by a shared reactor, not a thread.
+  bool hasReactor() const {
+    return reactor_;
+  }
+
+  /// Set when the publisher's descriptors were added to a shared reactor.
+  void hasReactor(bool reactor) {
+    reactor_ = reactor;
+  }
+
  public:
   explicit EventPublisherPlugin(EventPublisherPlugin const&) = delete;
   EventPublisherPlugin& operator=(EventPublisherPlugin const&) = delete;
@@ -349,6 +374,12 @@ class EventPublisherPlugin : public Plugin,
   /// This is not used to store event date in the backing store.
   std::atomic<EventContextID> next_ec_id_{0};
 
+  /// Publishers count OS event queue overflows (lost events) here.
+  std::atomic<size_t> overflow_count_{0};
+
+  /// Publishers count events merged into a previous event here.
+  std::atomic<size_t> coalesced_count_{0};
+
  private:
   /// Set ending to True to cause event type run loops to finish.
   std::atomic<bool> ending_{false};
@@ -356,6 +387,9 @@ class EventPublisherPlugin : public Plugin,
   /// Set to indicate whether the event run loop ever started.
   std::atomic<bool> started_{false};
 
+  /// Set if a shared reactor calls into the publisher instead of a run loop.
+  std::atomic<bool> reactor_{false};
+
   /// A lock for incrementing the next EventContextID.
   std::mutex ec_id_lock_;
 
@@ -611,6 +645,9 @@ class EventSubscriberPlugin : public Plugin, public Eventer {
   /// Events before the expire_time_ are invalid and will be purged.
   EventTime expire_time_{0};
 
+  /// The last EID expired but left for the backing store to drop.
+  size_t expire_eid_{0};
+
   /// Cached value of last generated EventID.
   size_t last_eid_{0};
 
@@ -10,6 +10,8 @@
 
 #pragma once
 
+#include <boost/noncopyable.hpp>
+
 #include <osquery/core.h>
 #include <osquery/flags.h>
 #include <osquery/sql.h>
@@ -38,6 +40,61 @@ struct ExtensionInfo {
 
 typedef std::map<RouteUUID, ExtensionInfo> ExtensionList;
 
+/// Upper bounds, in microseconds, of the extension call latency buckets.
+extern const std::vector<size_t> kExtensionLatencyBuckets;
+
+/**
+ * @brief Counters for the calls made to an extension socket.
+ *
+ * The latency histogram has a bucket for each kExtensionLatencyBuckets bound
+ * and a final bucket for slower calls.
+ */
+struct ExtensionCallStats {
+  /// Calls completed, including calls that returned a failed status.
+  size_t calls{0};
+
+  /// Calls that could not be sent or whose response could not be read.
+  size_t failures{0};
+
+  /// Pooled connections found closed by the extension and replaced.
+  size_t reconnects{0};
+
+  /// Connections currently pooled for reuse.
+  size_t idle{0};
+
+  /// Number of calls within each latency bucket.
+  std::vector<size_t> latency;
+
+  /// The upper bound (microseconds) of the bucket containing a percentile.
+  size_t percentile(double p) const;
+};
+
+/// Get the call counters for an extension socket path.
+Status getExtensionCallStats(const std::string& path,
+                             ExtensionCallStats& stats);
+
+/// Counters for the requests an ExtensionManager served for an extension.
+struct ExtensionServerStats {
+  /// Requests dispatched to the ExtensionManager handler.
+  size_t requests{0};
+
+  /// Requests delayed because the extension exceeded its request quota.
+  size_t throttled{0};
+
+  /// Total time (microseconds) requests waited for a dispatch worker.
+  size_t wait{0};
+
+  /// The most requests waiting for a dispatch worker at once.
+  size_t max_queued{0};
+};
+
+/**
+ * @brief Get the counters for requests an extension sent to this manager.
+ *
+ * The core UUID (0) returns the totals for every extension.
+ */
+Status getExtensionServerStats(RouteUUID uuid, ExtensionServerStats& stats);
+
 inline std::string getExtensionSocket(
     RouteUUID uuid, const std::string& path = FLAGS_extensions_socket) {
   return (uuid == 0) ? path : path + "." + std::to_string(uuid);
@@ -149,6 +206,72 @@ Status callExtension(const std::string& extension_path,
                      const PluginRequest& request,
                      PluginResponse& response);
 
+/**
+ * @brief Read the rows of a table provided by an extension in batches.
+ *
+ * Instead of a single "generate" response holding every row, the extension
+ * returns a column-oriented batch per call. The SQLite virtual table reads the
+ * next batch when its cursor reaches the end of the current batch. Destroying
+ * the cursor before the last batch, such as when a LIMIT is satisfied, asks
+ * the extension to discard the remaining rows.
+ *
+ * Extensions built with an older SDK do not support table cursors, open fails
+ * and the table should be generated using callTable.
+ */
+class ExtensionTableCursor : private boost::noncopyable {
+ public:
+  explicit ExtensionTableCursor(const std::string& table) : table_(table) {}
+
+  /// Close the extension's cursor if rows remain.
+  ~ExtensionTableCursor();
+
+  /**
+   * @brief Generate the table within its extension and read the first batch.
+   *
+   * @param context The query context, sent with the generate request.
+   * @param rows Output, the first batch of rows.
+   * @return failure if the table is not provided by a cursor-capable extension
+   * (see unsupported) or the extension could not generate the table.
+   */
+  Status open(QueryContext& context, QueryData& rows);
+
+  /// Replace rows with the next batch, rows is empty after the last batch.
+  Status next(QueryData& rows);
+
+  /// Check if every batch has been read.
+  bool done() const {
+    return done_;
+  }
+
+  /// Check if open failed because the extension cannot read in batches.
+  bool unsupported() const {
+    return unsupported_;
+  }
+
+  /// Check if a table is provided by an extension that may read in batches.
+  static bool enabled(const std::string& table);
+
+ private:
+  /// Find the extension providing a table, 0 if it cannot read in batches.
+  static RouteUUID route(const std::string& table);
+
+ private:
+  /// The table name.
+  std::string table_;
+
+  /// The socket path of the extension providing the table.
+  std::string path_;
+
+  /// The extension's cursor, valid until done.
+  int64_t cursor_{0};
+
+  /// Set when there are no more batches.
+  bool done_{true};
+
+  /// Set when open failed because batches are not supported.
+  bool unsupported_{false};
+};
+
 /// The main runloop entered by an Extension, start an ExtensionRunner thread.
 Status startExtension(const std::string& name, const std::string& version);
 
@@ -10,13 +10,19 @@
 
 #pragma once
 
+#include <sys/stat.h>
+
+#include <functional>
 #include <map>
+#include <memory>
 #include <set>
 #include <string>
 #include <vector>
 
 #include <boost/filesystem/path.hpp>
+#include <boost/noncopyable.hpp>
 #include <boost/property_tree/ptree.hpp>
+#include <boost/utility/string_ref.hpp>
 
 #include <osquery/status.h>
 
@@ -295,6 +301,21 @@ Status parsePlistContent(const std::string& content,
 #endif
 
 #ifdef __linux__
+/**
+ * @brief Call a predicate for each entry name in an open directory.
+ *
+ * This reads with getdents64 into a caller-provided buffer, avoiding the stat
+ * and path allocations of a boost directory_iterator. The "." and ".."
+ * entries are not reported.
+ *
+ * @param dir_fd an open directory descriptor, the caller closes it.
+ * @param buffer a reusable buffer for directory reads.
+ * @param predicate called with each name, return false to stop iterating.
+ */
+void forEachDirent(int dir_fd,
+                   std::vector<char>& buffer,
+                   std::function<bool(const char* name)> predicate);
+
 /**
  * @brief Iterate over `/proc` process, returns a list of pids.
  *
@@ -328,6 +349,115 @@ Status procReadDescriptor(const std::string& process,
                           const std::string& descriptor,
                           std::string& result);
 
+/**
+ * @brief An index of every process's descriptors from a single `/proc` walk.
+ *
+ * The process_open_sockets, process_open_files, and listening_ports tables
+ * each need the descriptors of all processes. The index is built once using
+ * directory descriptors (getdents64 and readlinkat) and shared between the
+ * tables for a short time, see procDescriptorIndex.
+ */
+struct ProcDescriptorIndex {
+  /// Process pid to each descriptor number and link target.
+  std::map<std::string, std::vector<std::pair<std::string, std::string>>>
+      descriptors;
+
+  /// Socket inode to the descriptor number and owning pid.
+  std::map<std::string, std::pair<std::string, std::string>> sockets;
+};
+
+/**
+ * @brief Return an index of the descriptors for all processes.
+ *
+ * An index built within the last `--proc_index_ttl` milliseconds is returned
+ * such that tables scanned within the same schedule step share a `/proc` walk.
+ *
+ * @return A shared, read-only, descriptor index.
+ */
+std::shared_ptr<const ProcDescriptorIndex> procDescriptorIndex();
+
+/// A view of procfs content, valid until the reading thread's next read.
+using ProcView = boost::string_ref;
+
+/**
+ * @brief An open `/proc/<pid>` directory for reading process attributes.
+ *
+ * Attributes are opened relative to the process directory and read with
+ * pread into a thread-local buffer that is reused between reads. Reading an
+ * attribute does not build paths, probe file sizes, or allocate per chunk.
+ * Content is returned as a view and parsed in place with procTokens.
+ */
+class ProcessDirectory : private boost::noncopyable {
+ public:
+  /// Open the `/proc` directory of a process.
+  explicit ProcessDirectory(const std::string& pid);
+
+  ~ProcessDirectory();
+
+  /// Check if the process directory is open.
+  bool isValid() const {
+    return fd_ >= 0;
+  }
+
+  /**
+   * @brief Read a process attribute, such as "stat" or "cmdline".
+   *
+   * @param attr the attribute's name within the process directory.
+   * @param content output view, valid until this thread's next read.
+   * @return failure if the attribute could not be opened or read.
+   */
+  Status read(const char* attr, ProcView& content) const;
+
+  /// Read the target of a process attribute link, such as "exe" or "cwd".
+  Status readLink(const char* attr, std::string& target) const;
+
+  /// Stat a process attribute, following links, such as "exe".
+  Status stat(const char* attr, struct stat& info) const;
+
+ private:
+  /// The process directory descriptor.
+  int fd_{-1};
+};
+
+/**
+ * @brief Call a predicate for each token within procfs content.
+ *
+ * Tokens are split on any of the delimiters and trimmed of whitespace and
+ * nul characters; empty tokens are skipped. Tokens are views into the content.
+ *
+ * @param content procfs content, usually from ProcessDirectory::read.
+ * @param delims the delimiter characters.
+ * @param predicate called with each token, return false to stop.
+ */
+template <typename Predicate>
+void procTokens(ProcView content, ProcView delims, Predicate predicate) {
+  auto is_space = [](char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\0';
+  };
+
+  size_t start = 0;
+  while (start <= content.size()) {
+    size_t end = start;
+    while (end < content.size() &&
+           delims.find(content[end]) == ProcView::npos) {
+      end++;
+    }
+
+    auto first = start;
+    auto last = end;
+    while (first < last && is_space(content[first])) {
+      first++;
+    }
+    while (last > first && is_space(content[last - 1])) {
+      last--;
+    }
+    if (last > first && !predicate(content.substr(first, last - first))) {
+      return;
+    }
+    start = end + 1;
+  }
+}
+
 /**
  * @brief Read bytes from Linux's raw memory.
  *
@@ -13,6 +13,7 @@
 #include <boost/noncopyable.hpp>
 
 #include <string>
+#include <vector>
 
 namespace osquery {
 
@@ -123,4 +124,21 @@ std::string hashFromFile(HashType hash_type, const std::string& path);
 
 /// Get multiple hashes from a file simultaneously.
 MultiHashes hashMultiFromFile(int mask, const std::string& path);
+
+/**
+ * @brief Get multiple hashes from several files, hashing files concurrently.
+ *
+ * Files are hashed by up to `--hash_threads` threads, and the kernel is
+ * advised to read ahead the next file while the current is hashed.
+ *
+ * Files that would exceed the byte budget are not hashed, their results have
+ * a 0 mask and empty digests.
+ *
+ * @param mask The osquery-supported hash algorithms.
+ * @param paths Filesystem paths, the hash targets.
+ * @param max_bytes Budget of file bytes to hash, `--hash_query_max` if 0.
+ * @return The hashes of each path, in the order of paths.
+ */
+std::vector<MultiHashes> hashMultiFromFiles(
+    int mask, const std::vector<std::string>& paths, size_t max_bytes = 0);
 }
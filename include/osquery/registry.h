@@ -550,6 +550,7 @@ class RegistryHelper : public RegistryHelperCore {
  private:
   FRIEND_TEST(EventsTests, test_event_subscriber_configure);
   FRIEND_TEST(VirtualTableTests, test_indexing_costs);
+  FRIEND_TEST(VirtualTableTests, test_shared_scans);
 };
 
 /// Helper definition for a shared pointer to a Plugin.
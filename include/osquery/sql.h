@@ -10,7 +10,9 @@
 
 #pragma once
 
+#include <chrono>
 #include <map>
+#include <set>
 #include <string>
 #include <vector>
 
@@ -21,6 +23,7 @@
 namespace osquery {
 
 DECLARE_int32(value_max);
+DECLARE_uint64(query_profiles);
 
 /**
  * @brief The core interface to executing osquery SQL commands.
@@ -204,5 +207,157 @@ Status query(const std::string& query, QueryData& results);
  */
 Status getQueryColumns(const std::string& q, TableColumns& columns);
 
+/**
+ * @brief The cost of a virtual table within a profiled query execution.
+ *
+ * Cursors opened on the same table within an execution, such as both sides
+ * of a self-JOIN, are accumulated into a single TableProfile.
+ */
+struct TableProfile {
+  /// The virtual table name.
+  std::string table;
+
+  /// Number of filter (scan) requests SQLite made of the table.
+  size_t filters{0};
+
+  /// Number of rows the table generated for those requests.
+  size_t rows{0};
+
+  /// Microseconds spent generating rows, including extension batches.
+  uint64_t time{0};
+
+  /// The 'column operator' constraints provided to the table's filters.
+  std::set<std::string> constraints;
+};
+
+/**
+ * @brief Timing and row counts for a single query execution.
+ *
+ * Rows generated by each table (TableProfile::rows) may be compared with the
+ * rows SQLite returned to find tables that generate data the query discards.
+ */
+struct QueryProfile {
+  /// A process-unique identifier of the execution.
+  size_t id{0};
+
+  /// The scheduled query name, empty for queries run in the shell.
+  std::string name;
+
+  /// The query text.
+  std::string query;
+
+  /// UNIX time in seconds the execution started.
+  size_t time{0};
+
+  /// Microseconds from the start to the end of the execution.
+  uint64_t wall_time{0};
+
+  /// Number of rows returned by SQLite.
+  size_t rows{0};
+
+  /// Microseconds spent escaping and serializing results.
+  uint64_t serialize_time{0};
+
+  /// Microseconds spent storing results and computing the differential.
+  uint64_t diff_time{0};
+
+  /// Microseconds spent forwarding results to the logger plugins.
+  uint64_t log_time{0};
+
+  /// The virtual tables scanned, in the order they were first filtered.
+  std::vector<TableProfile> tables;
+};
+
+/// The non-SQL phases of a scheduled query execution.
+enum class QueryPhase {
+  SERIALIZE,
+  DIFF,
+  LOG,
+};
+
+/**
+ * @brief Record structured profiles of query executions.
+ *
+ * A profile is started and finished by the thread executing a query. While a
+ * profile is active the virtual table module records each table scan, and
+ * the scheduler and logger record the phases following the SQL execution.
+ *
+ * Nested starts within an active profile are accumulated into the outer
+ * profile. When `--query_profiles` is set the most recently finished
+ * profiles are kept and reported by the osquery_query_profile table.
+ */
+class QueryProfiler {
+ public:
+  /// Check if the daemon should profile scheduled queries.
+  static bool enabled();
+
+  /// Check if the calling thread has an active profile.
+  static bool active();
+
+  /// Start a profile for the calling thread.
+  static void start(const std::string& name, const std::string& query);
+
+  /**
+   * @brief Finish the calling thread's profile.
+   *
+   * @param profile Output, the finished profile.
+   * @return true if this finished the outermost (non-nested) profile.
+   */
+  static bool finish(QueryProfile& profile);
+
+  /// Record the rows returned by SQLite.
+  static void recordRows(size_t rows);
+
+  /**
+   * @brief Record rows generated by a virtual table.
+   *
+   * @param table The virtual table name.
+   * @param constraints The constraints of a filter, if this is a filter.
+   * @param rows The number of rows generated.
+   * @param time The microseconds spent generating rows.
+   * @param filter True if the rows were generated by a filter request.
+   */
+  static void recordScan(const std::string& table,
+                         const std::set<std::string>& constraints,
+                         size_t rows,
+                         uint64_t time,
+                         bool filter);
+
+  /// Record time spent within a phase following the SQL execution.
+  static void recordPhase(QueryPhase phase, uint64_t time);
+
+  /// Copy the most recently finished profiles, oldest first.
+  static std::vector<QueryProfile> history();
+
+  /// Microseconds since an arbitrary epoch, for measuring durations.
+  static uint64_t now() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+  }
+};
+
+/// Record the time until the end of a scope as a QueryPhase, if profiling.
+class QueryPhaseTimer {
+ public:
+  explicit QueryPhaseTimer(QueryPhase phase)
+      : phase_(phase), active_(QueryProfiler::active()) {
+    if (active_) {
+      start_ = QueryProfiler::now();
+    }
+  }
+
+  ~QueryPhaseTimer() {
+    if (active_) {
+      QueryProfiler::recordPhase(phase_, QueryProfiler::now() - start_);
+    }
+  }
+
+ private:
+  QueryPhase phase_;
+  bool active_{false};
+  uint64_t start_{0};
+};
+
 CREATE_LAZY_REGISTRY(SQLPlugin, "sql");
 }
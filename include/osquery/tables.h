@@ -15,9 +15,11 @@
 #include <memory>
 #include <set>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #include <boost/lexical_cast.hpp>
+#include <boost/optional.hpp>
 #include <boost/property_tree/ptree.hpp>
 
 #include <osquery/core.h>
@@ -249,6 +251,9 @@ enum class TableAttributes {
 
   /// This table's data requires an osquery kernel extension/module.
   KERNEL_REQUIRED = 16,
+
+  /// The results must be fresh and are never shared between queries.
+  VOLATILE = 32,
 };
 
 /// Treat table attributes as a set of flags.
@@ -437,6 +442,9 @@ using ConstraintMap = std::map<std::string, struct ConstraintList>;
 /// Populate a constraint list from a query's parsed predicate.
 using ConstraintSet = std::vector<std::pair<std::string, struct Constraint>>;
 
+/// The names of the columns a query reads from a table.
+using UsedColumns = std::unordered_set<std::string>;
+
 /**
  * @brief osquery table content descriptor.
  *
@@ -474,6 +482,9 @@ struct VirtualTableContent {
   /// Transient set of virtual table access constraints.
   std::unordered_map<size_t, ConstraintSet> constraints;
 
+  /// Transient set of the columns used by each constraint set's query plan.
+  std::unordered_map<size_t, UsedColumns> used_columns;
+
   /*
    * @brief A table implementation specific query result cache.
    *
@@ -594,6 +605,26 @@ struct QueryContext : private boost::noncopyable {
       std::function<Status(const std::string& constraint,
                            std::set<std::string>& output)> predicate);
 
+  /**
+   * @brief Check if the query reads a column.
+   *
+   * Tables may skip generating expensive columns the query does not use. If
+   * the used columns are not known, such as for an extension table request,
+   * every column is used.
+   *
+   * @param column The name of a column within this table.
+   * @return true if the query selects, filters, or otherwise reads the column.
+   */
+  bool isColumnUsed(const std::string& column) const;
+
+  /// Check if the query reads any of the columns.
+  bool isAnyColumnUsed(std::initializer_list<std::string> columns) const;
+
+  /// Check if the table was told a column is unused, its rows may be partial.
+  bool isColumnPruned() const {
+    return column_pruned_;
+  }
+
   /// Check if a table-defined index exists within the query cache.
   bool isCached(const std::string& index) {
     return (table_->cache.count(index) != 0);
@@ -625,6 +656,9 @@ struct QueryContext : private boost::noncopyable {
   /// The map of column name to constraint list.
   ConstraintMap constraints;
 
+  /// The columns used by the query, if known.
+  boost::optional<UsedColumns> used_columns;
+
  private:
   /// If false then the context is maintaining a ephemeral cache.
   bool enable_cache_{false};
@@ -632,6 +666,9 @@ struct QueryContext : private boost::noncopyable {
   /// Persistent table content for table caching.
   VirtualTableContent* table_{nullptr};
 
+  /// Set when isColumnUsed reported an unused column.
+  mutable bool column_pruned_{false};
+
  private:
   friend class TablePlugin;
 };
@@ -810,6 +847,7 @@ class TablePlugin : public Plugin {
   FRIEND_TEST(VirtualTableTests, test_tableplugin_columndefinition);
   FRIEND_TEST(VirtualTableTests, test_tableplugin_statement);
   FRIEND_TEST(VirtualTableTests, test_indexing_costs);
+  FRIEND_TEST(VirtualTableTests, test_shared_scans);
 };
 
 /// Helper method to generate the virtual table CREATE statement.
@@ -827,5 +865,51 @@ inline const std::string& columnTypeName(ColumnType type) {
 /// Get the column type from the string representation.
 ColumnType columnTypeName(const std::string& type);
 
+/// Called by parallelFor with the worker thread number and an item index.
+using ParallelItemFunction = std::function<void(size_t thread, size_t item)>;
+
+/// Called by parallelGenerate to generate the rows for one item.
+using ParallelRowGenerator =
+    std::function<void(const std::string& item, QueryData& results)>;
+
+/**
+ * @brief The number of threads used to generate rows for a list of items.
+ *
+ * This is `--table_threads`, limited such that each thread has several items.
+ * A result of 1 means the items are generated serially on the calling thread.
+ */
+size_t parallelThreads(size_t items);
+
+/**
+ * @brief Call a function for each item index using several threads.
+ *
+ * Each thread claims chunks of its own contiguous range of items and steals
+ * chunks from the other ranges when its range is complete. A thread number,
+ * less than threads, is provided such that callers may use per-thread buffers.
+ * An exception thrown by the function is rethrown after every thread ends.
+ *
+ * @param items The number of items, indexes are [0, items).
+ * @param threads The number of threads, see parallelThreads.
+ * @param function Called, concurrently, once for each item index.
+ */
+void parallelFor(size_t items,
+                 size_t threads,
+                 const ParallelItemFunction& function);
+
+/**
+ * @brief Generate the rows for each item, such as a pid, using several threads.
+ *
+ * Rows are generated into per-thread buffers and merged when every item is
+ * complete. Generators must not share unsynchronized state.
+ *
+ * @param items The list of items, such as each pid within /proc.
+ * @param generator Called, concurrently, to generate the rows of an item.
+ * @param ordered Merge rows in the order of the items, as a serial loop would.
+ * @return The rows generated for every item.
+ */
+QueryData parallelGenerate(const std::vector<std::string>& items,
+                           const ParallelRowGenerator& generator,
+                           bool ordered = true);
+
 CREATE_LAZY_REGISTRY(TablePlugin, "table");
 }
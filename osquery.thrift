@@ -51,6 +51,24 @@ struct ExtensionResponse {
   2:ExtensionPluginResponse response,
 }
 
+/// Table rows are read from an extension in batches using a cursor.
+typedef i64 ExtensionCursorID
+
+/// A batch of table rows stored by column.
+struct ExtensionTableBatch {
+  1:ExtensionStatus status,
+  /// The cursor used to read the next batch (0 when done).
+  2:ExtensionCursorID cursor,
+  /// The column names present in this batch.
+  3:list<string> columns,
+  /// For each column, a value for every row in the batch.
+  4:list<list<string>> values,
+  /// For each column, the ascending row indexes without a value (NULL).
+  5:list<list<i32>> nulls,
+  /// Set when there are no more rows, the cursor is closed.
+  6:bool done,
+}
+
 exception ExtensionException {
   1:i32 code,
   2:string message,
@@ -70,6 +88,21 @@ service Extension {
     3:ExtensionPluginRequest request),
   /// Request that an extension shutdown (does not apply to managers).
   void shutdown(),
+  /// Generate a table plugin's rows and return the first batch.
+  ExtensionTableBatch openTable(
+    /// The table plugin name.
+    1:string item,
+    /// The thrift-equivilent of the table's generate PluginRequest.
+    2:ExtensionPluginRequest request,
+    /// The maximum number of rows in each batch.
+    3:i32 batch_size),
+  /// Return the next batch of rows from an open table cursor.
+  ExtensionTableBatch nextTableBatch(
+    1:ExtensionCursorID cursor,
+    2:i32 batch_size),
+  /// Close a table cursor before all batches are read (such as a LIMIT).
+  ExtensionStatus closeTable(
+    1:ExtensionCursorID cursor),
 }
 
 /// The extension manager is run by the osquery core process.
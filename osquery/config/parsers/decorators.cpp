@@ -8,10 +8,16 @@
  *
  */
 
+#include <chrono>
+#include <memory>
+#include <set>
+#include <tuple>
+
 #include <osquery/config.h>
 #include <osquery/flags.h>
 #include <osquery/logger.h>
 #include <osquery/sql.h>
+#include <osquery/system.h>
 
 #include "osquery/config/parsers/decorators.h"
 
@@ -26,6 +32,11 @@ FLAG(bool,
      false,
      "Add decorators as top level JSON objects");
 
+FLAG(uint64,
+     decorations_always_ttl,
+     1,
+     "Seconds scheduled queries reuse 'always' decorations, 0 reruns for each");
+
 /// Statically define the parser name to avoid mistakes.
 #define PARSER_NAME "decorators"
 
@@ -38,6 +49,10 @@ const std::map<DecorationPoint, std::string> kDecorationPointKeys = {
 using KeyValueMap = std::map<std::string, std::string>;
 using DecorationStore = std::map<std::string, KeyValueMap>;
 
+/// Decorator performance by source, point, and query.
+using DecoratorKey = std::tuple<std::string, DecorationPoint, std::string>;
+using DecoratorPerformanceMap = std::map<DecoratorKey, DecoratorPerformance>;
+
 namespace {
 
 /**
@@ -75,6 +90,9 @@ class DecoratorsConfigParserPlugin : public ConfigParserPlugin {
   void updateDecorations(const std::string& source,
                          const pt::ptree& decorators);
 
+  /// Forget the performance of queries no longer configured for a source.
+  void prunePerformance(const std::string& source);
+
   /// Clear the decorations created from decorators for the given source.
   void clearSources(const std::string& source);
 
@@ -97,11 +115,37 @@ class DecoratorsConfigParserPlugin : public ConfigParserPlugin {
 
   /// Protect additions to the decorator set.
   static Mutex kDecorationsMutex;
+
+  /// The time "always" decorators last ran for every source.
+  static size_t kAlwaysTime;
+
+  /**
+   * @brief The decorations of every source, merged.
+   *
+   * This is replaced, while holding the decorations lock, when decorations
+   * change. Log items copy the snapshot without waiting for decorator queries.
+   */
+  static std::shared_ptr<const KeyValueMap> kSnapshot;
+
+  /// Protect the decorations snapshot.
+  static Mutex kSnapshotMutex;
+
+  /// The performance of each executed decorator query.
+  static DecoratorPerformanceMap kPerformance;
+
+  /// Protect the decorator performance.
+  static Mutex kPerformanceMutex;
 };
 }
 
 DecorationStore DecoratorsConfigParserPlugin::kDecorations;
 Mutex DecoratorsConfigParserPlugin::kDecorationsMutex;
+size_t DecoratorsConfigParserPlugin::kAlwaysTime{0};
+std::shared_ptr<const KeyValueMap> DecoratorsConfigParserPlugin::kSnapshot{
+    nullptr};
+Mutex DecoratorsConfigParserPlugin::kSnapshotMutex;
+DecoratorPerformanceMap DecoratorsConfigParserPlugin::kPerformance;
+Mutex DecoratorsConfigParserPlugin::kPerformanceMutex;
 
 Status DecoratorsConfigParserPlugin::setUp() {
   // Decorators are kept within customized data structures.
@@ -120,6 +164,7 @@ Status DecoratorsConfigParserPlugin::update(const std::string& source,
     updateDecorations(source, config.at(PARSER_NAME));
     runDecorators(DECORATE_LOAD, 0, source);
   }
+  prunePerformance(source);
 
   return Status(0, "OK");
 }
@@ -140,6 +185,37 @@ void DecoratorsConfigParserPlugin::clearSources(const std::string& source) {
   }
 }
 
+void DecoratorsConfigParserPlugin::prunePerformance(
+    const std::string& source) {
+  std::set<std::pair<DecorationPoint, std::string>> configured;
+  {
+    WriteLock lock(DecoratorsConfigParserPlugin::kDecorationsMutex);
+    for (const auto& query : load_[source]) {
+      configured.insert(std::make_pair(DECORATE_LOAD, query));
+    }
+    for (const auto& query : always_[source]) {
+      configured.insert(std::make_pair(DECORATE_ALWAYS, query));
+    }
+    for (const auto& interval : intervals_[source]) {
+      for (const auto& query : interval.second) {
+        configured.insert(std::make_pair(DECORATE_INTERVAL, query));
+      }
+    }
+  }
+
+  WriteLock lock(kPerformanceMutex);
+  for (auto it = kPerformance.begin(); it != kPerformance.end();) {
+    const auto& key = it->first;
+    if (std::get<0>(key) == source &&
+        configured.count(std::make_pair(std::get<1>(key), std::get<2>(key))) ==
+            0) {
+      it = kPerformance.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
 void DecoratorsConfigParserPlugin::reset() {
   // Reset the internal data store (for all sources).
   for (const auto& source : DecoratorsConfigParserPlugin::kDecorations) {
@@ -195,10 +271,51 @@ inline void addDecoration(const std::string& source,
   DecoratorsConfigParserPlugin::kDecorations[source][name] = value;
 }
 
+/// Merge the decorations into a new snapshot, the decorations lock is held.
+static void updateSnapshot() {
+  auto snapshot = std::make_shared<KeyValueMap>();
+  for (const auto& source : DecoratorsConfigParserPlugin::kDecorations) {
+    for (const auto& decoration : source.second) {
+      (*snapshot)[decoration.first] = decoration.second;
+    }
+  }
+
+  WriteLock lock(DecoratorsConfigParserPlugin::kSnapshotMutex);
+  DecoratorsConfigParserPlugin::kSnapshot = std::move(snapshot);
+}
+
+/// Add a decorator query's execution to its performance.
+static void recordPerformance(const std::string& source,
+                              DecorationPoint point,
+                              const std::string& query,
+                              size_t wall_time) {
+  WriteLock lock(DecoratorsConfigParserPlugin::kPerformanceMutex);
+  auto key = std::make_tuple(source, point, query);
+  auto& performance = DecoratorsConfigParserPlugin::kPerformance[key];
+  if (performance.executions == 0) {
+    performance.source = source;
+    performance.point = point;
+    performance.query = query;
+  }
+  performance.executions++;
+  performance.last_executed = getUnixTime();
+  performance.wall_time += wall_time;
+}
+
 inline void runDecorators(const std::string& source,
+                          DecorationPoint point,
                           const std::vector<std::string>& queries) {
   for (const auto& query : queries) {
+    auto start = std::chrono::steady_clock::now();
     auto results = SQL(query);
+    recordPerformance(
+        source,
+        point,
+        query,
+        std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start)
+            .count());
+
     if (results.rows().size() > 0) {
       // Notice the warning above about undefined behavior when:
       // 1: You include decorators that emit the same column name
@@ -218,6 +335,9 @@ inline void runDecorators(const std::string& source,
 void clearDecorations(const std::string& source) {
   WriteLock lock(DecoratorsConfigParserPlugin::kDecorationsMutex);
   DecoratorsConfigParserPlugin::kDecorations[source].clear();
+  // The cleared "always" decorations are not reused.
+  DecoratorsConfigParserPlugin::kAlwaysTime = 0;
+  updateSnapshot();
 }
 
 void runDecorators(DecorationPoint point,
@@ -239,13 +359,23 @@ void runDecorators(DecorationPoint point,
   if (point == DECORATE_LOAD) {
     for (const auto& target_source : dp->load_) {
       if (source.empty() || target_source.first == source) {
-        runDecorators(target_source.first, target_source.second);
+        runDecorators(target_source.first, point, target_source.second);
       }
     }
   } else if (point == DECORATE_ALWAYS) {
+    if (source.empty() && time > 0) {
+      // Queries launched within the TTL share the last results.
+      auto& last = DecoratorsConfigParserPlugin::kAlwaysTime;
+      if (last > 0 && time >= last &&
+          time - last < FLAGS_decorations_always_ttl) {
+        return;
+      }
+      last = time;
+    }
+
     for (const auto& target_source : dp->always_) {
       if (source.empty() || target_source.first == source) {
-        runDecorators(target_source.first, target_source.second);
+        runDecorators(target_source.first, point, target_source.second);
       }
     }
   } else if (point == DECORATE_INTERVAL) {
@@ -253,12 +383,13 @@ void runDecorators(DecorationPoint point,
       for (const auto& interval : target_source.second) {
         if (time % interval.first == 0) {
           if (source.empty() || target_source.first == source) {
-            runDecorators(target_source.first, interval.second);
+            runDecorators(target_source.first, point, interval.second);
           }
         }
       }
     }
   }
+  updateSnapshot();
 }
 
 void getDecorations(std::map<std::string, std::string>& results) {
@@ -266,14 +397,28 @@ void getDecorations(std::map<std::string, std::string>& results) {
     return;
   }
 
-  WriteLock lock(DecoratorsConfigParserPlugin::kDecorationsMutex);
+  std::shared_ptr<const KeyValueMap> snapshot{nullptr};
+  {
+    WriteLock lock(DecoratorsConfigParserPlugin::kSnapshotMutex);
+    snapshot = DecoratorsConfigParserPlugin::kSnapshot;
+  }
+
   // Copy the decorations into the log_item.
-  for (const auto& source : DecoratorsConfigParserPlugin::kDecorations) {
-    for (const auto& decoration : source.second) {
+  if (snapshot != nullptr) {
+    for (const auto& decoration : *snapshot) {
       results[decoration.first] = decoration.second;
     }
   }
 }
 
+std::vector<DecoratorPerformance> getDecoratorPerformance() {
+  std::vector<DecoratorPerformance> performance;
+  WriteLock lock(DecoratorsConfigParserPlugin::kPerformanceMutex);
+  for (const auto& query : DecoratorsConfigParserPlugin::kPerformance) {
+    performance.push_back(query.second);
+  }
+  return performance;
+}
+
 REGISTER_INTERNAL(DecoratorsConfigParserPlugin, "config_parser", PARSER_NAME);
 }
@@ -12,6 +12,7 @@
 
 #include <map>
 #include <functional>
+#include <vector>
 
 #include <osquery/config.h>
 #include <osquery/database.h>
@@ -34,8 +35,12 @@ extern const std::map<DecorationPoint, std::string> kDecorationPointKeys;
  * The configuration maintains various sources, each may contain a set of
  * decorators. The source tracking is abstracted for the decorator iterator.
  *
+ * The results of "always" decorators are reused for `--decorations_always_ttl`
+ * seconds when a time is provided, such that every query launched within a
+ * schedule step shares a single execution.
+ *
  * @param point request execution of decorators for this given point.
- * @param time an optional time for points using intervals.
+ * @param time an optional time for points using intervals or reuse.
  * @param source restrict run to a specific config source.
  */
 void runDecorators(DecorationPoint point,
@@ -57,4 +62,24 @@ void getDecorations(std::map<std::string, std::string>& results);
 
 /// Clear decorations for a source when it updates.
 void clearDecorations(const std::string& source);
+
+/// The execution performance of a decorator query.
+struct DecoratorPerformance {
+  /// The config source and point that defined the query.
+  std::string source;
+  DecorationPoint point;
+  std::string query;
+
+  /// Number of times the query was executed.
+  size_t executions{0};
+
+  /// UNIX time of the last execution.
+  size_t last_executed{0};
+
+  /// Total wall time in milliseconds spent executing.
+  size_t wall_time{0};
+};
+
+/// Copy the performance of each decorator query that has executed.
+std::vector<DecoratorPerformance> getDecoratorPerformance();
 }
@@ -21,6 +21,7 @@ namespace osquery {
 
 DECLARE_bool(disable_decorators);
 DECLARE_bool(decorations_top_level);
+DECLARE_uint64(decorations_always_ttl);
 
 class DecoratorsConfigParserPluginTests : public testing::Test {
  public:
@@ -104,6 +105,53 @@ TEST_F(DecoratorsConfigParserPluginTests, test_decorators_run_interval) {
   ASSERT_EQ(second_item.decorations.size(), 2U);
 }
 
+/// The number of executions of a decorator query.
+static size_t getExecutions(const std::string& query) {
+  for (const auto& performance : getDecoratorPerformance()) {
+    if (performance.query == query) {
+      return performance.executions;
+    }
+  }
+  return 0;
+}
+
+TEST_F(DecoratorsConfigParserPluginTests, test_decorators_run_always_ttl) {
+  // Prevent loads from executing.
+  FLAGS_disable_decorators = true;
+  Config::getInstance().update(config_data_);
+  FLAGS_disable_decorators = false;
+
+  auto ttl = FLAGS_decorations_always_ttl;
+  FLAGS_decorations_always_ttl = 1;
+  std::string query = "select 'test' as always_test";
+  auto executions = getExecutions(query);
+  runDecorators(DECORATE_ALWAYS, 100);
+  EXPECT_EQ(executions + 1, getExecutions(query));
+
+  QueryLogItem item;
+  getDecorations(item.decorations);
+  EXPECT_EQ(item.decorations["always_test"], "test");
+
+  // Queries launched within the same step reuse the decorations.
+  runDecorators(DECORATE_ALWAYS, 100);
+  EXPECT_EQ(executions + 1, getExecutions(query));
+  runDecorators(DECORATE_ALWAYS, 101);
+  EXPECT_EQ(executions + 2, getExecutions(query));
+
+  // Clearing the decorations, such as a config update, runs them again.
+  clearDecorations("awesome");
+  runDecorators(DECORATE_ALWAYS, 101);
+  EXPECT_EQ(executions + 3, getExecutions(query));
+
+  // Without a TTL, or a time, the decorators run every time.
+  FLAGS_decorations_always_ttl = 0;
+  runDecorators(DECORATE_ALWAYS, 101);
+  EXPECT_EQ(executions + 4, getExecutions(query));
+  FLAGS_decorations_always_ttl = ttl;
+  runDecorators(DECORATE_ALWAYS);
+  EXPECT_EQ(executions + 5, getExecutions(query));
+}
+
 TEST_F(DecoratorsConfigParserPluginTests, test_decorators_run_load_top_level) {
   // Re-enable the decorators, then update the config.
   // The 'load' decorator set should run every time the config is updated.
@@ -0,0 +1,89 @@
+/*
+ *  Copyright (c) 2014-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <boost/filesystem.hpp>
+
+#include <osquery/filesystem.h>
+#include <osquery/flags.h>
+#include <osquery/hash.h>
+
+#include "osquery/tests/test_util.h"
+
+namespace fs = boost::filesystem;
+
+namespace osquery {
+
+DECLARE_uint64(hash_threads);
+
+const int kHashAll = HASH_TYPE_MD5 | HASH_TYPE_SHA1 | HASH_TYPE_SHA256;
+
+/// Create a synthetic tree of count files, each of size bytes.
+static std::vector<std::string> genHashTree(size_t count, size_t size) {
+  auto root = fs::path(kTestWorkingDirectory) / "hash_benchmarks" /
+              (std::to_string(count) + "x" + std::to_string(size));
+  fs::create_directories(root);
+
+  std::string content(size, '\0');
+  for (size_t i = 0; i < size; i++) {
+    content[i] = static_cast<char>(i * 31);
+  }
+
+  std::vector<std::string> paths;
+  for (size_t i = 0; i < count; i++) {
+    auto path = (root / std::to_string(i)).string();
+    if (!pathExists(path).ok()) {
+      writeTextFile(path, content);
+    }
+    paths.push_back(path);
+  }
+  return paths;
+}
+
+static void HASH_files_serial(benchmark::State& state) {
+  auto paths = genHashTree(state.range_x(), state.range_y());
+  while (state.KeepRunning()) {
+    for (const auto& path : paths) {
+      auto hashes = hashMultiFromFile(kHashAll, path);
+    }
+  }
+}
+
+BENCHMARK(HASH_files_serial)
+    ->ArgPair(256, 4096)
+    ->ArgPair(4, 8 * 1024 * 1024);
+
+static void HASH_files_threads(benchmark::State& state) {
+  auto paths = genHashTree(state.range_x(), state.range_y());
+  while (state.KeepRunning()) {
+    auto hashes = hashMultiFromFiles(kHashAll, paths);
+  }
+}
+
+BENCHMARK(HASH_files_threads)
+    ->ArgPair(256, 4096)
+    ->ArgPair(4, 8 * 1024 * 1024);
+
+static void HASH_files_single_thread(benchmark::State& state) {
+  // The multi-file reader and read ahead, without concurrent hashing.
+  auto paths = genHashTree(state.range_x(), state.range_y());
+  auto threads = FLAGS_hash_threads;
+  FLAGS_hash_threads = 1;
+  while (state.KeepRunning()) {
+    auto hashes = hashMultiFromFiles(kHashAll, paths);
+  }
+  FLAGS_hash_threads = threads;
+}
+
+BENCHMARK(HASH_files_single_thread)
+    ->ArgPair(256, 4096)
+    ->ArgPair(4, 8 * 1024 * 1024);
+}
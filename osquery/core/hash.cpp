@@ -8,11 +8,22 @@
  *
  */
 
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#ifndef WIN32
+#include <unistd.h>
+#endif
+
+#include <atomic>
 #include <iomanip>
+#include <memory>
 #include <sstream>
+#include <thread>
 #include <vector>
 
 #include <osquery/filesystem.h>
+#include <osquery/flags.h>
 #include <osquery/hash.h>
 #include <osquery/logger.h>
 
@@ -22,22 +33,34 @@ namespace osquery {
 #import <CommonCrypto/CommonDigest.h>
 #define __HASH_API(name) CC_##name
 #else
-#include <openssl/sha.h>
-#include <openssl/md5.h>
-#define __HASH_API(name) name
-
-#define SHA1_DIGEST_LENGTH SHA_DIGEST_LENGTH
-#define SHA1_CTX SHA_CTX
+// The EVP interface selects the fastest implementation for the CPU, such as
+// the SHA extensions or AVX2, rather than the portable digest functions.
+#include <openssl/evp.h>
 #endif
 
 #define HASH_CHUNK_SIZE 4096
 
+FLAG(uint64, hash_threads, 4, "Threads used to hash the files of a query");
+
+FLAG(uint64,
+     hash_query_max,
+     0,
+     "Maximum file bytes hashed by a single query (0 is unlimited)");
+
+/// Read size used when hashing several files, larger reads amortize syscalls.
+const size_t kHashFilesBlockSize = 64 * 1024;
+
 Hash::~Hash() {
   if (ctx_ != nullptr) {
+#ifdef __APPLE__
     free(ctx_);
+#else
+    EVP_MD_CTX_destroy((EVP_MD_CTX*)ctx_);
+#endif
   }
 }
 
+#ifdef __APPLE__
 Hash::Hash(HashType algorithm) : algorithm_(algorithm) {
   if (algorithm_ == HASH_TYPE_MD5) {
     length_ = __HASH_API(MD5_DIGEST_LENGTH);
@@ -65,11 +88,34 @@ void Hash::update(const void* buffer, size_t size) {
     __HASH_API(SHA256_Update)((__HASH_API(SHA256_CTX)*)ctx_, buffer, size);
   }
 }
+#else
+Hash::Hash(HashType algorithm) : algorithm_(algorithm) {
+  const EVP_MD* md = nullptr;
+  if (algorithm_ == HASH_TYPE_MD5) {
+    md = EVP_md5();
+  } else if (algorithm_ == HASH_TYPE_SHA1) {
+    md = EVP_sha1();
+  } else if (algorithm_ == HASH_TYPE_SHA256) {
+    md = EVP_sha256();
+  } else {
+    throw std::domain_error("Unknown hash function");
+  }
+
+  length_ = static_cast<size_t>(EVP_MD_size(md));
+  ctx_ = EVP_MD_CTX_create();
+  EVP_DigestInit_ex((EVP_MD_CTX*)ctx_, md, nullptr);
+}
+
+void Hash::update(const void* buffer, size_t size) {
+  EVP_DigestUpdate((EVP_MD_CTX*)ctx_, buffer, size);
+}
+#endif
 
 std::string Hash::digest() {
   std::vector<unsigned char> hash;
   hash.assign(length_, '\0');
 
+#ifdef __APPLE__
   if (algorithm_ == HASH_TYPE_MD5) {
     __HASH_API(MD5_Final)(hash.data(), (__HASH_API(MD5_CTX)*)ctx_);
   } else if (algorithm_ == HASH_TYPE_SHA1) {
@@ -77,14 +123,18 @@ std::string Hash::digest() {
   } else if (algorithm_ == HASH_TYPE_SHA256) {
     __HASH_API(SHA256_Final)(hash.data(), (__HASH_API(SHA256_CTX)*)ctx_);
   }
+#else
+  EVP_DigestFinal_ex((EVP_MD_CTX*)ctx_, hash.data(), nullptr);
+#endif
 
   // The hash value is only relevant as a hex digest.
-  std::stringstream digest;
+  static const char kHexDigits[] = "0123456789abcdef";
+  std::string digest(length_ * 2, '0');
   for (size_t i = 0; i < length_; i++) {
-    digest << std::hex << std::setw(2) << std::setfill('0') << (int)hash[i];
+    digest[i * 2] = kHexDigits[hash[i] >> 4];
+    digest[i * 2 + 1] = kHexDigits[hash[i] & 0xf];
   }
-
-  return digest.str();
+  return digest;
 }
 
 std::string hashFromBuffer(HashType hash_type,
@@ -95,38 +145,101 @@ std::string hashFromBuffer(HashType hash_type,
   return hash.digest();
 }
 
-MultiHashes hashMultiFromFile(int mask, const std::string& path) {
-  std::map<HashType, std::shared_ptr<Hash>> hashes = {
-      {HASH_TYPE_MD5, std::make_shared<Hash>(HASH_TYPE_MD5)},
-      {HASH_TYPE_SHA1, std::make_shared<Hash>(HASH_TYPE_SHA1)},
-      {HASH_TYPE_SHA256, std::make_shared<Hash>(HASH_TYPE_SHA256)},
-  };
+/// Hint that a file will be read soon, so its pages are read ahead.
+static void adviseHashFile(const std::string& path) {
+#if defined(POSIX_FADV_WILLNEED)
+  int fd = ::open(path.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+  if (fd >= 0) {
+    // The advice applies to the file's pages and outlives the descriptor.
+    ::posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+    ::close(fd);
+  }
+#endif
+}
+
+/// Hash a file with a read block size, only the requested digests are updated.
+static MultiHashes hashMultiFromFile(int mask,
+                                     const std::string& path,
+                                     size_t block_size) {
+  std::vector<std::pair<HashType, std::unique_ptr<Hash>>> hashes;
+  for (auto type : {HASH_TYPE_MD5, HASH_TYPE_SHA1, HASH_TYPE_SHA256}) {
+    if (mask & type) {
+      hashes.emplace_back(type, std::unique_ptr<Hash>(new Hash(type)));
+    }
+  }
 
   readFile(path,
            0,
-           HASH_CHUNK_SIZE,
+           block_size,
            false,
            true,
-           ([&hashes, &mask](std::string& buffer, size_t size) {
+           ([&hashes](std::string& buffer, size_t size) {
              for (auto& hash : hashes) {
-               if (mask & hash.first) {
-                 hash.second->update(&buffer[0], size);
-               }
+               hash.second->update(&buffer[0], size);
              }
            }));
 
   MultiHashes mh;
   mh.mask = mask;
-  if (mask & HASH_TYPE_MD5) {
-    mh.md5 = hashes.at(HASH_TYPE_MD5)->digest();
+  for (auto& hash : hashes) {
+    if (hash.first == HASH_TYPE_MD5) {
+      mh.md5 = hash.second->digest();
+    } else if (hash.first == HASH_TYPE_SHA1) {
+      mh.sha1 = hash.second->digest();
+    } else {
+      mh.sha256 = hash.second->digest();
+    }
   }
-  if (mask & HASH_TYPE_SHA1) {
-    mh.sha1 = hashes.at(HASH_TYPE_SHA1)->digest();
+  return mh;
+}
+
+MultiHashes hashMultiFromFile(int mask, const std::string& path) {
+  return hashMultiFromFile(mask, path, HASH_CHUNK_SIZE);
+}
+
+std::vector<MultiHashes> hashMultiFromFiles(
+    int mask, const std::vector<std::string>& paths, size_t max_bytes) {
+  std::vector<MultiHashes> results(paths.size(), MultiHashes{0, "", "", ""});
+  if (max_bytes == 0) {
+    max_bytes = FLAGS_hash_query_max;
   }
-  if (mask & HASH_TYPE_SHA256) {
-    mh.sha256 = hashes.at(HASH_TYPE_SHA256)->digest();
+
+  // Files are claimed in order, each worker advises the kernel to read ahead
+  // the file after the one it claims.
+  std::atomic<size_t> next{0};
+  std::atomic<size_t> budget{0};
+  auto work = ([&]() {
+    for (size_t i = next++; i < paths.size(); i = next++) {
+      if (i + 1 < paths.size()) {
+        adviseHashFile(paths[i + 1]);
+      }
+
+      if (max_bytes > 0) {
+        // Reserve the file's size from the query budget before reading.
+        struct stat info;
+        size_t size =
+            (::stat(paths[i].c_str(), &info) == 0) ? info.st_size : 0;
+        if (budget.fetch_add(size) + size > max_bytes) {
+          budget -= size;
+          VLOG(1) << "Not hashing " << paths[i] << ": query exceeds "
+                  << max_bytes << " bytes";
+          continue;
+        }
+      }
+      results[i] = hashMultiFromFile(mask, paths[i], kHashFilesBlockSize);
+    }
+  });
+
+  auto count = std::min(paths.size(), static_cast<size_t>(FLAGS_hash_threads));
+  std::vector<std::thread> workers;
+  for (size_t i = 1; i < count; i++) {
+    workers.emplace_back(work);
   }
-  return mh;
+  work();
+  for (auto& worker : workers) {
+    worker.join();
+  }
+  return results;
 }
 
 std::string hashFromFile(HashType hash_type, const std::string& path) {
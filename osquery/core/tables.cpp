@@ -8,6 +8,12 @@
  *
  */
 
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <iterator>
+#include <thread>
+
 #include <osquery/database.h>
 #include <osquery/flags.h>
 #include <osquery/logger.h>
@@ -21,6 +27,17 @@ namespace osquery {
 
 FLAG(bool, disable_caching, false, "Disable scheduled query caching");
 
+FLAG(uint64,
+     table_threads,
+     4,
+     "Threads generating per-process table rows, 1 generates serially");
+
+/// Fewer items than this per thread are not worth starting a thread.
+const size_t kParallelMinItemsPerThread = 32;
+
+/// Items claimed at once by a parallelFor thread.
+const size_t kParallelChunkSize = 8;
+
 size_t TablePlugin::kCacheInterval = 0;
 size_t TablePlugin::kCacheStep = 0;
 
@@ -364,6 +381,24 @@ bool QueryContext::hasConstraint(const std::string& column,
   return constraints.at(column).exists(op);
 }
 
+bool QueryContext::isColumnUsed(const std::string& column) const {
+  if (!used_columns || used_columns->count(column) > 0) {
+    return true;
+  }
+  column_pruned_ = true;
+  return false;
+}
+
+bool QueryContext::isAnyColumnUsed(
+    std::initializer_list<std::string> columns) const {
+  for (const auto& column : columns) {
+    if (isColumnUsed(column)) {
+      return true;
+    }
+  }
+  return false;
+}
+
 Status QueryContext::expandConstraints(
     const std::string& column,
     ConstraintOperator op,
@@ -378,4 +413,141 @@ Status QueryContext::expandConstraints(
   }
   return Status(0);
 }
+
+size_t parallelThreads(size_t items) {
+  size_t threads = std::max(FLAGS_table_threads, (uint64_t)1);
+  return std::max(std::min(threads, items / kParallelMinItemsPerThread),
+                  (size_t)1);
+}
+
+namespace {
+
+/// A contiguous range of items first claimed by one parallelFor thread.
+struct ParallelRange {
+  std::atomic<size_t> next{0};
+  size_t end{0};
+};
+
+/// The rows generated for one item by parallelGenerate.
+struct ParallelSegment {
+  size_t item;
+  size_t thread;
+  size_t begin;
+  size_t end;
+};
+}
+
+void parallelFor(size_t items,
+                 size_t threads,
+                 const ParallelItemFunction& function) {
+  threads = std::max(std::min(threads, items), (size_t)1);
+  if (threads == 1) {
+    for (size_t item = 0; item < items; item++) {
+      function(0, item);
+    }
+    return;
+  }
+
+  std::vector<ParallelRange> ranges(threads);
+  for (size_t i = 0; i < threads; i++) {
+    ranges[i].next = items * i / threads;
+    ranges[i].end = items * (i + 1) / threads;
+  }
+
+  Mutex error_mutex;
+  std::exception_ptr error{nullptr};
+  auto work = [&](size_t thread) {
+    try {
+      // Complete this thread's range, then steal chunks from the others.
+      for (size_t i = 0; i < threads; i++) {
+        auto& range = ranges[(thread + i) % threads];
+        while (true) {
+          auto begin = range.next.fetch_add(kParallelChunkSize);
+          if (begin >= range.end) {
+            break;
+          }
+          auto end = std::min(begin + kParallelChunkSize, range.end);
+          for (auto item = begin; item < end; item++) {
+            function(thread, item);
+          }
+        }
+      }
+    } catch (...) {
+      WriteLock lock(error_mutex);
+      if (error == nullptr) {
+        error = std::current_exception();
+      }
+    }
+  };
+
+  // The calling thread is the first worker.
+  std::vector<std::thread> workers;
+  for (size_t thread = 1; thread < threads; thread++) {
+    workers.emplace_back(work, thread);
+  }
+  work(0);
+  for (auto& worker : workers) {
+    worker.join();
+  }
+
+  if (error != nullptr) {
+    std::rethrow_exception(error);
+  }
+}
+
+QueryData parallelGenerate(const std::vector<std::string>& items,
+                           const ParallelRowGenerator& generator,
+                           bool ordered) {
+  auto threads = parallelThreads(items.size());
+  if (threads == 1) {
+    QueryData results;
+    for (const auto& item : items) {
+      generator(item, results);
+    }
+    return results;
+  }
+
+  std::vector<QueryData> buffers(threads);
+  std::vector<std::vector<ParallelSegment>> segments(threads);
+  parallelFor(items.size(), threads, [&](size_t thread, size_t item) {
+    auto& buffer = buffers[thread];
+    size_t begin = buffer.size();
+    generator(items[item], buffer);
+    if (ordered && buffer.size() > begin) {
+      segments[thread].push_back({item, thread, begin, buffer.size()});
+    }
+  });
+
+  QueryData results;
+  size_t rows = 0;
+  for (const auto& buffer : buffers) {
+    rows += buffer.size();
+  }
+  results.reserve(rows);
+
+  if (!ordered) {
+    for (auto& buffer : buffers) {
+      std::move(buffer.begin(), buffer.end(), std::back_inserter(results));
+    }
+    return results;
+  }
+
+  // Each item was generated by one thread, merge the rows in item order.
+  std::vector<ParallelSegment> merged;
+  for (auto& thread_segments : segments) {
+    merged.insert(merged.end(), thread_segments.begin(), thread_segments.end());
+  }
+  std::sort(merged.begin(),
+            merged.end(),
+            [](const ParallelSegment& a, const ParallelSegment& b) {
+              return a.item < b.item;
+            });
+  for (const auto& segment : merged) {
+    auto& buffer = buffers[segment.thread];
+    std::move(buffer.begin() + segment.begin,
+              buffer.begin() + segment.end,
+              std::back_inserter(results));
+  }
+  return results;
+}
 }
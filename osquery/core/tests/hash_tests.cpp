@@ -46,4 +46,23 @@ TEST_F(HashTests, test_file_hashing) {
   auto digest = hashFromFile(HASH_TYPE_MD5, kTestDataPath + "test_hashing.bin");
   EXPECT_EQ(digest, "88ee11f2aa7903f34b8b8785d92208b1");
 }
+
+TEST_F(HashTests, test_multi_file_hashing) {
+  auto path = kTestDataPath + "test_hashing.bin";
+  std::vector<std::string> paths = {path, path, path};
+  auto hashes = hashMultiFromFiles(HASH_TYPE_MD5 | HASH_TYPE_SHA1, paths);
+  ASSERT_EQ(3U, hashes.size());
+  for (const auto& hash : hashes) {
+    EXPECT_EQ(HASH_TYPE_MD5 | HASH_TYPE_SHA1, hash.mask);
+    EXPECT_EQ("88ee11f2aa7903f34b8b8785d92208b1", hash.md5);
+    EXPECT_EQ(hashFromFile(HASH_TYPE_SHA1, path), hash.sha1);
+    EXPECT_TRUE(hash.sha256.empty());
+  }
+
+  // Files exceeding the byte budget are not hashed.
+  hashes = hashMultiFromFiles(HASH_TYPE_MD5, paths, 1);
+  ASSERT_EQ(3U, hashes.size());
+  EXPECT_EQ(0, hashes[0].mask);
+  EXPECT_TRUE(hashes[0].md5.empty());
+}
 }
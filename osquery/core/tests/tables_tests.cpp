@@ -8,12 +8,18 @@
  *
  */
 
+#include <algorithm>
+#include <stdexcept>
+
 #include <gtest/gtest.h>
 
+#include <osquery/flags.h>
 #include <osquery/tables.h>
 
 namespace osquery {
 
+DECLARE_uint64(table_threads);
+
 class TablesTests : public testing::Test {};
 
 TEST_F(TablesTests, test_constraint) {
@@ -164,4 +170,50 @@ TEST_F(TablesTests, test_caching) {
   EXPECT_TRUE(test.testIsCached(6));
   EXPECT_FALSE(test.testIsCached(7));
 }
+
+TEST_F(TablesTests, test_parallel_generate) {
+  std::vector<std::string> items;
+  for (size_t i = 0; i < 1000; i++) {
+    items.push_back(std::to_string(i));
+  }
+
+  // Items generate between zero and two rows.
+  auto generator = [](const std::string& item, QueryData& results) {
+    auto rows = std::stoul(item) % 3;
+    for (size_t i = 0; i < rows; i++) {
+      results.push_back({{"item", item}, {"row", std::to_string(i)}});
+    }
+  };
+
+  auto threads = FLAGS_table_threads;
+  FLAGS_table_threads = 1;
+  EXPECT_EQ(1U, parallelThreads(items.size()));
+  auto serial = parallelGenerate(items, generator);
+  EXPECT_EQ(999U, serial.size());
+
+  // Ordered rows are merged as the serial loop generated them.
+  FLAGS_table_threads = 4;
+  EXPECT_EQ(4U, parallelThreads(items.size()));
+  EXPECT_EQ(1U, parallelThreads(1));
+  EXPECT_EQ(serial, parallelGenerate(items, generator));
+
+  auto unordered = parallelGenerate(items, generator, false);
+  auto compare = [](const Row& a, const Row& b) {
+    return std::stoul(a.at("item")) < std::stoul(b.at("item")) ||
+           (a.at("item") == b.at("item") && a.at("row") < b.at("row"));
+  };
+  std::sort(unordered.begin(), unordered.end(), compare);
+  EXPECT_EQ(serial, unordered);
+
+  // Exceptions within a worker are rethrown to the caller.
+  EXPECT_THROW(parallelFor(items.size(),
+                           4,
+                           [](size_t /* thread */, size_t item) {
+                             if (item == 500) {
+                               throw std::runtime_error("item");
+                             }
+                           }),
+               std::runtime_error);
+  FLAGS_table_threads = threads;
+}
 }
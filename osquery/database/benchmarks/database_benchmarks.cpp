@@ -12,6 +12,7 @@
 
 #include <osquery/database.h>
 #include <osquery/filesystem.h>
+#include <osquery/registry.h>
 
 #include "osquery/tests/test_util.h"
 #include "osquery/database/query.h"
@@ -137,4 +138,117 @@ static void DATABASE_store_append(benchmark::State& state) {
 }
 
 BENCHMARK(DATABASE_store_append);
+
+/// The database plugins compared by the DATABASE_plugin benchmarks.
+static const std::vector<std::string> kBenchmarkPlugins = {"ephemeral",
+                                                           "rocksdb"};
+
+/// Open a database plugin by its kBenchmarkPlugins index, nullptr if missing.
+static std::shared_ptr<DatabasePlugin> openBenchmarkPlugin(size_t index) {
+  const auto& name = kBenchmarkPlugins.at(index);
+  if (!Registry::exists("database", name)) {
+    return nullptr;
+  }
+
+  auto plugin = std::dynamic_pointer_cast<DatabasePlugin>(
+      Registry::get("database", name));
+  if (plugin == nullptr || !plugin->reset().ok()) {
+    return nullptr;
+  }
+  return plugin;
+}
+
+/// Close a benchmarked plugin unless it is the active database.
+static void closeBenchmarkPlugin(
+    size_t index, const std::shared_ptr<DatabasePlugin>& plugin) {
+  if (plugin != nullptr &&
+      Registry::getActive("database") != kBenchmarkPlugins.at(index)) {
+    plugin->tearDown();
+  }
+}
+
+static void DATABASE_plugin_put(benchmark::State& state) {
+  auto plugin = openBenchmarkPlugin(state.range_x());
+  if (plugin == nullptr) {
+    return;
+  }
+
+  size_t k = 0;
+  while (state.KeepRunning()) {
+    plugin->put(kEvents,
+                "data.benchmark." + std::to_string(k++ % state.range_y()),
+                "content");
+  }
+  closeBenchmarkPlugin(state.range_x(), plugin);
+}
+
+BENCHMARK(DATABASE_plugin_put)->ArgPair(0, 1000)->ArgPair(1, 1000);
+
+static void DATABASE_plugin_get(benchmark::State& state) {
+  auto plugin = openBenchmarkPlugin(state.range_x());
+  if (plugin == nullptr) {
+    return;
+  }
+
+  for (int i = 0; i < state.range_y(); i++) {
+    plugin->put(kEvents, "data.benchmark." + std::to_string(i), "content");
+  }
+
+  size_t k = 0;
+  while (state.KeepRunning()) {
+    std::string value;
+    plugin->get(kEvents,
+                "data.benchmark." + std::to_string(k++ % state.range_y()),
+                value);
+  }
+  closeBenchmarkPlugin(state.range_x(), plugin);
+}
+
+BENCHMARK(DATABASE_plugin_get)->ArgPair(0, 1000)->ArgPair(1, 1000);
+
+static void DATABASE_plugin_put_many(benchmark::State& state) {
+  auto plugin = openBenchmarkPlugin(state.range_x());
+  if (plugin == nullptr) {
+    return;
+  }
+
+  DatabaseValues values;
+  for (int i = 0; i < state.range_y(); i++) {
+    values.push_back(
+        std::make_pair("data.benchmark." + std::to_string(i), "content"));
+  }
+
+  while (state.KeepRunning()) {
+    plugin->putMany(kEvents, values);
+  }
+  closeBenchmarkPlugin(state.range_x(), plugin);
+}
+
+BENCHMARK(DATABASE_plugin_put_many)->ArgPair(0, 1000)->ArgPair(1, 1000);
+
+static void DATABASE_plugin_scan(benchmark::State& state) {
+  auto plugin = openBenchmarkPlugin(state.range_x());
+  if (plugin == nullptr) {
+    return;
+  }
+
+  // Scan one subscriber's keys among several subscribers.
+  DatabaseValues values;
+  for (int i = 0; i < state.range_y(); i++) {
+    for (const auto& sub : {"a", "b", "c", "d"}) {
+      values.push_back(std::make_pair(
+          std::string("data.benchmark.") + sub + "." + std::to_string(i),
+          "content"));
+    }
+  }
+  plugin->putMany(kEvents, values);
+
+  while (state.KeepRunning()) {
+    std::vector<std::string> keys;
+    plugin->scan(kEvents, keys, "data.benchmark.b.");
+  }
+  closeBenchmarkPlugin(state.range_x(), plugin);
+}
+
+BENCHMARK(DATABASE_plugin_scan)->ArgPair(0, 1000)->ArgPair(1, 1000);
 }
@@ -444,6 +444,113 @@ bool DatabasePlugin::checkDB() {
   return result;
 }
 
+Status DatabasePlugin::getMany(const std::string& domain,
+                               const std::vector<std::string>& keys,
+                               DatabaseValues& values) const {
+  for (const auto& key : keys) {
+    std::string value;
+    if (get(domain, key, value).ok()) {
+      values.push_back(std::make_pair(key, std::move(value)));
+    }
+  }
+  return Status(0, "OK");
+}
+
+Status DatabasePlugin::putMany(const std::string& domain,
+                               const DatabaseValues& values) {
+  for (const auto& value : values) {
+    auto status = put(domain, value.first, value.second);
+    if (!status.ok()) {
+      return status;
+    }
+  }
+  return Status(0, "OK");
+}
+
+Status DatabasePlugin::scanValues(const std::string& domain,
+                                  DatabaseValues& results,
+                                  const std::string& prefix,
+                                  size_t max) const {
+  std::vector<std::string> keys;
+  auto status = scan(domain, keys, prefix, max);
+  if (!status.ok()) {
+    return status;
+  }
+  return getMany(domain, keys, results);
+}
+
+/// Serialize the keys of a bulk database request as a JSON list.
+static std::string serializeDatabaseKeys(const std::vector<std::string>& keys) {
+  pt::ptree tree;
+  for (const auto& key : keys) {
+    pt::ptree child;
+    child.put_value(key);
+    tree.push_back(std::make_pair("", child));
+  }
+
+  std::ostringstream output;
+  pt::write_json(output, tree, false);
+  return output.str();
+}
+
+/// Serialize the key/value pairs of a bulk database request as a JSON list.
+static std::string serializeDatabaseValues(const DatabaseValues& values) {
+  pt::ptree tree;
+  for (const auto& value : values) {
+    pt::ptree pair;
+    pt::ptree key;
+    key.put_value(value.first);
+    pair.push_back(std::make_pair("", key));
+    pt::ptree data;
+    data.put_value(value.second);
+    pair.push_back(std::make_pair("", data));
+    tree.push_back(std::make_pair("", pair));
+  }
+
+  std::ostringstream output;
+  pt::write_json(output, tree, false);
+  return output.str();
+}
+
+static Status deserializeDatabaseKeys(const std::string& json,
+                                      std::vector<std::string>& keys) {
+  pt::ptree tree;
+  try {
+    std::stringstream input;
+    input << json;
+    pt::read_json(input, tree);
+  } catch (const pt::json_parser::json_parser_error& e) {
+    return Status(1, e.what());
+  }
+
+  for (const auto& key : tree) {
+    keys.push_back(key.second.data());
+  }
+  return Status(0, "OK");
+}
+
+static Status deserializeDatabaseValues(const std::string& json,
+                                        DatabaseValues& values) {
+  pt::ptree tree;
+  try {
+    std::stringstream input;
+    input << json;
+    pt::read_json(input, tree);
+  } catch (const pt::json_parser::json_parser_error& e) {
+    return Status(1, e.what());
+  }
+
+  for (const auto& pair : tree) {
+    if (pair.second.size() != 2) {
+      return Status(1, "Database values must be key/value pairs");
+    }
+    auto key = pair.second.begin();
+    auto value = std::next(key);
+    values.push_back(std::make_pair(key->second.data(), value->second.data()));
+  }
+  return Status(0, "OK");
+}
+
 Status DatabasePlugin::call(const PluginRequest& request,
                             PluginResponse& response) {
   if (request.count("action") == 0) {
@@ -480,6 +587,51 @@ Status DatabasePlugin::call(const PluginRequest& request,
       response.push_back({{"k", k}});
     }
     return status;
+  } else if (request.at("action") == "getMany") {
+    if (request.count("keys") == 0) {
+      return Status(1, "Database plugin getMany action requires keys");
+    }
+
+    std::vector<std::string> keys;
+    auto status = deserializeDatabaseKeys(request.at("keys"), keys);
+    if (!status.ok()) {
+      return status;
+    }
+
+    DatabaseValues values;
+    status = this->getMany(domain, keys, values);
+    for (auto& value : values) {
+      response.push_back(
+          {{"k", std::move(value.first)}, {"v", std::move(value.second)}});
+    }
+    return status;
+  } else if (request.at("action") == "putMany") {
+    if (request.count("values") == 0) {
+      return Status(1, "Database plugin putMany action requires values");
+    }
+
+    DatabaseValues values;
+    auto status = deserializeDatabaseValues(request.at("values"), values);
+    if (!status.ok()) {
+      return status;
+    }
+    return this->putMany(domain, values);
+  } else if (request.at("action") == "scanValues") {
+    size_t max = 0;
+    if (request.count("max") > 0) {
+      max = std::stoul(request.at("max"));
+    }
+
+    auto prefix = (request.count("prefix") > 0) ? request.at("prefix") : "";
+    DatabaseValues values;
+    auto status = this->scanValues(domain, values, prefix, max);
+    for (auto& value : values) {
+      response.push_back(
+          {{"k", std::move(value.first)}, {"v", std::move(value.second)}});
+    }
+    return status;
+  } else if (request.at("action") == "stats") {
+    return this->stats(response);
   }
 
   return Status(1, "Unknown database plugin action");
@@ -578,6 +730,76 @@ Status scanDatabaseKeys(const std::string& domain,
   }
 }
 
+/// Collect the key/value rows of a bulk database response.
+static void getDatabaseResponseValues(const PluginResponse& response,
+                                      DatabaseValues& values) {
+  for (const auto& item : response) {
+    if (item.count("k") > 0 && item.count("v") > 0) {
+      values.push_back(std::make_pair(item.at("k"), item.at("v")));
+    }
+  }
+}
+
+Status getDatabaseValues(const std::string& domain,
+                         const std::vector<std::string>& keys,
+                         DatabaseValues& values) {
+  if (Registry::external()) {
+    // All keys are requested from the extension manager in a single call.
+    PluginRequest request = {{"action", "getMany"},
+                             {"domain", domain},
+                             {"keys", serializeDatabaseKeys(keys)}};
+    PluginResponse response;
+    auto status = Registry::call("database", request, response);
+    getDatabaseResponseValues(response, values);
+    return status;
+  } else {
+    auto plugin = getDatabasePlugin();
+    return plugin->getMany(domain, keys, values);
+  }
+}
+
+Status setDatabaseValues(const std::string& domain,
+                         const DatabaseValues& values) {
+  if (Registry::external()) {
+    PluginRequest request = {{"action", "putMany"},
+                             {"domain", domain},
+                             {"values", serializeDatabaseValues(values)}};
+    return Registry::call("database", request);
+  } else {
+    auto plugin = getDatabasePlugin();
+    return plugin->putMany(domain, values);
+  }
+}
+
+Status scanDatabaseValues(const std::string& domain,
+                          DatabaseValues& values,
+                          const std::string& prefix,
+                          size_t max) {
+  if (Registry::external()) {
+    PluginRequest request = {{"action", "scanValues"},
+                             {"domain", domain},
+                             {"prefix", prefix},
+                             {"max", std::to_string(max)}};
+    PluginResponse response;
+    auto status = Registry::call("database", request, response);
+    getDatabaseResponseValues(response, values);
+    return status;
+  } else {
+    auto plugin = getDatabasePlugin();
+    return plugin->scanValues(domain, values, prefix, max);
+  }
+}
+
+Status getDatabaseStats(QueryData& results) {
+  if (Registry::external()) {
+    PluginRequest request = {{"action", "stats"}};
+    return Registry::call("database", request, results);
+  } else {
+    auto plugin = getDatabasePlugin();
+    return plugin->stats(results);
+  }
+}
+
 void dumpDatabase() {
   for (const auto& domain : kDomains) {
     std::vector<std::string> keys;
@@ -8,15 +8,63 @@
  *
  */
 
+#ifndef WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <map>
+#include <memory>
+
+#include <osquery/core.h>
 #include <osquery/database.h>
+#include <osquery/filesystem.h>
+#include <osquery/flags.h>
 #include <osquery/logger.h>
 
 namespace osquery {
 
 DECLARE_string(database_path);
 
+FLAG(string,
+     ephemeral_snapshot,
+     "",
+     "Path to restore and save the ephemeral database contents");
+
+/// Keys within a domain are spread over shards, each with a reader lock.
+const size_t kEphemeralShards = 16;
+
+/// The first bytes of an ephemeral database snapshot.
+const std::string kEphemeralSnapshotMagic = "osquery.ephemeral.1\n";
+
 class EphemeralDatabasePlugin : public DatabasePlugin {
-  using DBType = std::map<std::string, std::map<std::string, std::string> >;
+  /// A sorted subset of a domain's keys.
+  struct Shard {
+    mutable ReadWriteMutex mutex;
+    std::map<std::string, std::string> values;
+  };
+
+  /// A domain's shards, selected by a hash of the key.
+  struct Domain {
+    std::array<Shard, kEphemeralShards> shards;
+
+    Shard& shard(const std::string& key) {
+      return shards[std::hash<std::string>()(key) % kEphemeralShards];
+    }
+
+    const Shard& shard(const std::string& key) const {
+      return shards[std::hash<std::string>()(key) % kEphemeralShards];
+    }
+  };
+
+  using DBType = std::map<std::string, std::shared_ptr<Domain>>;
 
  public:
   /// Data retrieval method.
@@ -38,63 +86,367 @@ class EphemeralDatabasePlugin : public DatabasePlugin {
               const std::string& prefix,
               size_t max = 0) const override;
 
+  /// Batched data retrieval method.
+  Status getMany(const std::string& domain,
+                 const std::vector<std::string>& keys,
+                 DatabaseValues& values) const override;
+
+  /// Batched data storage method, locking each shard once.
+  Status putMany(const std::string& domain,
+                 const DatabaseValues& values) override;
+
+  /// Key/index lookup method returning values.
+  Status scanValues(const std::string& domain,
+                    DatabaseValues& results,
+                    const std::string& prefix,
+                    size_t max = 0) const override;
+
  public:
   /// Database workflow: open and setup.
-  Status setUp() override {
-    DBType().swap(db_);
-    return Status(0);
-  }
+  Status setUp() override;
+
+  /// Database workflow: save a snapshot if requested.
+  void tearDown() override;
+
+  /// Write the contents of every domain to a snapshot file.
+  Status saveSnapshot(const std::string& path) const;
+
+  /// Replace the contents of every domain with a snapshot file.
+  Status loadSnapshot(const std::string& path);
 
  private:
+  /// Find a domain, nullptr if nothing was stored within it.
+  std::shared_ptr<Domain> getDomain(const std::string& domain) const;
+
+  /// Find or create a domain.
+  std::shared_ptr<Domain> getOrCreateDomain(const std::string& domain);
+
+  /// Collect the sorted keys, and optionally values, beginning with a prefix.
+  void scanInternal(const std::string& domain,
+                    const std::string& prefix,
+                    size_t max,
+                    bool values,
+                    DatabaseValues& results) const;
+
+  /// Restore the records of a snapshot's contents.
+  Status parseSnapshot(const char* data, size_t size);
+
+ private:
+  /// Domains are shared such that a caller may use one replaced by setUp.
   DBType db_;
+
+  /// Protects the domain map, not the domain contents.
+  mutable ReadWriteMutex domains_mutex_;
 };
 
 /// Backing-storage provider for osquery internal/core.
 REGISTER_INTERNAL(EphemeralDatabasePlugin, "database", "ephemeral");
 
+Status EphemeralDatabasePlugin::setUp() {
+  {
+    ExclusiveLock lock(domains_mutex_);
+    DBType().swap(db_);
+  }
+
+  if (!FLAGS_ephemeral_snapshot.empty() &&
+      pathExists(FLAGS_ephemeral_snapshot).ok()) {
+    auto status = loadSnapshot(FLAGS_ephemeral_snapshot);
+    if (!status.ok()) {
+      LOG(WARNING) << "Cannot restore ephemeral database: " << status.what();
+    }
+  }
+  return Status(0);
+}
+
+void EphemeralDatabasePlugin::tearDown() {
+  if (!FLAGS_ephemeral_snapshot.empty()) {
+    auto status = saveSnapshot(FLAGS_ephemeral_snapshot);
+    if (!status.ok()) {
+      LOG(WARNING) << "Cannot save ephemeral database: " << status.what();
+    }
+  }
+}
+
+std::shared_ptr<EphemeralDatabasePlugin::Domain>
+EphemeralDatabasePlugin::getDomain(const std::string& domain) const {
+  ReadLock lock(domains_mutex_);
+  auto it = db_.find(domain);
+  return (it == db_.end()) ? nullptr : it->second;
+}
+
+std::shared_ptr<EphemeralDatabasePlugin::Domain>
+EphemeralDatabasePlugin::getOrCreateDomain(const std::string& domain) {
+  {
+    ReadLock lock(domains_mutex_);
+    auto it = db_.find(domain);
+    if (it != db_.end()) {
+      return it->second;
+    }
+  }
+
+  ExclusiveLock lock(domains_mutex_);
+  auto& entry = db_[domain];
+  if (entry == nullptr) {
+    entry = std::make_shared<Domain>();
+  }
+  return entry;
+}
+
 Status EphemeralDatabasePlugin::get(const std::string& domain,
                                     const std::string& key,
                                     std::string& value) const {
-  if (db_.count(domain) > 0 && db_.at(domain).count(key) > 0) {
-    value = db_.at(domain).at(key);
-    return Status(0);
-  } else {
+  auto d = getDomain(domain);
+  if (d == nullptr) {
     return Status(1);
   }
+
+  const auto& shard = d->shard(key);
+  ReadLock lock(shard.mutex);
+  auto it = shard.values.find(key);
+  if (it == shard.values.end()) {
+    return Status(1);
+  }
+  value = it->second;
+  return Status(0);
 }
 
 Status EphemeralDatabasePlugin::put(const std::string& domain,
                                     const std::string& key,
                                     const std::string& value) {
-  db_[domain][key] = value;
+  auto d = getOrCreateDomain(domain);
+  auto& shard = d->shard(key);
+  ExclusiveLock lock(shard.mutex);
+  shard.values[key] = value;
   return Status(0);
 }
 
 Status EphemeralDatabasePlugin::remove(const std::string& domain,
                                        const std::string& k) {
-  db_[domain].erase(k);
+  auto d = getDomain(domain);
+  if (d != nullptr) {
+    auto& shard = d->shard(k);
+    ExclusiveLock lock(shard.mutex);
+    shard.values.erase(k);
+  }
   return Status(0);
 }
 
+void EphemeralDatabasePlugin::scanInternal(const std::string& domain,
+                                           const std::string& prefix,
+                                           size_t max,
+                                           bool values,
+                                           DatabaseValues& results) const {
+  auto d = getDomain(domain);
+  if (d == nullptr) {
+    return;
+  }
+
+  // Each shard is sorted, collect at most max keys from each then merge.
+  DatabaseValues found;
+  for (const auto& shard : d->shards) {
+    ReadLock lock(shard.mutex);
+    size_t count = 0;
+    for (auto it = shard.values.lower_bound(prefix); it != shard.values.end();
+         ++it) {
+      if (it->first.compare(0, prefix.size(), prefix) != 0) {
+        break;
+      }
+      found.push_back(std::make_pair(
+          it->first, (values) ? it->second : std::string()));
+      if (max > 0 && ++count >= max) {
+        break;
+      }
+    }
+  }
+
+  std::sort(found.begin(),
+            found.end(),
+            [](const std::pair<std::string, std::string>& left,
+               const std::pair<std::string, std::string>& right) {
+              return left.first < right.first;
+            });
+  if (max > 0 && found.size() > max) {
+    found.resize(max);
+  }
+
+  results.reserve(results.size() + found.size());
+  std::move(found.begin(), found.end(), std::back_inserter(results));
+}
+
 Status EphemeralDatabasePlugin::scan(const std::string& domain,
                                      std::vector<std::string>& results,
                                      const std::string& prefix,
                                      size_t max) const {
-  if (db_.count(domain) == 0) {
+  DatabaseValues found;
+  scanInternal(domain, prefix, max, false, found);
+  for (auto& key : found) {
+    results.push_back(std::move(key.first));
+  }
+  return Status(0);
+}
+
+Status EphemeralDatabasePlugin::scanValues(const std::string& domain,
+                                           DatabaseValues& results,
+                                           const std::string& prefix,
+                                           size_t max) const {
+  scanInternal(domain, prefix, max, true, results);
+  return Status(0);
+}
+
+Status EphemeralDatabasePlugin::getMany(const std::string& domain,
+                                        const std::vector<std::string>& keys,
+                                        DatabaseValues& values) const {
+  auto d = getDomain(domain);
+  if (d == nullptr) {
     return Status(0);
   }
 
-  for (const auto& key : db_.at(domain)) {
-    if (!prefix.empty() &&
-        !(std::mismatch(prefix.begin(), prefix.end(), key.first.begin())
-              .first == prefix.end())) {
+  for (const auto& key : keys) {
+    const auto& shard = d->shard(key);
+    ReadLock lock(shard.mutex);
+    auto it = shard.values.find(key);
+    if (it != shard.values.end()) {
+      values.push_back(std::make_pair(key, it->second));
+    }
+  }
+  return Status(0);
+}
+
+Status EphemeralDatabasePlugin::putMany(const std::string& domain,
+                                        const DatabaseValues& values) {
+  auto d = getOrCreateDomain(domain);
+
+  // Group the values by shard so each shard is locked once.
+  std::array<std::vector<const DatabaseValues::value_type*>, kEphemeralShards>
+      grouped;
+  for (const auto& value : values) {
+    grouped[std::hash<std::string>()(value.first) % kEphemeralShards]
+        .push_back(&value);
+  }
+
+  for (size_t i = 0; i < kEphemeralShards; i++) {
+    if (grouped[i].empty()) {
       continue;
     }
-    results.push_back(key.first);
-    if (max > 0 && results.size() >= max) {
-      break;
+
+    auto& shard = d->shards[i];
+    ExclusiveLock lock(shard.mutex);
+    for (const auto& value : grouped[i]) {
+      shard.values[value->first] = value->second;
+    }
+  }
+  return Status(0);
+}
+
+/// Append a length-prefixed string to a snapshot.
+static void appendSnapshotString(std::string& snapshot,
+                                 const std::string& value) {
+  uint32_t size = static_cast<uint32_t>(value.size());
+  snapshot.append(reinterpret_cast<const char*>(&size), sizeof(size));
+  snapshot.append(value);
+}
+
+/// Read a length-prefixed string from a snapshot, advancing the offset.
+static bool readSnapshotString(const char* data,
+                               size_t size,
+                               size_t& offset,
+                               std::string& value) {
+  uint32_t length = 0;
+  if (size - offset < sizeof(length)) {
+    return false;
+  }
+  memcpy(&length, data + offset, sizeof(length));
+  offset += sizeof(length);
+  if (size - offset < length) {
+    return false;
+  }
+  value.assign(data + offset, length);
+  offset += length;
+  return true;
+}
+
+Status EphemeralDatabasePlugin::saveSnapshot(const std::string& path) const {
+  // Records are a domain, key, and value, each prefixed by its length.
+  std::string snapshot = kEphemeralSnapshotMagic;
+  {
+    ReadLock lock(domains_mutex_);
+    for (const auto& domain : db_) {
+      for (const auto& shard : domain.second->shards) {
+        ReadLock shard_lock(shard.mutex);
+        for (const auto& value : shard.values) {
+          appendSnapshotString(snapshot, domain.first);
+          appendSnapshotString(snapshot, value.first);
+          appendSnapshotString(snapshot, value.second);
+        }
+      }
+    }
+  }
+  return writeTextFile(path, snapshot, 0600, true);
+}
+
+Status EphemeralDatabasePlugin::parseSnapshot(const char* data, size_t size) {
+  if (size < kEphemeralSnapshotMagic.size() ||
+      memcmp(data,
+             kEphemeralSnapshotMagic.data(),
+             kEphemeralSnapshotMagic.size()) != 0) {
+    return Status(1, "Not an ephemeral database snapshot");
+  }
+
+  std::map<std::string, DatabaseValues> domains;
+  size_t offset = kEphemeralSnapshotMagic.size();
+  while (offset < size) {
+    std::string domain;
+    std::pair<std::string, std::string> value;
+    if (!readSnapshotString(data, size, offset, domain) ||
+        !readSnapshotString(data, size, offset, value.first) ||
+        !readSnapshotString(data, size, offset, value.second)) {
+      return Status(1, "Truncated ephemeral database snapshot");
     }
+    domains[domain].push_back(std::move(value));
+  }
+
+  for (const auto& domain : domains) {
+    putMany(domain.first, domain.second);
   }
   return Status(0);
 }
+
+Status EphemeralDatabasePlugin::loadSnapshot(const std::string& path) {
+  {
+    ExclusiveLock lock(domains_mutex_);
+    DBType().swap(db_);
+  }
+
+#ifndef WIN32
+  // Map the snapshot rather than copying it into a buffer.
+  int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return Status(1, "Cannot open snapshot: " + path);
+  }
+
+  struct stat info;
+  if (::fstat(fd, &info) != 0 || info.st_size <= 0) {
+    ::close(fd);
+    return Status(1, "Cannot read snapshot: " + path);
+  }
+
+  auto size = static_cast<size_t>(info.st_size);
+  auto data = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (data == MAP_FAILED) {
+    return Status(1, "Cannot map snapshot: " + path);
+  }
+
+  auto status = parseSnapshot(static_cast<const char*>(data), size);
+  ::munmap(data, size);
+  return status;
+#else
+  std::string content;
+  auto status = readFile(path, content);
+  if (!status.ok()) {
+    return status;
+  }
+  return parseSnapshot(content.data(), content.size());
+#endif
+}
 }
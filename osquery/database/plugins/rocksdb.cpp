@@ -8,25 +8,75 @@
  *
  */
 
+#include <map>
 #include <mutex>
 
 #include <sys/stat.h>
 
 #include <snappy.h>
 
+#include <rocksdb/cache.h>
+#include <rocksdb/compaction_filter.h>
 #include <rocksdb/db.h>
 #include <rocksdb/env.h>
+#include <rocksdb/filter_policy.h>
 #include <rocksdb/options.h>
+#include <rocksdb/slice_transform.h>
+#include <rocksdb/statistics.h>
+#include <rocksdb/table.h>
+#include <rocksdb/write_batch.h>
 
 #include <osquery/database.h>
 #include <osquery/filesystem.h>
+#include <osquery/flags.h>
 #include <osquery/logger.h>
+#include <osquery/system.h>
 
 #include "osquery/filesystem/fileops.h"
 
 namespace osquery {
 
 DECLARE_string(database_path);
+DECLARE_uint64(buffered_log_expiry);
+
+FLAG(string,
+     rocksdb_profile,
+     "default",
+     "RocksDB tuning profile: small, default, or high_throughput");
+
+FLAG(bool,
+     rocksdb_compression,
+     false,
+     "Compress the RocksDB events and logs domains with LZ4");
+
+FLAG(bool,
+     rocksdb_statistics,
+     false,
+     "Collect RocksDB statistics, reported by osquery_rocksdb_stats");
+
+#ifdef WIN32
+/// The Windows RocksDB build does not include LZ4.
+const rocksdb::CompressionType kRocksDBCompression = rocksdb::kSnappyCompression;
+#else
+const rocksdb::CompressionType kRocksDBCompression = rocksdb::kLZ4Compression;
+#endif
+
+/// Integer properties reported for each domain by osquery_rocksdb_stats.
+const std::vector<std::string> kRocksDBProperties = {
+    "rocksdb.num-files-at-level0",
+    "rocksdb.num-immutable-mem-table",
+    "rocksdb.cur-size-all-mem-tables",
+    "rocksdb.estimate-num-keys",
+    "rocksdb.estimate-live-data-size",
+    "rocksdb.total-sst-files-size",
+    "rocksdb.compaction-pending",
+    "rocksdb.num-running-compactions",
+    "rocksdb.num-running-flushes",
+    "rocksdb.estimate-pending-compaction-bytes",
+    "rocksdb.is-write-stopped",
+    "rocksdb.actual-delayed-write-rate",
+    "rocksdb.background-errors",
+};
 
 class GlogRocksDBLogger : public rocksdb::Logger {
  public:
@@ -35,6 +85,228 @@ class GlogRocksDBLogger : public rocksdb::Logger {
   void Logv(const char* format, va_list ap) override;
 };
 
+/**
+ * @brief A key prefix through a number of separators.
+ *
+ * Event keys are namespaced as "data.<publisher>.<subscriber>.<eid>" and
+ * buffered log keys as "<name>_r_<time>_<index>". Keys are grouped, for
+ * prefix bloom filters, by their leading separated tokens. A key with fewer
+ * separators is its own prefix.
+ */
+class SeparatorPrefixTransform : public rocksdb::SliceTransform {
+ public:
+  SeparatorPrefixTransform(char separator, size_t count)
+      : separator_(separator),
+        count_(count),
+        name_(std::string("osquery.SeparatorPrefix.") + separator +
+              std::to_string(count)) {}
+
+  const char* Name() const override {
+    return name_.c_str();
+  }
+
+  rocksdb::Slice Transform(const rocksdb::Slice& key) const override {
+    return rocksdb::Slice(key.data(), prefixSize(key));
+  }
+
+  bool InDomain(const rocksdb::Slice& /* key */) const override {
+    return true;
+  }
+
+  bool InRange(const rocksdb::Slice& /* dst */) const override {
+    return true;
+  }
+
+  /// Check if every key beginning with a scan prefix shares its transform.
+  bool isPrefix(const rocksdb::Slice& prefix) const {
+    return separators(prefix) == count_;
+  }
+
+ private:
+  /// The size of the key through the last counted separator.
+  size_t prefixSize(const rocksdb::Slice& key) const {
+    size_t found = 0;
+    for (size_t i = 0; i < key.size(); i++) {
+      if (key[i] == separator_ && ++found == count_) {
+        return i + 1;
+      }
+    }
+    return key.size();
+  }
+
+  /// The number of separators, up to the counted separators.
+  size_t separators(const rocksdb::Slice& key) const {
+    size_t found = 0;
+    for (size_t i = 0; i < key.size() && found < count_; i++) {
+      found += (key[i] == separator_) ? 1 : 0;
+    }
+    return found;
+  }
+
+ private:
+  char separator_;
+  size_t count_;
+  std::string name_;
+};
+
+/**
+ * @brief The expiration times of event subscribers.
+ *
+ * An event subscriber writes "expire.<publisher>.<subscriber>" when it expires
+ * events older than a time. The times are kept for compaction filters, which
+ * cannot read the database.
+ */
+class EventExpirations {
+ public:
+  /// Record an expiration key and time written to the events domain.
+  void set(const std::string& key, const std::string& value) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    times_[key.substr(kPrefix.size())] = std::strtoull(value.c_str(), 0, 10);
+  }
+
+  /// A copy of the expiration times, keyed by subscriber namespace.
+  std::map<std::string, size_t> get() const {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return times_;
+  }
+
+  /// Check if an events domain key is an expiration time.
+  static bool isExpiration(const std::string& key) {
+    return key.compare(0, kPrefix.size(), kPrefix) == 0;
+  }
+
+ private:
+  static const std::string kPrefix;
+
+  std::map<std::string, size_t> times_;
+  mutable std::mutex mutex_;
+};
+
+const std::string EventExpirations::kPrefix = "expire.";
+
+/**
+ * @brief Drop expired event data and buffered logs during compaction.
+ *
+ * Event data, "data.<publisher>.<subscriber>.<eid>", is dropped when the row's
+ * time is at or before its subscriber's expiration time. Buffered logs,
+ * "<name>_<r|s>_<time>_<index>", are dropped when older than
+ * `--buffered_log_expiry` seconds.
+ */
+class ExpiryCompactionFilter : public rocksdb::CompactionFilter {
+ public:
+  ExpiryCompactionFilter(const std::string& domain,
+                         size_t now,
+                         std::map<std::string, size_t> expirations)
+      : domain_(domain), now_(now), expirations_(std::move(expirations)) {}
+
+  const char* Name() const override {
+    return "osquery.ExpiryCompactionFilter";
+  }
+
+  bool Filter(int /* level */,
+              const rocksdb::Slice& key,
+              const rocksdb::Slice& existing_value,
+              std::string* /* new_value */,
+              bool* /* value_changed */) const override {
+    if (domain_ == kEvents) {
+      return isEventExpired(key, existing_value);
+    }
+    return isLogExpired(key);
+  }
+
+ private:
+  bool isEventExpired(const rocksdb::Slice& key,
+                      const rocksdb::Slice& value) const {
+    if (expirations_.empty() || !key.starts_with("data.")) {
+      return false;
+    }
+
+    // The namespace is between the "data." type and the trailing EID.
+    std::string ns(key.data() + 5, key.size() - 5);
+    auto eid = ns.rfind('.');
+    if (eid == std::string::npos) {
+      return false;
+    }
+    ns.resize(eid);
+
+    auto expiration = expirations_.find(ns);
+    if (expiration == expirations_.end()) {
+      return false;
+    }
+
+    // Rows are compact JSON objects, the string values quote embedded quotes.
+    static const std::string kTime = "\"time\":\"";
+    std::string row(value.data(), value.size());
+    auto time = row.find(kTime);
+    if (time == std::string::npos) {
+      return false;
+    }
+    return parseTime(row, time + kTime.size()) <= expiration->second;
+  }
+
+  bool isLogExpired(const rocksdb::Slice& key) const {
+    if (FLAGS_buffered_log_expiry == 0) {
+      return false;
+    }
+
+    // The time is the second to last token, the forwarder name may contain
+    // separators.
+    std::string index(key.data(), key.size());
+    auto last = index.rfind('_');
+    if (last == std::string::npos || last == 0) {
+      return false;
+    }
+    auto time = index.rfind('_', last - 1);
+    if (time == std::string::npos) {
+      return false;
+    }
+
+    auto logged = parseTime(index, time + 1);
+    return logged > 0 && logged + FLAGS_buffered_log_expiry < now_;
+  }
+
+  /// Parse the decimal digits beginning at an offset, 0 if there are none.
+  static size_t parseTime(const std::string& content, size_t offset) {
+    size_t time = 0;
+    for (size_t i = offset; i < content.size(); i++) {
+      if (content[i] < '0' || content[i] > '9') {
+        break;
+      }
+      time = time * 10 + (content[i] - '0');
+    }
+    return time;
+  }
+
+ private:
+  std::string domain_;
+  size_t now_;
+  std::map<std::string, size_t> expirations_;
+};
+
+/// Create an ExpiryCompactionFilter, with the current time, per compaction.
+class ExpiryCompactionFilterFactory : public rocksdb::CompactionFilterFactory {
+ public:
+  ExpiryCompactionFilterFactory(
+      const std::string& domain,
+      std::shared_ptr<const EventExpirations> expirations)
+      : domain_(domain), expirations_(std::move(expirations)) {}
+
+  std::unique_ptr<rocksdb::CompactionFilter> CreateCompactionFilter(
+      const rocksdb::CompactionFilter::Context& /* context */) override {
+    auto now = static_cast<size_t>(getUnixTime());
+    return std::unique_ptr<rocksdb::CompactionFilter>(
+        new ExpiryCompactionFilter(domain_, now, expirations_->get()));
+  }
+
+  const char* Name() const override {
+    return "osquery.ExpiryCompactionFilterFactory";
+  }
+
+ private:
+  std::string domain_;
+  std::shared_ptr<const EventExpirations> expirations_;
+};
+
 class RocksDBDatabasePlugin : public DatabasePlugin {
  public:
   /// Data retrieval method.
@@ -56,6 +328,24 @@ class RocksDBDatabasePlugin : public DatabasePlugin {
               const std::string& prefix,
               size_t max = 0) const override;
 
+  /// Batched data retrieval method using MultiGet.
+  Status getMany(const std::string& domain,
+                 const std::vector<std::string>& keys,
+                 DatabaseValues& values) const override;
+
+  /// Batched data storage method using a single WriteBatch.
+  Status putMany(const std::string& domain,
+                 const DatabaseValues& values) override;
+
+  /// Key/index lookup method that reads values from the iterator.
+  Status scanValues(const std::string& domain,
+                    DatabaseValues& results,
+                    const std::string& prefix,
+                    size_t max = 0) const override;
+
+  /// Statistics tickers and the integer properties of each domain.
+  Status stats(QueryData& results) const override;
+
  public:
   /// Database workflow: open and setup.
   Status setUp() override;
@@ -74,6 +364,16 @@ class RocksDBDatabasePlugin : public DatabasePlugin {
   /// Obtain a close lock and release resources.
   void close();
 
+  /// Apply the `--rocksdb_profile` to the connection and table options.
+  void applyProfile(rocksdb::BlockBasedTableOptions& table_options);
+
+  /// The options for the column family storing a domain.
+  rocksdb::ColumnFamilyOptions getDomainOptions(const std::string& domain);
+
+  /// Read options for iterating the keys within a domain beginning with prefix.
+  rocksdb::ReadOptions getScanOptions(const std::string& domain,
+                                      const std::string& prefix) const;
+
   /**
    * @brief Private helper around accessing the column family handle for a
    * specific column family, based on its name
@@ -107,6 +407,14 @@ class RocksDBDatabasePlugin : public DatabasePlugin {
   /// The RocksDB connection options that are used to connect to RocksDB
   rocksdb::Options options_;
 
+  /// Event subscriber expiration times, read by the events compaction filter.
+  std::shared_ptr<EventExpirations> expirations_{
+      std::make_shared<EventExpirations>()};
+
+  /// Key prefix transforms of the domains using prefix bloom filters.
+  std::map<std::string, std::shared_ptr<const SeparatorPrefixTransform>>
+      prefixes_;
+
   /// Deconstruction mutex.
   std::mutex close_mutex_;
 };
@@ -146,7 +454,8 @@ Status RocksDBDatabasePlugin::setUp() {
 
   if (!initialized_) {
     initialized_ = true;
-    options_.OptimizeForSmallDb();
+    rocksdb::BlockBasedTableOptions table_options;
+    applyProfile(table_options);
 
     // Set meta-data (mostly) handling options.
     options_.create_if_missing = true;
@@ -160,13 +469,15 @@ Status RocksDBDatabasePlugin::setUp() {
     // Performance and optimization settings.
     options_.compression = rocksdb::kNoCompression;
     options_.compaction_style = rocksdb::kCompactionStyleLevel;
-    options_.arena_block_size = (4 * 1024);
-    options_.write_buffer_size = (4 * 1024) * 100; // 100 blocks.
-    options_.max_write_buffer_number = 4;
-    options_.min_write_buffer_number_to_merge = 1;
-    // Before adding the OptimizeForSmallDB API call we used:
-    //   options_.max_background_compactions = 2;
-    //   options_.max_background_flushes = 2;
+
+    // Every domain uses whole key bloom filters for point lookups.
+    table_options.filter_policy.reset(rocksdb::NewBloomFilterPolicy(10, false));
+    options_.table_factory.reset(
+        rocksdb::NewBlockBasedTableFactory(table_options));
+
+    if (FLAGS_rocksdb_statistics) {
+      options_.statistics = rocksdb::CreateDBStatistics();
+    }
 
     // Create an environment to replace the default logger.
     if (logger_ == nullptr) {
@@ -175,11 +486,15 @@ Status RocksDBDatabasePlugin::setUp() {
     options_.info_log = logger_;
 
     column_families_.push_back(rocksdb::ColumnFamilyDescriptor(
-        rocksdb::kDefaultColumnFamilyName, options_));
+        rocksdb::kDefaultColumnFamilyName, getDomainOptions(kDomains[0])));
 
-    for (const auto& cf_name : kDomains) {
-      column_families_.push_back(
-          rocksdb::ColumnFamilyDescriptor(cf_name, options_));
+    // The handle for a domain is the handle at the domain's index, which is
+    // the column family preceding the domain's name, see
+    // getHandleForColumnFamily. Options follow the domain using the handle.
+    for (size_t i = 0; i < kDomains.size(); i++) {
+      auto domain = (i + 1 < kDomains.size()) ? kDomains[i + 1] : "";
+      column_families_.push_back(rocksdb::ColumnFamilyDescriptor(
+          kDomains[i], getDomainOptions(domain)));
     }
   }
 
@@ -223,6 +538,14 @@ Status RocksDBDatabasePlugin::setUp() {
     read_only_ = true;
   }
 
+  // Compaction filters need the expiration times written by previous runs.
+  DatabaseValues expirations;
+  if (db_ != nullptr && scanValues(kEvents, expirations, "expire.").ok()) {
+    for (const auto& expiration : expirations) {
+      expirations_->set(expiration.first, expiration.second);
+    }
+  }
+
   // RocksDB may not create/append a directory with acceptable permissions.
   if (!read_only_ && platformChmod(path_, S_IRWXU) == false) {
     return Status(1, "Cannot set permissions on RocksDB path: " + path_);
@@ -230,6 +553,98 @@ Status RocksDBDatabasePlugin::setUp() {
   return Status(0);
 }
 
+void RocksDBDatabasePlugin::applyProfile(
+    rocksdb::BlockBasedTableOptions& table_options) {
+  auto profile = FLAGS_rocksdb_profile;
+  if (profile != "small" && profile != "default" &&
+      profile != "high_throughput") {
+    LOG(WARNING) << "Unknown RocksDB profile: " << profile;
+    profile = "default";
+  }
+
+  if (profile == "small") {
+    // Minimize memory, the database flushes and compacts often.
+    options_.OptimizeForSmallDb();
+    options_.arena_block_size = (4 * 1024);
+    options_.write_buffer_size = (4 * 1024) * 100; // 100 blocks.
+    options_.max_write_buffer_number = 4;
+    options_.min_write_buffer_number_to_merge = 1;
+    table_options.block_cache = rocksdb::NewLRUCache(1 * 1024 * 1024);
+  } else if (profile == "default") {
+    // Larger write buffers avoid a flush, and level 0 file, for each burst of
+    // events; a second background thread compacts while flushing. The write
+    // buffers of all domains are bounded to stay within the watchdog limit.
+    options_.OptimizeForSmallDb();
+    options_.IncreaseParallelism(2);
+    options_.max_background_compactions = 1;
+    options_.max_background_flushes = 1;
+    options_.db_write_buffer_size = 8 * 1024 * 1024;
+    options_.write_buffer_size = 4 * 1024 * 1024;
+    options_.max_write_buffer_number = 4;
+    options_.min_write_buffer_number_to_merge = 1;
+    options_.level0_file_num_compaction_trigger = 4;
+    table_options.block_cache = rocksdb::NewLRUCache(8 * 1024 * 1024);
+  } else {
+    // Busy event publishers: merge buffers before flushing, allow more level
+    // 0 files before compacting, and compact in parallel.
+    options_.IncreaseParallelism(4);
+    options_.max_background_compactions = 3;
+    options_.max_background_flushes = 1;
+    options_.db_write_buffer_size = 64 * 1024 * 1024;
+    options_.write_buffer_size = 16 * 1024 * 1024;
+    options_.max_write_buffer_number = 6;
+    options_.min_write_buffer_number_to_merge = 2;
+    options_.level0_file_num_compaction_trigger = 8;
+    options_.target_file_size_base = 16 * 1024 * 1024;
+    options_.max_bytes_for_level_base = 128 * 1024 * 1024;
+    options_.bytes_per_sync = 1024 * 1024;
+    table_options.block_cache = rocksdb::NewLRUCache(32 * 1024 * 1024);
+  }
+}
+
+rocksdb::ColumnFamilyOptions RocksDBDatabasePlugin::getDomainOptions(
+    const std::string& domain) {
+  rocksdb::ColumnFamilyOptions options(options_);
+  std::shared_ptr<const SeparatorPrefixTransform> prefix{nullptr};
+  if (domain == kEvents) {
+    // Events are scanned by "<type>.<publisher>.<subscriber>".
+    prefix = std::make_shared<SeparatorPrefixTransform>('.', 2);
+  } else if (domain == kLogs) {
+    // Buffered logs are scanned by "<name>_<r|s>_".
+    prefix = std::make_shared<SeparatorPrefixTransform>('_', 1);
+  }
+
+  if (prefix != nullptr) {
+    // Expired events and logs are dropped when compacted.
+    options.compaction_filter_factory =
+        std::make_shared<ExpiryCompactionFilterFactory>(domain, expirations_);
+    prefixes_[domain] = prefix;
+    options.prefix_extractor = prefix;
+    if (FLAGS_rocksdb_compression) {
+      // Keep the frequently rewritten first levels uncompressed.
+      options.compression_per_level.assign(options.num_levels,
+                                           kRocksDBCompression);
+      options.compression_per_level[0] = rocksdb::kNoCompression;
+      options.compression_per_level[1] = rocksdb::kNoCompression;
+    }
+  }
+  return options;
+}
+
+rocksdb::ReadOptions RocksDBDatabasePlugin::getScanOptions(
+    const std::string& domain, const std::string& prefix) const {
+  auto options = rocksdb::ReadOptions();
+  options.verify_checksums = false;
+  options.fill_cache = false;
+
+  // Prefix bloom filters apply when every key within the scan shares the
+  // prefix transform, otherwise the scan must seek the complete key order.
+  auto transform = prefixes_.find(domain);
+  options.total_order_seek =
+      (transform == prefixes_.end() || !transform->second->isPrefix(prefix));
+  return options;
+}
+
 void RocksDBDatabasePlugin::close() {
   std::unique_lock<std::mutex> lock(close_mutex_);
   for (auto handle : handles_) {
@@ -293,6 +708,9 @@ Status RocksDBDatabasePlugin::put(const std::string& domain,
     options.sync = true;
   }
   auto s = getDB()->Put(options, cfh, key, value);
+  if (s.ok() && kEvents == domain && EventExpirations::isExpiration(key)) {
+    expirations_->set(key, value);
+  }
   if (s.code() != 0 && s.IsIOError()) {
     // An error occurred, check if it is an IO error and remove the offending
     // specific filename or log name.
@@ -338,25 +756,147 @@ Status RocksDBDatabasePlugin::scan(const std::string& domain,
   if (cfh == nullptr) {
     return Status(1, "Could not get column family for " + domain);
   }
-  auto options = rocksdb::ReadOptions();
-  options.verify_checksums = false;
-  options.fill_cache = false;
-  auto it = getDB()->NewIterator(options, cfh);
+  auto it = getDB()->NewIterator(getScanOptions(domain, prefix), cfh);
   if (it == nullptr) {
     return Status(1, "Could not get iterator for " + domain);
   }
 
+  // Keys are ordered, every key with the prefix follows a seek to the prefix.
   size_t count = 0;
-  for (it->SeekToFirst(); it->Valid(); it->Next()) {
-    auto key = it->key().ToString();
-    if (key.find(prefix) == 0) {
-      results.push_back(std::move(key));
-      if (max > 0 && ++count >= max) {
-        break;
+  for (it->Seek(prefix); it->Valid(); it->Next()) {
+    if (!it->key().starts_with(prefix)) {
+      break;
+    }
+    results.push_back(it->key().ToString());
+    if (max > 0 && ++count >= max) {
+      break;
+    }
+  }
+  delete it;
+  return Status(0, "OK");
+}
+
+Status RocksDBDatabasePlugin::getMany(const std::string& domain,
+                                      const std::vector<std::string>& keys,
+                                      DatabaseValues& values) const {
+  if (getDB() == nullptr) {
+    return Status(1, "Database not opened");
+  }
+
+  auto cfh = getHandleForColumnFamily(domain);
+  if (cfh == nullptr) {
+    return Status(1, "Could not get column family for " + domain);
+  }
+
+  std::vector<rocksdb::Slice> slices(keys.begin(), keys.end());
+  std::vector<rocksdb::ColumnFamilyHandle*> handles(keys.size(), cfh);
+  std::vector<std::string> results;
+  auto statuses =
+      getDB()->MultiGet(rocksdb::ReadOptions(), handles, slices, &results);
+  for (size_t i = 0; i < statuses.size(); i++) {
+    if (statuses[i].ok()) {
+      values.push_back(std::make_pair(keys[i], std::move(results[i])));
+    } else if (!statuses[i].IsNotFound()) {
+      return Status(statuses[i].code(), statuses[i].ToString());
+    }
+  }
+  return Status(0, "OK");
+}
+
+Status RocksDBDatabasePlugin::putMany(const std::string& domain,
+                                      const DatabaseValues& values) {
+  if (read_only_) {
+    return Status(0, "Database in readonly mode");
+  }
+
+  auto cfh = getHandleForColumnFamily(domain);
+  if (cfh == nullptr) {
+    return Status(1, "Could not get column family for " + domain);
+  }
+
+  rocksdb::WriteBatch batch;
+  for (const auto& value : values) {
+    batch.Put(cfh, value.first, value.second);
+  }
+
+  // The batch is written atomically, with a single sync.
+  auto options = rocksdb::WriteOptions();
+  if (kEvents != domain) {
+    options.sync = true;
+  }
+  auto s = getDB()->Write(options, &batch);
+  if (s.ok() && kEvents == domain) {
+    for (const auto& value : values) {
+      if (EventExpirations::isExpiration(value.first)) {
+        expirations_->set(value.first, value.second);
       }
     }
   }
+  return Status(s.code(), s.ToString());
+}
+
+Status RocksDBDatabasePlugin::scanValues(const std::string& domain,
+                                         DatabaseValues& results,
+                                         const std::string& prefix,
+                                         size_t max) const {
+  if (getDB() == nullptr) {
+    return Status(1, "Database not opened");
+  }
+
+  auto cfh = getHandleForColumnFamily(domain);
+  if (cfh == nullptr) {
+    return Status(1, "Could not get column family for " + domain);
+  }
+  auto it = getDB()->NewIterator(getScanOptions(domain, prefix), cfh);
+  if (it == nullptr) {
+    return Status(1, "Could not get iterator for " + domain);
+  }
+
+  size_t count = 0;
+  for (it->Seek(prefix); it->Valid(); it->Next()) {
+    if (!it->key().starts_with(prefix)) {
+      break;
+    }
+    results.push_back(
+        std::make_pair(it->key().ToString(), it->value().ToString()));
+    if (max > 0 && ++count >= max) {
+      break;
+    }
+  }
   delete it;
   return Status(0, "OK");
 }
+
+Status RocksDBDatabasePlugin::stats(QueryData& results) const {
+  if (getDB() == nullptr) {
+    return Status(1, "Database not opened");
+  }
+
+  if (options_.statistics != nullptr) {
+    for (const auto& ticker : rocksdb::TickersNameMap) {
+      results.push_back(
+          {{"domain", ""},
+           {"name", ticker.second},
+           {"value",
+            std::to_string(options_.statistics->getTickerCount(ticker.first))}});
+    }
+  }
+
+  for (const auto& domain : kDomains) {
+    auto cfh = getHandleForColumnFamily(domain);
+    if (cfh == nullptr) {
+      continue;
+    }
+
+    for (const auto& property : kRocksDBProperties) {
+      uint64_t value = 0;
+      if (getDB()->GetIntProperty(cfh, property, &value)) {
+        results.push_back({{"domain", domain},
+                           {"name", property},
+                           {"value", std::to_string(value)}});
+      }
+    }
+  }
+  return Status(0, "OK");
+}
 }
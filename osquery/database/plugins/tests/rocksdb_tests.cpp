@@ -31,4 +31,64 @@ TEST_F(RocksDBDatabasePluginTests, test_rocksdb_loglevel) {
   auto details = SQL::selectAllFrom("file", "path", EQUALS, path_ + "/LOG");
   ASSERT_EQ(details.size(), 0U);
 }
+
+TEST_F(RocksDBDatabasePluginTests, test_rocksdb_prefix_scan) {
+  auto plugin = std::dynamic_pointer_cast<DatabasePlugin>(
+      Registry::get("database", "rocksdb"));
+  ASSERT_NE(plugin, nullptr);
+
+  // Event keys share prefix bloom filters through the second separator.
+  plugin->put(kEvents, "data.pub.sub.1", "");
+  plugin->put(kEvents, "data.pub.sub2.1", "");
+  plugin->put(kEvents, "data.pub2.sub.1", "");
+  plugin->put(kEvents, "eid.pub.sub", "");
+
+  std::vector<std::string> keys;
+  plugin->scan(kEvents, keys, "data.pub.sub.");
+  EXPECT_EQ(keys.size(), 1U);
+
+  // A scan within a single prefix.
+  keys.clear();
+  plugin->scan(kEvents, keys, "data.pub.sub");
+  EXPECT_EQ(keys.size(), 2U);
+
+  // Scans shorter than a prefix seek the complete key order.
+  keys.clear();
+  plugin->scan(kEvents, keys, "data.");
+  EXPECT_EQ(keys.size(), 3U);
+  keys.clear();
+  plugin->scan(kEvents, keys, "");
+  EXPECT_EQ(keys.size(), 4U);
+
+  // Buffered log keys share prefixes through the first separator.
+  plugin->put(kLogs, "name_r_1_1", "");
+  plugin->put(kLogs, "name_s_1_2", "");
+  plugin->put(kLogs, "other_r_1_3", "");
+  keys.clear();
+  plugin->scan(kLogs, keys, "name_r_");
+  EXPECT_EQ(keys.size(), 1U);
+  keys.clear();
+  plugin->scan(kLogs, keys, "name");
+  EXPECT_EQ(keys.size(), 2U);
+}
+
+TEST_F(RocksDBDatabasePluginTests, test_rocksdb_stats) {
+  auto plugin = std::dynamic_pointer_cast<DatabasePlugin>(
+      Registry::get("database", "rocksdb"));
+  ASSERT_NE(plugin, nullptr);
+  plugin->put(kEvents, "data.pub.sub.1", "");
+
+  QueryData results;
+  EXPECT_TRUE(plugin->stats(results).ok());
+
+  // Each domain reports its integer properties.
+  bool found = false;
+  for (const auto& row : results) {
+    if (row.at("domain") == kEvents &&
+        row.at("name") == "rocksdb.estimate-num-keys") {
+      found = true;
+    }
+  }
+  EXPECT_TRUE(found);
+}
 }
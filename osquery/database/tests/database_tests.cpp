@@ -56,6 +56,50 @@ TEST_F(DatabaseTests, test_scan_values) {
   EXPECT_EQ(keys.size(), 2U);
 }
 
+TEST_F(DatabaseTests, test_bulk_values) {
+  auto s = setDatabaseValues(kLogs, {{"bulk.1", "a"}, {"bulk.2", "b"}});
+  EXPECT_TRUE(s.ok());
+
+  DatabaseValues values;
+  s = getDatabaseValues(kLogs, {"bulk.1", "bulk.none", "bulk.2"}, values);
+  EXPECT_TRUE(s.ok());
+  ASSERT_EQ(values.size(), 2U);
+  EXPECT_EQ(values[1].second, "b");
+
+  values.clear();
+  s = scanDatabaseValues(kLogs, values, "bulk.");
+  EXPECT_TRUE(s.ok());
+  EXPECT_EQ(values.size(), 2U);
+
+  // Extensions use the same actions through the database plugin call.
+  PluginResponse response;
+  s = Registry::call("database",
+                     {{"action", "putMany"},
+                      {"domain", kLogs},
+                      {"values", "[[\"bulk.3\",\"c\"]]"}},
+                     response);
+  EXPECT_TRUE(s.ok());
+
+  response.clear();
+  s = Registry::call("database",
+                     {{"action", "getMany"},
+                      {"domain", kLogs},
+                      {"keys", "[\"bulk.1\",\"bulk.3\"]"}},
+                     response);
+  EXPECT_TRUE(s.ok());
+  ASSERT_EQ(response.size(), 2U);
+  EXPECT_EQ(response[1]["k"], "bulk.3");
+  EXPECT_EQ(response[1]["v"], "c");
+
+  response.clear();
+  s = Registry::call(
+      "database",
+      {{"action", "scanValues"}, {"domain", kLogs}, {"prefix", "bulk."}},
+      response);
+  EXPECT_TRUE(s.ok());
+  EXPECT_EQ(response.size(), 3U);
+}
+
 TEST_F(DatabaseTests, test_delete_values) {
   setDatabaseValue(kLogs, "k", "0");
 
@@ -12,6 +12,8 @@
 
 namespace osquery {
 
+DECLARE_string(ephemeral_snapshot);
+
 class EphemeralDatabasePluginTests : public DatabasePluginTests {
  protected:
   std::string name() override { return "ephemeral"; }
@@ -20,6 +22,55 @@ class EphemeralDatabasePluginTests : public DatabasePluginTests {
 // Define the default set of database plugin operation tests.
 CREATE_DATABASE_TESTS(EphemeralDatabasePluginTests);
 
+TEST_F(EphemeralDatabasePluginTests, test_ephemeral_ordered_scan) {
+  auto plugin = std::dynamic_pointer_cast<DatabasePlugin>(
+      Registry::get("database", "ephemeral"));
+  ASSERT_NE(plugin, nullptr);
+
+  // Keys are spread across shards but scanned in order.
+  for (size_t i = 0; i < 100; i++) {
+    plugin->put(kEvents, "ordered." + std::to_string(1000 + i), "");
+  }
+  plugin->put(kEvents, "other.1", "");
+
+  std::vector<std::string> keys;
+  plugin->scan(kEvents, keys, "ordered.", 10);
+  ASSERT_EQ(keys.size(), 10U);
+  EXPECT_TRUE(std::is_sorted(keys.begin(), keys.end()));
+  EXPECT_EQ(keys.front(), "ordered.1000");
+  EXPECT_EQ(keys.back(), "ordered.1009");
+
+  keys.clear();
+  plugin->scan(kEvents, keys, "");
+  EXPECT_EQ(keys.size(), 101U);
+  EXPECT_TRUE(std::is_sorted(keys.begin(), keys.end()));
+}
+
+TEST_F(EphemeralDatabasePluginTests, test_ephemeral_snapshot) {
+  auto plugin = std::dynamic_pointer_cast<DatabasePlugin>(
+      Registry::get("database", "ephemeral"));
+  ASSERT_NE(plugin, nullptr);
+
+  // A reset saves the contents during tearDown and restores them in setUp.
+  auto snapshot = kTestWorkingDirectory + "ephemeral.snapshot";
+  FLAGS_ephemeral_snapshot = snapshot;
+  plugin->put(kQueries, "test_snapshot", "value");
+  plugin->put(kEvents, "test_snapshot", std::string("a\0b", 3));
+  EXPECT_TRUE(plugin->reset());
+
+  std::string value;
+  EXPECT_TRUE(plugin->get(kQueries, "test_snapshot", value));
+  EXPECT_EQ(value, "value");
+  EXPECT_TRUE(plugin->get(kEvents, "test_snapshot", value));
+  EXPECT_EQ(value, std::string("a\0b", 3));
+
+  // Without a snapshot the database is empty after a reset.
+  FLAGS_ephemeral_snapshot = "";
+  EXPECT_TRUE(plugin->reset());
+  EXPECT_FALSE(plugin->get(kQueries, "test_snapshot", value));
+  boost::filesystem::remove(snapshot);
+}
+
 void DatabasePluginTests::testPluginCheck() {
   // Do not worry about multiple set-active calls.
   // For testing purposes they should be idempotent.
@@ -85,4 +136,50 @@ void DatabasePluginTests::testScanLimit() {
   EXPECT_EQ(s.getMessage(), "OK");
   EXPECT_EQ(keys.size(), 2U);
 }
+
+void DatabasePluginTests::testGetMany() {
+  getPlugin()->put(kQueries, "test_many_1", "a");
+  getPlugin()->put(kQueries, "test_many_2", "b");
+
+  // Keys that do not exist are not returned.
+  DatabaseValues values;
+  auto s = getPlugin()->getMany(
+      kQueries, {"test_many_2", "test_many_none", "test_many_1"}, values);
+  EXPECT_TRUE(s.ok());
+  ASSERT_EQ(values.size(), 2U);
+  EXPECT_EQ(values[0].first, "test_many_2");
+  EXPECT_EQ(values[0].second, "b");
+  EXPECT_EQ(values[1].first, "test_many_1");
+  EXPECT_EQ(values[1].second, "a");
+}
+
+void DatabasePluginTests::testPutMany() {
+  auto s = getPlugin()->putMany(
+      kQueries, {{"test_put_many_1", "a"}, {"test_put_many_2", "b"}});
+  EXPECT_TRUE(s.ok());
+
+  std::string r;
+  getPlugin()->get(kQueries, "test_put_many_2", r);
+  EXPECT_EQ(r, "b");
+}
+
+void DatabasePluginTests::testScanValues() {
+  getPlugin()->put(kQueries, "test_values_1", "a");
+  getPlugin()->put(kQueries, "test_values_2", "b");
+  getPlugin()->put(kQueries, "test_other_1", "c");
+
+  DatabaseValues values;
+  auto s = getPlugin()->scanValues(kQueries, values, "test_values_");
+  EXPECT_TRUE(s.ok());
+  ASSERT_EQ(values.size(), 2U);
+  for (const auto& value : values) {
+    EXPECT_EQ(value.first.find("test_values_"), 0U);
+    EXPECT_EQ(value.second, (value.first == "test_values_1") ? "a" : "b");
+  }
+
+  values.clear();
+  s = getPlugin()->scanValues(kQueries, values, "test_values_", 1);
+  EXPECT_TRUE(s.ok());
+  EXPECT_EQ(values.size(), 1U);
+}
 }
@@ -26,7 +26,10 @@
   TEST_F(n, test_get) { testGet(); }                  \
   TEST_F(n, test_delete) { testDelete(); }            \
   TEST_F(n, test_scan) { testScan(); }                \
-  TEST_F(n, test_scan_limit) { testScanLimit(); }
+  TEST_F(n, test_scan_limit) { testScanLimit(); }     \
+  TEST_F(n, test_get_many) { testGetMany(); }         \
+  TEST_F(n, test_put_many) { testPutMany(); }         \
+  TEST_F(n, test_scan_values) { testScanValues(); }
 
 namespace osquery {
 
@@ -82,5 +85,8 @@ class DatabasePluginTests : public testing::Test {
   void testDelete();
   void testScan();
   void testScanLimit();
+  void testGetMany();
+  void testPutMany();
+  void testScanValues();
 };
 }
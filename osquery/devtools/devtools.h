@@ -10,7 +10,11 @@
 
 #pragma once
 
+#include <cstdio>
 #include <string>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
 
 #include <osquery/database.h>
 #include <osquery/flags.h>
@@ -122,4 +126,73 @@ std::string generateHeader(const std::map<std::string, size_t>& lengths,
 std::string generateRow(const Row& r,
                         const std::map<std::string, size_t>& lengths,
                         const std::vector<std::string>& columns);
+
+/**
+ * @brief Print query results while SQLite steps them.
+ *
+ * Pretty output samples the first `--pretty_sample_rows` rows to size the
+ * columns, then prints each following row immediately. Values wider than
+ * their column, or than `--pretty_max_width`, are truncated. JSON rows are
+ * written directly from the column values.
+ */
+class ResultPrinter : private boost::noncopyable {
+ public:
+  /// The supported streaming output formats.
+  enum class Format {
+    PRETTY,
+    JSON,
+  };
+
+  ResultPrinter(FILE* out, Format format) : out_(out), format_(format) {}
+
+  /// Begin a result set, the columns are in the order of printed values.
+  void begin(const std::vector<std::string>& columns);
+
+  /**
+   * @brief Print a row of a result set.
+   *
+   * @param values the column values, in column order, nullptr for NULL.
+   */
+  void print(const char* const* values);
+
+  /// End the result set, printing any sampled rows and the footer.
+  void finish();
+
+  /// The number of rows printed, or sampled, in the current result set.
+  size_t rows() const {
+    return rows_;
+  }
+
+ private:
+  /// Size the columns using the sampled rows and print them.
+  void flushSample();
+
+  /// Format a pretty row into the line buffer.
+  void formatPretty(const std::vector<std::string>& values);
+
+  /// Format a JSON object into the line buffer.
+  void formatJSON(const char* const* values);
+
+ private:
+  FILE* out_{nullptr};
+  Format format_{Format::PRETTY};
+
+  /// The columns of the current result set, empty if none was begun.
+  std::vector<std::string> columns_;
+
+  /// The display width of each column, set after sampling.
+  std::vector<size_t> widths_;
+
+  /// Rows waiting for the column widths.
+  std::vector<std::vector<std::string>> sample_;
+
+  /// The separator printed above and below pretty rows.
+  std::string separator_;
+
+  /// A reusable buffer for the formatted line.
+  std::string line_;
+
+  size_t rows_{0};
+  bool begun_{false};
+};
 }
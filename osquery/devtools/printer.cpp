@@ -8,6 +8,8 @@
  *
  */
 
+#include <algorithm>
+#include <cstdio>
 #include <iostream>
 #include <sstream>
 
@@ -22,6 +24,16 @@ namespace osquery {
 
 SHELL_FLAG(string, nullvalue, "", "Set string for NULL values, default ''");
 
+SHELL_FLAG(uint64,
+           pretty_sample_rows,
+           100,
+           "Rows buffered to size pretty output columns");
+
+SHELL_FLAG(uint64,
+           pretty_max_width,
+           0,
+           "Maximum width of a pretty output column (0 = unbounded)");
+
 static std::vector<char> kOffset = {0, 0};
 static std::string kToken = "|";
 
@@ -157,4 +169,183 @@ void computeRowLengths(const Row& r,
     lengths[col.first] = (size > current) ? size : current;
   }
 }
+
+/// Append a value, truncated to a display width, padded to the width.
+static void appendCell(std::string& out,
+                       const std::string& value,
+                       size_t width) {
+  auto size = utf8StringSize(value);
+  if (size <= width) {
+    out += value;
+    out.append(width - size, ' ');
+    return;
+  }
+
+  // Keep complete UTF-8 sequences and mark the truncation.
+  size_t keep = (width > 3) ? width - 3 : width;
+  size_t points = 0;
+  size_t end = 0;
+  for (; end < value.size(); end++) {
+    if ((static_cast<unsigned char>(value[end]) & 0xC0) != 0x80) {
+      if (points == keep) {
+        break;
+      }
+      points++;
+    }
+  }
+  out.append(value, 0, end);
+  if (width > 3) {
+    out += "...";
+  }
+}
+
+/// Append a JSON string, escaping quotes, backslashes, and control bytes.
+static void appendJSONString(std::string& out, const char* value) {
+  out += '"';
+  for (auto c = value; *c != 0; c++) {
+    switch (*c) {
+    case '"':
+      out += "\\\"";
+      break;
+    case '\\':
+      out += "\\\\";
+      break;
+    case '\n':
+      out += "\\n";
+      break;
+    case '\r':
+      out += "\\r";
+      break;
+    case '\t':
+      out += "\\t";
+      break;
+    default:
+      if (static_cast<unsigned char>(*c) < 0x20) {
+        char escape[7];
+        snprintf(escape, sizeof(escape), "\\u%04x", *c);
+        out += escape;
+      } else {
+        out += *c;
+      }
+    }
+  }
+  out += '"';
+}
+
+void ResultPrinter::begin(const std::vector<std::string>& columns) {
+  finish();
+  columns_ = columns;
+  rows_ = 0;
+  begun_ = true;
+  if (format_ == Format::JSON) {
+    fputs("[\n", out_);
+  }
+}
+
+void ResultPrinter::print(const char* const* values) {
+  if (!begun_) {
+    return;
+  }
+
+  if (format_ == Format::JSON) {
+    line_ = (rows_++ == 0) ? "  " : ",\n  ";
+    formatJSON(values);
+    fwrite(line_.data(), 1, line_.size(), out_);
+    return;
+  }
+
+  std::vector<std::string> row;
+  row.reserve(columns_.size());
+  for (size_t i = 0; i < columns_.size(); i++) {
+    row.push_back((values[i] == nullptr) ? FLAGS_nullvalue : values[i]);
+  }
+  rows_++;
+
+  if (widths_.empty()) {
+    // Columns are sized using the first rows.
+    sample_.push_back(std::move(row));
+    if (sample_.size() >= FLAGS_pretty_sample_rows) {
+      flushSample();
+    }
+    return;
+  }
+
+  formatPretty(row);
+  fwrite(line_.data(), 1, line_.size(), out_);
+}
+
+void ResultPrinter::finish() {
+  if (!begun_) {
+    return;
+  }
+
+  if (format_ == Format::JSON) {
+    fputs("\n]\n", out_);
+  } else if (rows_ > 0) {
+    if (widths_.empty()) {
+      flushSample();
+    }
+    fputs(separator_.c_str(), out_);
+  }
+  fflush(out_);
+
+  columns_.clear();
+  widths_.clear();
+  sample_.clear();
+  begun_ = false;
+}
+
+void ResultPrinter::flushSample() {
+  // Column names are the minimum widths, values are bounded by the maximum.
+  std::map<std::string, size_t> lengths;
+  widths_.resize(columns_.size());
+  for (size_t i = 0; i < columns_.size(); i++) {
+    size_t width = 0;
+    for (const auto& row : sample_) {
+      width = std::max(width, utf8StringSize(row[i]));
+    }
+    if (FLAGS_pretty_max_width > 0) {
+      width = std::min(width, static_cast<size_t>(FLAGS_pretty_max_width));
+    }
+    widths_[i] = std::max(width, utf8StringSize(columns_[i]));
+    lengths[columns_[i]] = widths_[i];
+  }
+
+  separator_ = generateToken(lengths, columns_);
+  auto header = separator_ + generateHeader(lengths, columns_) + separator_;
+  fputs(header.c_str(), out_);
+
+  for (const auto& row : sample_) {
+    formatPretty(row);
+    fwrite(line_.data(), 1, line_.size(), out_);
+  }
+  sample_.clear();
+}
+
+void ResultPrinter::formatPretty(const std::vector<std::string>& values) {
+  line_.clear();
+  for (size_t i = 0; i < columns_.size(); i++) {
+    line_ += kToken;
+    line_ += ' ';
+    appendCell(line_, values[i], widths_[i]);
+    line_ += ' ';
+  }
+  line_ += kToken;
+  line_ += '\n';
+}
+
+void ResultPrinter::formatJSON(const char* const* values) {
+  line_ += '{';
+  for (size_t i = 0; i < columns_.size(); i++) {
+    if (i > 0) {
+      line_ += ',';
+    }
+    appendJSONString(line_, columns_[i].c_str());
+    line_ += ':';
+    appendJSONString(line_,
+                     (values[i] == nullptr) ? FLAGS_nullvalue.c_str()
+                                            : values[i]);
+  }
+  line_ += '}';
+}
 }
@@ -36,6 +36,7 @@
 #include <osquery/filesystem.h>
 #include <osquery/flags.h>
 #include <osquery/packs.h>
+#include <osquery/sql.h>
 
 #include "osquery/devtools/devtools.h"
 #include "osquery/filesystem/fileops.h"
@@ -96,6 +97,7 @@ static char zHelp[] =
     "                   pretty   Pretty printed SQL results (default)\n"
     ".nullvalue STR   Use STRING in place of NULL values\n"
     ".print STR...    Print literal STRING\n"
+    ".profile ON|OFF  Print the cost of each query's virtual tables\n"
     ".quit            Exit this program\n"
     ".schema [TABLE]  Show the CREATE statements\n"
     ".separator STR   Change separator used by output mode\n"
@@ -221,6 +223,33 @@ static void endTimer(void) {
 #define END_TIMER endTimer()
 #define HAS_TIMER 1
 
+// True if query profiles are printed
+static int enableProfile = 0;
+
+// Print a query profile to stderr.
+static void printProfile(const osquery::QueryProfile& profile) {
+  fprintf(stderr,
+          "Profile: %zu rows returned, %.3f ms\n",
+          profile.rows,
+          profile.wall_time * 0.001);
+  for (const auto& table : profile.tables) {
+    std::string constraints;
+    for (const auto& constraint : table.constraints) {
+      constraints += (constraints.empty()) ? "" : ", ";
+      constraints += constraint;
+    }
+    fprintf(stderr,
+            "  %s: %zu filters, %zu rows generated, %.3f ms%s%s%s\n",
+            table.table.c_str(),
+            table.filters,
+            table.rows,
+            table.time * 0.001,
+            (constraints.empty()) ? "" : " [",
+            constraints.c_str(),
+            (constraints.empty()) ? "" : "]");
+  }
+}
+
 // If the following flag is set, then command execution stops
 // at an error if we are not interactive.
 static int bail_on_error = 0;
@@ -338,15 +367,6 @@ static char* one_input_line(FILE* in, char* zPrior, int isContinuation) {
   return zResult;
 }
 
-/*
-** Pretty print structure
- */
-struct prettyprint_data {
-  osquery::QueryData results;
-  std::vector<std::string> columns;
-  std::map<std::string, size_t> lengths;
-};
-
 /*
 ** An pointer to an instance of this structure is passed from
 ** the main program to the callback.  This is used to communicate
@@ -373,8 +393,8 @@ struct callback_data {
   int nIndent; /* Size of array aiIndent[] */
   int iIndent; /* Index of current op in aiIndent[] */
 
-  /* Additional attributes to be used in pretty mode */
-  struct prettyprint_data* prettyPrint;
+  /* Streams pretty and JSON results, owned by shell_exec */
+  osquery::ResultPrinter* printer;
 };
 
 // Number of elements in an array
@@ -513,22 +533,7 @@ static int shell_callback(
 
   switch (p->mode) {
   case MODE_Pretty: {
-    if (p->prettyPrint->columns.size() == 0) {
-      for (i = 0; i < nArg; i++) {
-        p->prettyPrint->columns.push_back(std::string(azCol[i]));
-      }
-    }
-
-    osquery::Row r;
-    for (i = 0; i < nArg; ++i) {
-      if (azCol[i] != nullptr) {
-        r[std::string(azCol[i])] = (azArg[i] == nullptr)
-                                       ? osquery::FLAGS_nullvalue
-                                       : std::string(azArg[i]);
-      }
-    }
-    osquery::computeRowLengths(r, p->prettyPrint->lengths);
-    p->prettyPrint->results.push_back(r);
+    p->printer->print(azArg);
     break;
   }
   case MODE_Line: {
@@ -788,6 +793,15 @@ static int shell_exec(
     *pzErrMsg = nullptr;
   }
 
+  /* Pretty and JSON results are printed as each row is stepped. */
+  osquery::ResultPrinter printer(
+      (pArg && pArg->out) ? pArg->out : stdout,
+      (osquery::FLAGS_json) ? osquery::ResultPrinter::Format::JSON
+                            : osquery::ResultPrinter::Format::PRETTY);
+  if (pArg) {
+    pArg->printer = &printer;
+  }
+
   while (zSql[0] && (SQLITE_OK == rc)) {
     /* A lock for attaching virtual tables, but also the SQL object states. */
     osquery::RecursiveLock lock(osquery::kAttachMutex);
@@ -819,6 +833,24 @@ static int shell_exec(
         fprintf(pArg->out, "%s\n", zStmtSql ? zStmtSql : zSql);
       }
 
+      /* profile the statement's virtual tables */
+      size_t rows = 0;
+      if (enableProfile) {
+        const char* zStmtSql = sqlite3_sql(pStmt);
+        osquery::QueryProfiler::start("", zStmtSql ? zStmtSql : zSql);
+      }
+
+      /* begin a result set for statements returning columns */
+      if (pArg && pArg->mode == MODE_Pretty) {
+        std::vector<std::string> columns;
+        for (int i = 0; i < sqlite3_column_count(pStmt); i++) {
+          columns.push_back(sqlite3_column_name(pStmt, i));
+        }
+        if (!columns.empty()) {
+          printer.begin(columns);
+        }
+      }
+
       /* perform the first step.  this will tell us if we
       ** have a result set or not and how wide it is.
       */
@@ -843,6 +875,7 @@ static int shell_exec(
               azCols[i] = (char*)sqlite3_column_name(pStmt, i);
             }
             do {
+              rows++;
               /* extract the data and data types */
               for (i = 0; i < nCol; i++) {
                 aiTypes[i] = sqlite3_column_type(pStmt, i);
@@ -867,6 +900,7 @@ static int shell_exec(
           }
         } else {
           do {
+            rows++;
             rc = sqlite3_step(pStmt);
           } while (rc == SQLITE_ROW);
         }
@@ -875,7 +909,15 @@ static int shell_exec(
       /* Finalize the statement just executed. If this fails, save a
       ** copy of the error message. Otherwise, set zSql to point to the
       ** next statement to execute. */
+      printer.finish();
       rc2 = sqlite3_finalize(pStmt);
+      if (enableProfile) {
+        osquery::QueryProfile profile;
+        osquery::QueryProfiler::recordRows(rows);
+        if (osquery::QueryProfiler::finish(profile)) {
+          printProfile(profile);
+        }
+      }
       if (rc != SQLITE_NOMEM) {
         rc = rc2;
       }
@@ -896,17 +938,8 @@ static int shell_exec(
   } /* end while */
   dbc->clearAffectedTables();
 
-  if (pArg && pArg->mode == MODE_Pretty) {
-    if (osquery::FLAGS_json) {
-      osquery::jsonPrint(pArg->prettyPrint->results);
-    } else {
-      osquery::prettyPrint(pArg->prettyPrint->results,
-                           pArg->prettyPrint->columns,
-                           pArg->prettyPrint->lengths);
-    }
-    pArg->prettyPrint->results.clear();
-    pArg->prettyPrint->columns.clear();
-    pArg->prettyPrint->lengths.clear();
+  if (pArg) {
+    pArg->printer = nullptr;
   }
 
   return rc;
@@ -1329,6 +1362,9 @@ static int do_meta_command(char* zLine, struct callback_data* p) {
       fprintf(p->out, "%s", azArg[j]);
     }
     fprintf(p->out, "\n");
+  } else if (c == 'p' && n >= 3 && strncmp(azArg[0], "profile", n) == 0 &&
+             nArg == 2) {
+    enableProfile = booleanValue(azArg[1]);
   } else if (c == 'q' && strncmp(azArg[0], "quit", n) == 0 && nArg == 1) {
     rc = 2;
   } else if (c == 's' && strncmp(azArg[0], "schema", n) == 0 && nArg < 3) {
@@ -1571,7 +1607,6 @@ static int process_input(struct callback_data* p, FILE* in) {
 */
 static void main_init(struct callback_data* data) {
   memset(data, 0, sizeof(struct callback_data));
-  data->prettyPrint = new struct prettyprint_data();
   data->mode = MODE_Pretty;
   data->showHeader = 1;
   data->separator[0] = '|';
@@ -1729,10 +1764,6 @@ int launchIntoShell(int argc, char** argv) {
 
   set_table_name(&data, 0);
   sqlite3_free(data.zFreeOnClose);
-
-  if (data.prettyPrint != nullptr) {
-    delete data.prettyPrint;
-  }
   return rc;
 }
 }
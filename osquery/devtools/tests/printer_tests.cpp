@@ -16,6 +16,22 @@
 
 namespace osquery {
 
+DECLARE_uint64(pretty_sample_rows);
+DECLARE_uint64(pretty_max_width);
+
+/// Read everything written to a temporary file.
+static std::string readPrinted(FILE* out) {
+  std::string content;
+  rewind(out);
+  char buffer[1024];
+  size_t size = 0;
+  while ((size = fread(buffer, 1, sizeof(buffer), out)) > 0) {
+    content.append(buffer, size);
+  }
+  fclose(out);
+  return content;
+}
+
 class PrinterTests : public testing::Test {
  public:
   QueryData q;
@@ -103,4 +119,83 @@ TEST_F(PrinterTests, test_unicode) {
   std::map<std::string, size_t> expected = {{"name", 10}};
   EXPECT_EQ(lengths, expected);
 }
+
+TEST_F(PrinterTests, test_result_printer_pretty) {
+  auto out = tmpfile();
+  ASSERT_NE(out, nullptr);
+
+  ResultPrinter printer(out, ResultPrinter::Format::PRETTY);
+  printer.begin(order);
+  for (const auto& row : q) {
+    std::vector<const char*> values;
+    for (const auto& column : order) {
+      values.push_back(row.at(column).c_str());
+    }
+    printer.print(values.data());
+  }
+  printer.finish();
+
+  // The output matches the buffered pretty printer.
+  std::map<std::string, size_t> lengths;
+  for (const auto& row : q) {
+    computeRowLengths(row, lengths);
+  }
+  computeRowLengths(q.front(), lengths, true);
+  auto separator = generateToken(lengths, order);
+  auto expected = separator + generateHeader(lengths, order) + separator;
+  for (const auto& row : q) {
+    expected += generateRow(row, lengths, order);
+  }
+  expected += separator;
+  EXPECT_EQ(readPrinted(out), expected);
+}
+
+TEST_F(PrinterTests, test_result_printer_truncate) {
+  auto out = tmpfile();
+  ASSERT_NE(out, nullptr);
+
+  // Rows after the sample are truncated to the sampled widths.
+  auto sample_rows = FLAGS_pretty_sample_rows;
+  FLAGS_pretty_sample_rows = 1;
+  ResultPrinter printer(out, ResultPrinter::Format::PRETTY);
+  printer.begin({"name"});
+  const char* first[] = {"Àlex"};
+  printer.print(first);
+  const char* second[] = {"Àlexander"};
+  printer.print(second);
+  const char* null[] = {nullptr};
+  printer.print(null);
+  printer.finish();
+  FLAGS_pretty_sample_rows = sample_rows;
+
+  auto expected =
+      "+------+\n"
+      "| name |\n"
+      "+------+\n"
+      "| Àlex |\n"
+      "| À... |\n"
+      "|      |\n"
+      "+------+\n";
+  EXPECT_EQ(readPrinted(out), expected);
+}
+
+TEST_F(PrinterTests, test_result_printer_json) {
+  auto out = tmpfile();
+  ASSERT_NE(out, nullptr);
+
+  ResultPrinter printer(out, ResultPrinter::Format::JSON);
+  printer.begin({"name", "quote"});
+  const char* first[] = {"Mike Jones", "say \"hi\"\n"};
+  printer.print(first);
+  const char* second[] = {"Doctor Who", nullptr};
+  printer.print(second);
+  printer.finish();
+
+  auto expected =
+      "[\n"
+      "  {\"name\":\"Mike Jones\",\"quote\":\"say \\\"hi\\\"\\n\"},\n"
+      "  {\"name\":\"Doctor Who\",\"quote\":\"\"}\n"
+      "]\n";
+  EXPECT_EQ(readPrinted(out), expected);
+}
 }
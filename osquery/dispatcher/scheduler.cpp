@@ -15,12 +15,14 @@
 #include <osquery/database.h>
 #include <osquery/flags.h>
 #include <osquery/logger.h>
+#include <osquery/sql.h>
 #include <osquery/system.h>
 
 #include "osquery/config/parsers/decorators.h"
 #include "osquery/core/process.h"
 #include "osquery/database/query.h"
 #include "osquery/dispatcher/scheduler.h"
+#include "osquery/sql/virtual_table.h"
 
 namespace osquery {
 
@@ -28,6 +30,11 @@ FLAG(bool, enable_monitor, true, "Enable the schedule monitor");
 
 FLAG(uint64, schedule_timeout, 0, "Limit the schedule, 0 for no limit")
 
+FLAG(bool,
+     schedule_shared_scans,
+     true,
+     "Share table scans between queries scheduled within the same step");
+
 /// Used to bypass (optimize-out) the set-differential of query results.
 DECLARE_bool(events_optimize);
 
@@ -61,7 +68,6 @@ SQLInternal monitor(const std::string& name, const ScheduledQuery& query) {
 inline void launchQuery(const std::string& name, const ScheduledQuery& query) {
   // Execute the scheduled query and create a named query object.
   LOG(INFO) << "Executing scheduled query: " << name << ": " << query.query;
-  runDecorators(DECORATE_ALWAYS);
   auto sql =
       (FLAGS_enable_monitor) ? monitor(name, query) : SQLInternal(query.query);
 
@@ -70,6 +76,7 @@ inline void launchQuery(const std::string& name, const ScheduledQuery& query) {
                << sql.getMessageString();
     return;
   }
+  QueryProfiler::recordRows(sql.rows().size());
 
   // Fill in a host identifier fields based on configuration or availability.
   std::string ident = getHostIdentifier();
@@ -93,7 +100,10 @@ inline void launchQuery(const std::string& name, const ScheduledQuery& query) {
   // Create a database-backed set of query results.
   auto dbQuery = Query(name, query);
   // Comparisons and stores must include escaped data.
-  sql.escapeResults();
+  {
+    QueryPhaseTimer timer(QueryPhase::SERIALIZE);
+    sql.escapeResults();
+  }
 
   Status status;
   DiffResults diff_results;
@@ -101,6 +111,7 @@ inline void launchQuery(const std::string& name, const ScheduledQuery& query) {
   // We can then ask for a differential from the last time this named query
   // was executed by exact matching each row.
   if (!FLAGS_events_optimize || !sql.eventBased()) {
+    QueryPhaseTimer timer(QueryPhase::DIFF);
     status = dbQuery.addNewResults(sql.rows(), diff_results);
     if (!status.ok()) {
       std::string line =
@@ -139,14 +150,45 @@ void SchedulerRunner::start() {
   // Start the counter at the second.
   auto i = osquery::getUnixTime();
   for (; (timeout_ == 0) || (i <= timeout_); ++i) {
+    // Collect the queries due within this step, they are launched together.
+    std::map<std::string, ScheduledQuery> due;
+    std::vector<std::string> order;
     Config::getInstance().scheduledQueries(
-        ([&i](const std::string& name, const ScheduledQuery& query) {
+        ([&i, &due, &order](const std::string& name,
+                            const ScheduledQuery& query) {
           if (query.splayed_interval > 0 && i % query.splayed_interval == 0) {
-            TablePlugin::kCacheInterval = query.splayed_interval;
-            TablePlugin::kCacheStep = i;
-            launchQuery(name, query);
+            due[name] = query;
+            order.push_back(name);
           }
         }));
+
+    if (FLAGS_schedule_shared_scans && order.size() > 0) {
+      // Queries within the step share scans of the tables they touch.
+      SharedScans::startTick(order);
+    }
+    for (const auto& name : order) {
+      const auto& query = due.at(name);
+      TablePlugin::kCacheInterval = query.splayed_interval;
+      TablePlugin::kCacheStep = i;
+      // Queries launched within the same step share the "always" decorations.
+      // They run before the query starts, so their scans are not counted in
+      // the query's profile or table use.
+      runDecorators(DECORATE_ALWAYS, i);
+      SharedScans::startQuery(name);
+      // Profile the execution, serialization, diff and logging.
+      bool profile_query = QueryProfiler::enabled();
+      if (profile_query) {
+        QueryProfiler::start(name, query.query);
+      }
+      launchQuery(name, query);
+      if (profile_query) {
+        QueryProfile profile;
+        QueryProfiler::finish(profile);
+      }
+      SharedScans::endQuery();
+    }
+    SharedScans::endTick();
+
     // Configuration decorators run on 60 second intervals only.
     if (i % 60 == 0) {
       runDecorators(DECORATE_INTERVAL, i);
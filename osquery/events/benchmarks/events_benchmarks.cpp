@@ -14,6 +14,10 @@
 #include <osquery/events.h>
 #include <osquery/tables.h>
 
+#ifdef __linux__
+#include "osquery/events/linux/inotify.h"
+#endif
+
 namespace osquery {
 
 class BenchmarkEventPublisher
@@ -133,4 +137,69 @@ BENCHMARK(EVENTS_retrieve_events)
     ->ArgPair(0, 50)
     ->ArgPair(0, 100)
     ->ArgPair(0, 1000);
+
+#ifdef __linux__
+/// Create a mix of file, recursive, and wildcard inotify subscriptions.
+static std::vector<INotifySubscriptionContextRef> getPathSubscriptions(
+    size_t count) {
+  std::vector<INotifySubscriptionContextRef> subscriptions;
+  for (size_t i = 0; i < count; i++) {
+    auto sc = std::make_shared<INotifySubscriptionContext>();
+    auto leaf = std::to_string(i);
+    if (i % 3 == 0) {
+      sc->path = "/etc/config" + leaf + "/";
+    } else if (i % 3 == 1) {
+      sc->path = "/var/lib/data" + leaf + "/";
+      sc->recursive = true;
+    } else {
+      sc->path = "/home/*/.config" + leaf + "/*.conf";
+    }
+    subscriptions.push_back(sc);
+  }
+  return subscriptions;
+}
+
+static const std::vector<std::string> kPathEvents = {
+    "/etc/config3/hosts",
+    "/var/lib/data4/cache/entry",
+    "/home/user/.config5/app.conf",
+    "/usr/bin/unrelated",
+};
+
+static void EVENTS_inotify_path_match(benchmark::State& state) {
+  auto subscriptions = getPathSubscriptions(state.range_x());
+  size_t i = 0;
+  volatile size_t matched = 0;
+  while (state.KeepRunning()) {
+    // Each event is compared with each subscription.
+    const auto& path = kPathEvents[i++ % kPathEvents.size()];
+    for (const auto& sc : subscriptions) {
+      if (INotifyPathIndex::matches(*sc, path)) {
+        matched = matched + 1;
+      }
+    }
+  }
+}
+
+BENCHMARK(EVENTS_inotify_path_match)->Arg(10)->Arg(100)->Arg(500);
+
+static void EVENTS_inotify_path_index(benchmark::State& state) {
+  auto subscriptions = getPathSubscriptions(state.range_x());
+  INotifyPathIndex index;
+  for (size_t id = 0; id < subscriptions.size(); id++) {
+    index.add(id + 1, *subscriptions[id]);
+  }
+
+  size_t i = 0;
+  volatile size_t matched = 0;
+  std::vector<size_t> ids;
+  while (state.KeepRunning()) {
+    // Each event walks the index once.
+    index.match(kPathEvents[i++ % kPathEvents.size()], ids);
+    matched = matched + ids.size();
+  }
+}
+
+BENCHMARK(EVENTS_inotify_path_index)->Arg(10)->Arg(100)->Arg(500);
+#endif
 }
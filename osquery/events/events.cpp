@@ -8,6 +8,7 @@
  *
  */
 
+#include <algorithm>
 #include <chrono>
 #include <exception>
 #include <thread>
@@ -60,6 +61,16 @@ static inline EventTime timeFromRecord(const std::string& record) {
   return afinite;
 }
 
+/**
+ * @brief Check if the backing store drops expired event data itself.
+ *
+ * RocksDB compaction drops the data of events at or before the time stored in
+ * a subscriber's "expire." key, expirations only rewrite the record lists.
+ */
+static inline bool isCompactionExpiry() {
+  return !Registry::external() && Registry::getActive("database") == "rocksdb";
+}
+
 static inline void getOptimizeData(EventTime& o_time,
                                    size_t& o_eid,
                                    const std::string& publisher) {
@@ -180,6 +191,7 @@ std::vector<std::string> EventSubscriberPlugin::getIndexes(EventTime start,
   }
 
   std::vector<std::string> bins, expirations;
+  bool expired = false;
   boost::split(bins, content, boost::is_any_of(","));
   for (const auto& bin : bins) {
     auto step = timeFromRecord(bin);
@@ -189,6 +201,7 @@ std::vector<std::string> EventSubscriberPlugin::getIndexes(EventTime start,
       expirations.push_back(bin);
     } else if (step_start < expire_time_) {
       expireRecords("60", bin, false);
+      expired = true;
     }
 
     if (step >= l_start && (r_stop == 0 || step < r_stop)) {
@@ -199,6 +212,13 @@ std::vector<std::string> EventSubscriberPlugin::getIndexes(EventTime start,
   // Rewrite the index lists and delete each expired item.
   if (!expirations.empty()) {
     expireIndexes("60", bins, expirations);
+    expired = true;
+  }
+
+  // Store the expiration time for the backing store to drop expired data.
+  if (expired && isCompactionExpiry()) {
+    setDatabaseValue(
+        kEvents, "expire." + dbNamespace(), std::to_string(expire_time_));
   }
 
   // Return indexes in binning order.
@@ -224,9 +244,20 @@ void EventSubscriberPlugin::expireRecords(const std::string& list_type,
   std::vector<std::string> persisting_records;
   // Request all records within this list-size + bin offset.
   auto expired_records = getRecords({list_type + "." + index});
+  auto compaction = isCompactionExpiry();
   for (const auto& record : expired_records) {
     if (all || record.second <= expire_time_) {
-      deleteDatabaseValue(kEvents, data_key + "." + record.first);
+      if (!compaction) {
+        deleteDatabaseValue(kEvents, data_key + "." + record.first);
+        continue;
+      }
+
+      // Expired data is dropped by the backing store, remember the EID to
+      // exclude the remaining data from the buffered event count.
+      unsigned long int eid = 0;
+      if (safeStrtoul(record.first, 10, eid) && eid > expire_eid_) {
+        expire_eid_ = static_cast<size_t>(eid);
+      }
     } else {
       persisting_records.push_back(record.first + ":" +
                                    std::to_string(record.second));
@@ -274,6 +305,17 @@ void EventSubscriberPlugin::expireCheck(bool cleanup) {
     auto limit = getEventsMax();
     std::vector<std::string> keys;
     scanDatabaseKeys(kEvents, keys, data_key);
+    if (expire_eid_ > 0) {
+      // Expired data waiting to be dropped by the backing store is not
+      // buffered.
+      auto expired = [this](const std::string& key) {
+        unsigned long int eid = 0;
+        auto id = key.substr(key.rfind('.') + 1);
+        return safeStrtoul(id, 10, eid) && eid <= expire_eid_;
+      };
+      keys.erase(std::remove_if(keys.begin(), keys.end(), expired), keys.end());
+    }
+
     if (keys.size() <= limit) {
       return;
     }
@@ -556,7 +598,8 @@ void EventFactory::delay() {
   auto& ef = EventFactory::getInstance();
   for (const auto& publisher : EventFactory::getInstance().event_pubs_) {
     // Publishers that did not set up correctly are put into an ending state.
-    if (!publisher.second->isEnding()) {
+    // Publishers attached to a shared reactor do not need a run loop thread.
+    if (!publisher.second->isEnding() && !publisher.second->hasReactor()) {
       auto thread_ = std::make_shared<std::thread>(
           boost::bind(&EventFactory::run, publisher.first));
       ef.threads_.push_back(thread_);
@@ -8,6 +8,9 @@
  *
  */
 
+#include <climits>
+#include <cstdint>
+
 #include <boost/algorithm/string/classification.hpp>
 #include <boost/algorithm/string/split.hpp>
 #include <boost/filesystem.hpp>
@@ -61,9 +64,8 @@ void AuditAssembler::start(size_t capacity,
   types_ = std::move(types);
 }
 
-boost::optional<AuditFields> AuditAssembler::add(Auid id,
-                                                 size_t type,
-                                                 const AuditFields& fields) {
+boost::optional<AuditFields> AuditAssembler::add(
+    Auid id, size_t type, const AuditRecordFields& fields) {
   auto it = m_.find(id);
   if (it == m_.end()) {
     // A new audit ID.
@@ -139,6 +141,229 @@ bool AuditAssembler::complete(Auid id) {
   return true;
 }
 
+/// Parse an unsigned base-10 integer from a range without allocating.
+static inline bool parseAuditDecimal(boost::string_ref s,
+                                     unsigned long long& result) {
+  if (s.empty() || s.size() > 20) {
+    return false;
+  }
+
+  result = 0;
+  for (const auto& c : s) {
+    if (c < '0' || c > '9') {
+      return false;
+    }
+    result = result * 10 + (c - '0');
+  }
+  return true;
+}
+
+AuditFieldKey getAuditFieldKey(boost::string_ref key, uint16_t& index) {
+  index = 0;
+  if (key.empty()) {
+    return AUDIT_KEY_OTHER;
+  }
+
+  // Argument keys are frequent and numbered: a0, a1, ... and chunks a1[0].
+  if (key[0] == 'a' && key.size() > 1 && key[1] >= '0' && key[1] <= '9') {
+    auto digits = key.substr(1, key.find('[') - 1);
+    unsigned long long number = 0;
+    if (parseAuditDecimal(digits, number) && number <= UINT16_MAX &&
+        (digits.size() + 1 == key.size() || key.back() == ']')) {
+      index = static_cast<uint16_t>(number);
+      return AUDIT_KEY_ARG;
+    }
+    return AUDIT_KEY_OTHER;
+  }
+
+  // Branch on the leading character before comparing the whole key.
+  switch (key[0]) {
+  case 'a':
+    if (key == "auid") {
+      return AUDIT_KEY_AUID;
+    } else if (key == "argc") {
+      return AUDIT_KEY_ARGC;
+    } else if (key == "addr") {
+      return AUDIT_KEY_ADDR;
+    }
+    break;
+  case 'c':
+    if (key == "comm") {
+      return AUDIT_KEY_COMM;
+    }
+    break;
+  case 'e':
+    if (key == "exe") {
+      return AUDIT_KEY_EXE;
+    } else if (key == "euid") {
+      return AUDIT_KEY_EUID;
+    } else if (key == "egid") {
+      return AUDIT_KEY_EGID;
+    } else if (key == "exit") {
+      return AUDIT_KEY_EXIT;
+    }
+    break;
+  case 'g':
+    if (key == "gid") {
+      return AUDIT_KEY_GID;
+    }
+    break;
+  case 'i':
+    if (key == "item") {
+      return AUDIT_KEY_ITEM;
+    }
+    break;
+  case 'm':
+    if (key == "mode") {
+      return AUDIT_KEY_MODE;
+    } else if (key == "msg") {
+      return AUDIT_KEY_MSG;
+    }
+    break;
+  case 'o':
+    if (key == "ouid") {
+      return AUDIT_KEY_OUID;
+    } else if (key == "ogid") {
+      return AUDIT_KEY_OGID;
+    }
+    break;
+  case 'p':
+    if (key == "pid") {
+      return AUDIT_KEY_PID;
+    } else if (key == "ppid") {
+      return AUDIT_KEY_PPID;
+    }
+    break;
+  case 's':
+    if (key == "syscall") {
+      return AUDIT_KEY_SYSCALL;
+    } else if (key == "success") {
+      return AUDIT_KEY_SUCCESS;
+    } else if (key == "saddr") {
+      return AUDIT_KEY_SADDR;
+    }
+    break;
+  case 't':
+    if (key == "terminal") {
+      return AUDIT_KEY_TERMINAL;
+    }
+    break;
+  case 'u':
+    if (key == "uid") {
+      return AUDIT_KEY_UID;
+    }
+    break;
+  }
+  return AUDIT_KEY_OTHER;
+}
+
+void AuditRecordFields::parse(boost::string_ref body) {
+  message_.assign(body.data(), body.size());
+  fields_.clear();
+
+  // Most records have fewer than 32 fields, SYSCALL records have ~28.
+  fields_.reserve(32);
+
+  const char* data = message_.data();
+  size_t size = message_.size();
+  size_t i = 0;
+  while (i < size) {
+    // Multiple space tokens are supported.
+    while (i < size && data[i] == ' ') {
+      i++;
+    }
+    if (i >= size) {
+      break;
+    }
+
+    Field field;
+    field.key_offset = static_cast<uint32_t>(i);
+    while (i < size && data[i] != '=' && data[i] != ' ') {
+      i++;
+    }
+    field.key_size = static_cast<uint32_t>(i - field.key_offset);
+    field.value_offset = static_cast<uint32_t>(i);
+
+    if (i < size && data[i] == '=') {
+      field.value_offset = static_cast<uint32_t>(++i);
+      if (i < size && data[i] == '"') {
+        // An enclosed value may contain spaces, keep the enclosing quotes.
+        auto close = message_.find('"', i + 1);
+        i = (close == std::string::npos) ? size : close + 1;
+      } else {
+        while (i < size && data[i] != ' ') {
+          i++;
+        }
+      }
+    }
+    field.value_size = static_cast<uint32_t>(i - field.value_offset);
+
+    field.id = getAuditFieldKey(key(field), field.index);
+    fields_.push_back(field);
+  }
+}
+
+void AuditRecordFields::add(boost::string_ref key, boost::string_ref value) {
+  Field field;
+  field.key_offset = static_cast<uint32_t>(message_.size());
+  field.key_size = static_cast<uint32_t>(key.size());
+  message_.append(key.data(), key.size());
+  field.value_offset = static_cast<uint32_t>(message_.size());
+  field.value_size = static_cast<uint32_t>(value.size());
+  message_.append(value.data(), value.size());
+
+  field.id = getAuditFieldKey(key, field.index);
+  fields_.push_back(field);
+}
+
+const AuditRecordFields::Field* AuditRecordFields::find(
+    AuditFieldKey id) const {
+  for (const auto& field : fields_) {
+    if (field.id == id) {
+      return &field;
+    }
+  }
+  return nullptr;
+}
+
+const AuditRecordFields::Field* AuditRecordFields::find(
+    boost::string_ref name) const {
+  uint16_t index = 0;
+  auto id = getAuditFieldKey(name, index);
+  for (const auto& field : fields_) {
+    if (field.id != id) {
+      continue;
+    }
+    // Uninterned and argument keys share an ID, compare the key itself.
+    if ((id != AUDIT_KEY_OTHER && id != AUDIT_KEY_ARG) || key(field) == name) {
+      return &field;
+    }
+  }
+  return nullptr;
+}
+
+std::string AuditRecordFields::decoded(AuditFieldKey id) const {
+  auto field = find(id);
+  return (field != nullptr) ? decodeAuditValue(value(*field)) : "";
+}
+
+bool AuditRecordFields::integer(AuditFieldKey id, long long& result) const {
+  auto data = get(id);
+  bool negative = (!data.empty() && data[0] == '-');
+  if (negative) {
+    data.remove_prefix(1);
+  }
+
+  unsigned long long magnitude = 0;
+  if (!parseAuditDecimal(data, magnitude) ||
+      magnitude > static_cast<unsigned long long>(LLONG_MAX)) {
+    return false;
+  }
+  result = (negative) ? -static_cast<long long>(magnitude)
+                      : static_cast<long long>(magnitude);
+  return true;
+}
+
 Status AuditEventPublisher::setUp() {
   if (FLAGS_disable_audit) {
     return Status(1, "Publisher disabled via configuration");
@@ -289,62 +514,27 @@ bool handleAuditReply(const struct audit_reply& reply,
     return false;
   }
 
-  safeStrtoul(std::string(message_view.substr(6, 10)), 10, ec->time);
-  safeStrtoul(
-      std::string(message_view.substr(21, preamble_end - 21)), 10, ec->auid);
-  boost::string_ref field_view(message_view.substr(preamble_end + 3));
-
-  // The linear search will construct series of key value pairs.
-  std::string key, value;
-  key.reserve(20);
-  value.reserve(256);
-
-  // There are several ways of representing value data (enclosed strings, etc).
-  bool found_assignment{false}, found_enclose{false};
-  for (const auto& c : field_view) {
-    // Iterate over each character in the audit message.
-    if ((found_enclose && c == '"') || (!found_enclose && c == ' ')) {
-      if (c == '"') {
-        value += c;
-      }
-      // This is a terminating sequence, the end of an enclosure or space tok.
-      if (!key.empty()) {
-        // Multiple space tokens are supported.
-        ec->fields.emplace(std::make_pair(std::move(key), std::move(value)));
-      }
-      found_enclose = false;
-      found_assignment = false;
-      key.clear();
-      value.clear();
-    } else if (!found_assignment && c == ' ') {
-      // A field tokenizer.
-    } else if (found_assignment) {
-      // Enclosure sequences appear immediately following assignment.
-      if (c == '"') {
-        found_enclose = true;
-      }
-      value += c;
-    } else if (c == '=') {
-      found_assignment = true;
-    } else {
-      key += c;
+  // The preamble is: audit(TIME.MS:AUID).
+  unsigned long long number = 0;
+  if (preamble_end > 21) {
+    if (parseAuditDecimal(message_view.substr(6, 10), number)) {
+      ec->time = number;
+    }
+    if (parseAuditDecimal(message_view.substr(21, preamble_end - 21),
+                          number)) {
+      ec->auid = number;
     }
   }
 
-  // Last step, if there was no trailing tokenizer.
-  if (!key.empty()) {
-    ec->fields.emplace(std::make_pair(std::move(key), std::move(value)));
-  }
+  // Copy the fields once, then index keys and values within the copy.
+  ec->fields.parse(message_view.substr(preamble_end + 3));
 
   // There is a special field for syscalls.
-  if (ec->fields.count("syscall") == 1) {
-    const auto& syscall_string = ec->fields.at("syscall").c_str();
-    long long syscall{0};
-    if (!safeStrtoll(syscall_string, 10, syscall)) {
-      syscall = 0;
-    }
-    ec->syscall = syscall;
+  long long syscall{0};
+  if (!ec->fields.integer(AUDIT_KEY_SYSCALL, syscall)) {
+    syscall = 0;
   }
+  ec->syscall = syscall;
 
   return true;
 }
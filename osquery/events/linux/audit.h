@@ -12,11 +12,14 @@
 
 #include <libaudit.h>
 
+#include <iterator>
 #include <map>
 #include <set>
+#include <string>
 #include <vector>
 
 #include <boost/algorithm/hex.hpp>
+#include <boost/utility/string_ref.hpp>
 
 #include <osquery/events.h>
 
@@ -68,6 +71,160 @@ using Auid = size_t;
 /// Alias the field container so we can replace and improve with refactors.
 using AuditFields = std::map<std::string, std::string>;
 
+/**
+ * @brief Interned IDs for the audit field keys subscribers commonly read.
+ *
+ * Every parsed field is tagged with an ID so lookups of these keys compare an
+ * integer instead of a string. Keys without an ID use AUDIT_KEY_OTHER.
+ */
+enum AuditFieldKey : uint8_t {
+  AUDIT_KEY_OTHER = 0,
+  AUDIT_KEY_PID,
+  AUDIT_KEY_PPID,
+  AUDIT_KEY_UID,
+  AUDIT_KEY_EUID,
+  AUDIT_KEY_GID,
+  AUDIT_KEY_EGID,
+  AUDIT_KEY_AUID,
+  AUDIT_KEY_EXE,
+  AUDIT_KEY_COMM,
+  AUDIT_KEY_SYSCALL,
+  AUDIT_KEY_SUCCESS,
+  AUDIT_KEY_EXIT,
+  AUDIT_KEY_ITEM,
+  AUDIT_KEY_MODE,
+  AUDIT_KEY_OUID,
+  AUDIT_KEY_OGID,
+  AUDIT_KEY_SADDR,
+  AUDIT_KEY_MSG,
+  AUDIT_KEY_ADDR,
+  AUDIT_KEY_TERMINAL,
+  AUDIT_KEY_ARGC,
+  /// Any argument key: aN or a chunk aN[M], the N is the field index.
+  AUDIT_KEY_ARG,
+};
+
+/**
+ * @brief The fields of a single audit message.
+ *
+ * The message body is copied once and parsed in a single pass into a flat
+ * list of key and value ranges within that copy. Values are left in their
+ * audit encoding (quoted or hex), see decodeAuditValue.
+ *
+ * Fields are kept in message order and duplicate keys are retained, lookups
+ * return the first match.
+ */
+class AuditRecordFields {
+ public:
+  struct Field {
+    /// The interned key.
+    AuditFieldKey id{AUDIT_KEY_OTHER};
+
+    /// For AUDIT_KEY_ARG, the argument number.
+    uint16_t index{0};
+
+    /// Offsets and sizes of the key and value within the message copy.
+    uint32_t key_offset{0};
+    uint32_t key_size{0};
+    uint32_t value_offset{0};
+    uint32_t value_size{0};
+  };
+
+  using const_iterator = std::vector<Field>::const_iterator;
+
+ public:
+  /// Parse the fields of an audit message body, replacing any content.
+  void parse(boost::string_ref body);
+
+  /// Append a field, used when building messages outside of the parser.
+  void add(boost::string_ref key, boost::string_ref value);
+
+  /// Find the first field with an interned key.
+  const Field* find(AuditFieldKey id) const;
+
+  /// Find the first field with a key, prefer the interned key lookup.
+  const Field* find(boost::string_ref key) const;
+
+  /// Check if the message included a field.
+  bool has(AuditFieldKey id) const {
+    return find(id) != nullptr;
+  }
+
+  /// Check if the message included a field.
+  bool has(boost::string_ref key) const {
+    return find(key) != nullptr;
+  }
+
+  /// The raw value of a field, or an empty range if it is missing.
+  boost::string_ref get(AuditFieldKey id) const {
+    auto field = find(id);
+    return (field != nullptr) ? value(*field) : boost::string_ref();
+  }
+
+  /// The raw value of a field, or an empty range if it is missing.
+  boost::string_ref get(boost::string_ref key) const {
+    auto field = find(key);
+    return (field != nullptr) ? value(*field) : boost::string_ref();
+  }
+
+  /// A copy of the raw value of a field, or a default if it is missing.
+  std::string str(AuditFieldKey id, const std::string& missing = "") const {
+    auto field = find(id);
+    return (field != nullptr) ? value(*field).to_string() : missing;
+  }
+
+  /// A copy of the raw value of a field, or a default if it is missing.
+  std::string str(boost::string_ref key,
+                  const std::string& missing = "") const {
+    auto field = find(key);
+    return (field != nullptr) ? value(*field).to_string() : missing;
+  }
+
+  /// The decoded (unquoted or unhexed) value of a field.
+  std::string decoded(AuditFieldKey id) const;
+
+  /// Parse a base-10 integer field value without allocating.
+  bool integer(AuditFieldKey id, long long& result) const;
+
+  /// The key of a field.
+  boost::string_ref key(const Field& field) const {
+    return boost::string_ref(message_.data() + field.key_offset,
+                             field.key_size);
+  }
+
+  /// The raw value of a field.
+  boost::string_ref value(const Field& field) const {
+    return boost::string_ref(message_.data() + field.value_offset,
+                             field.value_size);
+  }
+
+  const_iterator begin() const {
+    return fields_.begin();
+  }
+
+  const_iterator end() const {
+    return fields_.end();
+  }
+
+  size_t size() const {
+    return fields_.size();
+  }
+
+  bool empty() const {
+    return fields_.empty();
+  }
+
+ private:
+  /// The message body (or added content) that fields refer into.
+  std::string message_;
+
+  /// The parsed fields, in message order.
+  std::vector<Field> fields_;
+};
+
+/// Return the interned ID for an audit field key, and the aN argument number.
+AuditFieldKey getAuditFieldKey(boost::string_ref key, uint16_t& index);
+
 /**
  * @brief The message callback method used within AuditAssembler.
  *
@@ -82,8 +239,8 @@ using AuditFields = std::map<std::string, std::string>;
  * @return true if the message was parsed correctly, false if the multi-message
  *   encountered an error and should be removed.
  */
-using AuditUpdate =
-    std::function<bool(size_t type, const AuditFields& fields, AuditFields& r)>;
+using AuditUpdate = std::function<bool(
+    size_t type, const AuditRecordFields& fields, AuditFields& r)>;
 
 /**
  * @brief A multi-message assembler based on expectations of message-type sets.
@@ -107,7 +264,7 @@ class AuditAssembler : private boost::noncopyable {
   /// Add a message from audit.
   boost::optional<AuditFields> add(Auid id,
                                    size_t type,
-                                   const AuditFields& fields);
+                                   const AuditRecordFields& fields);
 
   /// Allow the publisher to explicit-set fields.
   void set(Auid id, const std::string& key, const std::string& value) {
@@ -147,14 +304,17 @@ class AuditAssembler : private boost::noncopyable {
 };
 
 /// Handle quote and hex-encoded audit field content.
-inline std::string decodeAuditValue(const std::string& s) {
+inline std::string decodeAuditValue(boost::string_ref s) {
   if (s.size() > 1 && s[0] == '"') {
-    return s.substr(1, s.size() - 2);
+    return s.substr(1, s.size() - 2).to_string();
   }
   try {
-    return boost::algorithm::unhex(s);
+    std::string decoded;
+    decoded.reserve(s.size() / 2);
+    boost::algorithm::unhex(s.begin(), s.end(), std::back_inserter(decoded));
+    return decoded;
   } catch (const boost::algorithm::hex_decode_error& e) {
-    return s;
+    return s.to_string();
   }
 }
 
@@ -199,7 +359,7 @@ struct AuditEventContext : public EventContext {
    * If the field contained a space in the value the data will be hex encoded.
    * It is the responsibility of the subscription callback/handler to parse.
    */
-  AuditFields fields;
+  AuditRecordFields fields;
 
   /// Each message will contain the audit ID.
   size_t auid{0};
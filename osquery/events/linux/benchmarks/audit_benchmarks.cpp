@@ -19,7 +19,7 @@
 namespace osquery {
 
 /// This is a poor interface.
-extern bool ProcessUpdate(size_t, const AuditFields&, AuditFields&);
+extern bool ProcessUpdate(size_t, const AuditRecordFields&, AuditFields&);
 
 const std::vector<std::string> kBenchmarkMessages = {
     "audit(1480751147.912:48372): arch=c000003e syscall=59 success=yes exit=0 "
@@ -68,6 +68,34 @@ static void AUDIT_handleReply(benchmark::State& state) {
 
 BENCHMARK(AUDIT_handleReply);
 
+static void AUDIT_handleReplyRecords(benchmark::State& state) {
+  std::vector<struct audit_reply> replies;
+  size_t bytes = 0;
+  for (const auto& message : kBenchmarkMessages) {
+    replies.push_back(getMockReply(message));
+    bytes += message.size();
+  }
+
+  // Parse and read typed fields as the process_events subscriber would.
+  volatile size_t sink = 0;
+  while (state.KeepRunning()) {
+    for (const auto& reply : replies) {
+      auto ec = std::make_shared<AuditEventContext>();
+      handleAuditReply(reply, ec);
+      sink = ec->fields.get(AUDIT_KEY_PID).size() +
+             ec->fields.get(AUDIT_KEY_EXE).size();
+    }
+  }
+
+  state.SetItemsProcessed(state.iterations() * replies.size());
+  state.SetBytesProcessed(state.iterations() * bytes);
+  for (auto& r : replies) {
+    free((void*)r.message);
+  }
+}
+
+BENCHMARK(AUDIT_handleReplyRecords);
+
 static void AUDIT_assembler(benchmark::State& state) {
   AuditAssembler asmb;
   asmb.start(
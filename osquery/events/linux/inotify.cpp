@@ -8,26 +8,47 @@
  *
  */
 
+#include <algorithm>
+#include <chrono>
 #include <sstream>
 
+#include <ctype.h>
 #include <fnmatch.h>
 #include <linux/limits.h>
 
 #include <boost/filesystem.hpp>
 
 #include <osquery/filesystem.h>
+#include <osquery/flags.h>
 #include <osquery/logger.h>
 #include <osquery/system.h>
 
 #include "osquery/events/linux/inotify.h"
+#include "osquery/events/linux/reactor.h"
 
 namespace fs = boost::filesystem;
 
 namespace osquery {
 
+FLAG(uint64,
+     inotify_coalesce_window,
+     250,
+     "Milliseconds to merge repeated inotify modifications of a path (0=off)");
+
 static const int kINotifyMLatency = 200;
-static const uint32_t kINotifyBufferSize =
-    (10 * ((sizeof(struct inotify_event)) + NAME_MAX + 1));
+
+/// The largest single inotify record.
+static const size_t kINotifyEventSize =
+    sizeof(struct inotify_event) + NAME_MAX + 1;
+
+/// Initial read buffer, grown while reads fill it during event bursts.
+static const size_t kINotifyBufferSize = 10 * kINotifyEventSize;
+
+/// The read buffer will not grow past this size.
+static const size_t kINotifyMaxBufferSize = 1024 * 1024;
+
+/// Minimum seconds between rescans after the inotify queue overflows.
+static const int kINotifyRestartInterval = 10;
 
 std::map<int, std::string> kMaskActions = {
     {IN_ACCESS, "ACCESSED"},
@@ -49,11 +70,26 @@ const uint32_t kFileAccessMasks = IN_OPEN | IN_ACCESS;
 REGISTER(INotifyEventPublisher, "event_publisher", "inotify");
 
 Status INotifyEventPublisher::setUp() {
-  inotify_handle_ = ::inotify_init();
+  // The handle is non-blocking so each wakeup can read until it is drained.
+  inotify_handle_ = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
   // If this does not work throw an exception.
   if (inotify_handle_ == -1) {
     return Status(1, "Could not start inotify: inotify_init failed");
   }
+
+  buffer_.resize(kINotifyBufferSize);
+  if (EventReactor::enabled()) {
+    // Events are drained from the shared reactor thread.
+    auto status = EventReactor::attach(inotify_handle_, [this]() {
+      auto status = drain();
+      if (!status.ok()) {
+        VLOG(1) << "inotify drain failed: " << status.getMessage();
+      }
+    });
+    if (status.ok()) {
+      hasReactor(true);
+    }
+  }
   return Status(0, "OK");
 }
 
@@ -110,9 +146,37 @@ void INotifyEventPublisher::configure() {
     }
     monitorSubscription(sc);
   }
+
+  // Subscription paths are final once monitored, compile them for matching.
+  buildPathIndex();
+}
+
+size_t INotifySubscriptionContext::nextMatchID() {
+  static std::atomic<size_t> kMatchID{0};
+  return ++kMatchID;
+}
+
+void INotifyEventPublisher::buildPathIndex() {
+  auto index = std::make_shared<INotifyPathIndex>();
+  WriteLock lock(index_mutex_);
+  for (auto& sub : subscriptions_) {
+    auto sc = getSubscriptionContext(sub->context);
+    if (sc->discovered_.empty()) {
+      // Not yet configured, these are matched without the index.
+      continue;
+    }
+
+    index->add(sc->match_id_, *sc);
+  }
+  path_index_ = index;
 }
 
 void INotifyEventPublisher::tearDown() {
+  if (hasReactor()) {
+    EventReactor::detach(inotify_handle_);
+    hasReactor(false);
+  }
+
   if (inotify_handle_ > -1) {
     ::close(inotify_handle_);
   }
@@ -120,34 +184,39 @@ void INotifyEventPublisher::tearDown() {
 }
 
 Status INotifyEventPublisher::restartMonitoring() {
-  if (last_restart_ != 0 && getUnixTime() - last_restart_ < 10) {
+  overflow_count_++;
+  if (last_restart_ != -1 &&
+      getUnixTime() - last_restart_ < kINotifyRestartInterval) {
+    // Overflows during a burst are counted, the rescan is rate limited.
     return Status(1, "Overflow");
   }
 
   last_restart_ = getUnixTime();
-  VLOG(1) << "inotify was overflown, attempting to restart handle";
+  VLOG(1) << "inotify was overflown, rescanning recursive subscriptions";
 
-  // Create a copy of the descriptors, then remove each.
-  auto descriptors = descriptors_;
-  for (const auto& desc : descriptors) {
-    removeMonitor(desc, true);
-  }
+  // Events were lost but every watch descriptor remains valid. Directories
+  // created during the overflow may be missing watches, rescan to add them.
+  for (auto& sub : subscriptions_) {
+    auto sc = getSubscriptionContext(sub->context);
+    if (!sc->recursive || sc->discovered_.empty()) {
+      continue;
+    }
 
-  {
-    // Then remove all path/descriptor mappings.
-    WriteLock lock(path_mutex_);
-    path_descriptors_.clear();
-    descriptor_paths_.clear();
+    if (sc->recursive_match) {
+      std::vector<std::string> paths;
+      resolveFilePattern(sc->discovered_, paths);
+      for (const auto& _path : paths) {
+        addMonitor(_path, sc->mask, true);
+      }
+    } else {
+      addMonitor(sc->discovered_, sc->mask, true);
+    }
   }
-
-  // Reconfigure ourself, the subscribers will not reconfigure.
-  configure();
   return Status(0, "OK");
 }
 
 Status INotifyEventPublisher::run() {
   // Get a while wrapper for free.
-  char buffer[kINotifyBufferSize];
   fd_set set;
 
   FD_ZERO(&set);
@@ -164,45 +233,97 @@ Status INotifyEventPublisher::run() {
     // Read timeout.
     return Status(0, "Continue");
   }
-  ssize_t record_num = ::read(getHandle(), buffer, kINotifyBufferSize);
-  if (record_num == 0 || record_num == -1) {
-    return Status(1, "INotify read failed");
+
+  auto status = drain();
+  if (!status.ok()) {
+    return status;
   }
 
-  for (char* p = buffer; p < buffer + record_num;) {
-    // Cast the inotify struct, make shared pointer, and append to contexts.
-    auto event = reinterpret_cast<struct inotify_event*>(p);
-    if (event->mask & IN_Q_OVERFLOW) {
-      // The inotify queue was overflown (remove all paths).
-      Status stat = restartMonitoring();
-      if (!stat.ok()) {
-        return stat;
-      }
+  pauseMilli(kINotifyMLatency);
+  return Status(0, "OK");
+}
+
+Status INotifyEventPublisher::drain() {
+  while (!isEnding()) {
+    ssize_t record_num = ::read(getHandle(), buffer_.data(), buffer_.size());
+    if (record_num == -1 && errno == EINTR) {
+      // The read was interrupted before any records were returned.
+      continue;
+    } else if (record_num == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      // The handle is drained.
+      break;
+    } else if (record_num == 0 || record_num == -1) {
+      return Status(1, "INotify read failed");
     }
 
-    if (event->mask & IN_IGNORED) {
-      // This inotify watch was removed.
-      removeMonitor(event->wd, false);
-    } else if (event->mask & IN_MOVE_SELF) {
-      // This inotify path was moved, but is still watched.
-      removeMonitor(event->wd, true);
-    } else if (event->mask & IN_DELETE_SELF) {
-      // A file was moved to replace the watched path.
-      removeMonitor(event->wd, false);
-    } else {
-      auto ec = createEventContextFrom(event);
-      if (!ec->action.empty()) {
-        fire(ec);
+    auto now = std::chrono::duration_cast<std::chrono::milliseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+                   .count();
+    char* buffer = buffer_.data();
+    for (char* p = buffer; p < buffer + record_num;) {
+      // Cast the inotify struct, make shared pointer, and append to contexts.
+      auto event = reinterpret_cast<struct inotify_event*>(p);
+      if (event->mask & IN_Q_OVERFLOW) {
+        // The inotify queue was overflown, events were lost.
+        restartMonitoring();
+      }
+
+      if (event->mask & IN_IGNORED) {
+        // This inotify watch was removed.
+        modifications_.erase(event->wd);
+        removeMonitor(event->wd, false);
+      } else if (event->mask & IN_MOVE_SELF) {
+        // This inotify path was moved, but is still watched.
+        removeMonitor(event->wd, true);
+      } else if (event->mask & IN_DELETE_SELF) {
+        // A file was moved to replace the watched path.
+        removeMonitor(event->wd, false);
+      } else if (isCoalesced(event, static_cast<size_t>(now))) {
+        // A repeat of a recent modification to the same path.
+        coalesced_count_++;
+      } else {
+        auto ec = createEventContextFrom(event);
+        if (!ec->action.empty()) {
+          fire(ec);
+        }
       }
+      // Continue to iterate
+      p += (sizeof(struct inotify_event)) + event->len;
     }
-    // Continue to iterate
-    p += (sizeof(struct inotify_event)) + event->len;
-  }
 
-  pauseMilli(kINotifyMLatency);
+    // A read that nearly filled the buffer indicates a burst, read more at once.
+    if (static_cast<size_t>(record_num) + kINotifyEventSize > buffer_.size() &&
+        buffer_.size() < kINotifyMaxBufferSize) {
+      buffer_.resize(std::min(buffer_.size() * 2, kINotifyMaxBufferSize));
+    }
+  }
   return Status(0, "OK");
 }
 
+bool INotifyEventPublisher::isCoalesced(const struct inotify_event* event,
+                                        size_t now) {
+  if (FLAGS_inotify_coalesce_window == 0) {
+    return false;
+  }
+
+  if (event->mask != IN_MODIFY) {
+    // Any other action on the watch (such as a close) ends the window.
+    modifications_.erase(event->wd);
+    return false;
+  }
+
+  const char* name = (event->len > 0) ? event->name : "";
+  auto last = modifications_.find(event->wd);
+  if (last != modifications_.end() && last->second.first == name &&
+      now - last->second.second < FLAGS_inotify_coalesce_window) {
+    return true;
+  }
+
+  // This modification is fired, and starts a new window for the path.
+  modifications_[event->wd] = std::make_pair(std::string(name), now);
+  return false;
+}
+
 INotifyEventContextRef INotifyEventPublisher::createEventContextFrom(
     struct inotify_event* event) const {
   auto shared_event = std::make_shared<struct inotify_event>(*event);
@@ -211,13 +332,13 @@ INotifyEventContextRef INotifyEventPublisher::createEventContextFrom(
 
   // Get the pathname the watch fired on.
   {
-    WriteLock lock(path_mutex_);
-    if (descriptor_paths_.find(event->wd) == descriptor_paths_.end()) {
+    ReadLock lock(path_mutex_);
+    auto descriptor = descriptor_paths_.find(event->wd);
+    if (descriptor == descriptor_paths_.end()) {
       // return a blank event context if we can't find the paths for the event
       return ec;
-    } else {
-      ec->path = descriptor_paths_.at(event->wd);
     }
+    ec->path = descriptor->second;
   }
 
   if (event->len > 1) {
@@ -230,6 +351,17 @@ INotifyEventContextRef INotifyEventPublisher::createEventContextFrom(
       break;
     }
   }
+
+  if (!ec->action.empty()) {
+    // Resolve every matching subscription once, rather than in shouldFire.
+    {
+      WriteLock lock(index_mutex_);
+      ec->index_ = path_index_;
+    }
+    if (ec->index_ != nullptr) {
+      ec->index_->match(ec->path, ec->matches_);
+    }
+  }
   return ec;
 }
 
@@ -240,19 +372,13 @@ bool INotifyEventPublisher::shouldFire(const INotifySubscriptionContextRef& sc,
     return false;
   }
 
-  if (sc->recursive && !sc->recursive_match) {
-    ssize_t found = ec->path.find(sc->path);
-    if (found != 0) {
+  if (ec->index_ != nullptr && ec->index_->contains(sc->match_id_)) {
+    if (!std::binary_search(
+            ec->matches_.begin(), ec->matches_.end(), sc->match_id_)) {
       return false;
     }
-  } else if (ec->path == sc->path) {
-    return true;
-  } else if (fnmatch((sc->path + "*").c_str(),
-                     ec->path.c_str(),
-                     FNM_PATHNAME | FNM_CASEFOLD |
-                         ((sc->recursive_match) ? FNM_LEADING_DIR : 0)) != 0) {
-    // Only apply a leading-dir match if this is a recursive watch with a
-    // match requirement (an inline wildcard with ending recursive wildcard).
+  } else if (!INotifyPathIndex::matches(*sc, ec->path)) {
+    // The subscription was added after the index was built.
     return false;
   }
 
@@ -278,7 +404,7 @@ bool INotifyEventPublisher::addMonitor(const std::string& path,
     }
 
     {
-      WriteLock lock(path_mutex_);
+      ExclusiveLock lock(path_mutex_);
       // Keep a list of the watch descriptors
       descriptors_.push_back(watch);
       // Keep a map of the path -> watch descriptor
@@ -305,7 +431,7 @@ bool INotifyEventPublisher::addMonitor(const std::string& path,
 
 bool INotifyEventPublisher::removeMonitor(const std::string& path, bool force) {
   {
-    WriteLock lock(path_mutex_);
+    ReadLock lock(path_mutex_);
     // If force then remove from INotify, otherwise cleanup file descriptors.
     if (path_descriptors_.find(path) == path_descriptors_.end()) {
       return false;
@@ -314,8 +440,13 @@ bool INotifyEventPublisher::removeMonitor(const std::string& path, bool force) {
 
   int watch = 0;
   {
-    WriteLock lock(path_mutex_);
-    watch = path_descriptors_[path];
+    ExclusiveLock lock(path_mutex_);
+    auto path_iterator = path_descriptors_.find(path);
+    if (path_iterator == path_descriptors_.end()) {
+      // Removed by another caller since the check.
+      return false;
+    }
+    watch = path_iterator->second;
     path_descriptors_.erase(path);
     descriptor_paths_.erase(watch);
 
@@ -332,25 +463,31 @@ bool INotifyEventPublisher::removeMonitor(const std::string& path, bool force) {
 bool INotifyEventPublisher::removeMonitor(int watch, bool force) {
   std::string path;
   {
-    WriteLock lock(path_mutex_);
-    if (descriptor_paths_.find(watch) == descriptor_paths_.end()) {
+    ReadLock lock(path_mutex_);
+    auto descriptor = descriptor_paths_.find(watch);
+    if (descriptor == descriptor_paths_.end()) {
       return false;
     }
-    path = descriptor_paths_[watch];
+    path = descriptor->second;
   }
   return removeMonitor(path, force);
 }
 
 void INotifyEventPublisher::removeSubscriptions(const std::string& subscriber) {
-  auto paths = descriptor_paths_;
+  DescriptorPathMap paths;
+  {
+    ReadLock lock(path_mutex_);
+    paths = descriptor_paths_;
+  }
   for (const auto& path : paths) {
     removeMonitor(path.first, true);
   }
   EventPublisherPlugin::removeSubscriptions(subscriber);
+  buildPathIndex();
 }
 
 bool INotifyEventPublisher::isPathMonitored(const std::string& path) const {
-  WriteLock lock(path_mutex_);
+  ReadLock lock(path_mutex_);
   std::string parent_path;
   if (!isDirectory(path).ok()) {
     if (path_descriptors_.find(path) != path_descriptors_.end()) {
@@ -366,4 +503,138 @@ bool INotifyEventPublisher::isPathMonitored(const std::string& path) const {
   auto path_iterator = path_descriptors_.find(parent_path);
   return (path_iterator != path_descriptors_.end());
 }
+
+bool INotifyPathIndex::matches(const INotifySubscriptionContext& sc,
+                               const std::string& path) {
+  if (sc.recursive && !sc.recursive_match) {
+    return path.compare(0, sc.path.size(), sc.path) == 0;
+  } else if (path == sc.path) {
+    return true;
+  }
+
+  // Only apply a leading-dir match if this is a recursive watch with a
+  // match requirement (an inline wildcard with ending recursive wildcard).
+  return fnmatch((sc.path + "*").c_str(),
+                 path.c_str(),
+                 FNM_PATHNAME | FNM_CASEFOLD |
+                     ((sc.recursive_match) ? FNM_LEADING_DIR : 0)) == 0;
+}
+
+uint32_t INotifyPathIndex::insert(std::vector<Node>& trie,
+                                  const std::string& literal,
+                                  bool fold) {
+  uint32_t node = 0;
+  for (auto c : literal) {
+    if (fold) {
+      c = static_cast<char>(::tolower(static_cast<unsigned char>(c)));
+    }
+
+    auto& children = trie[node].children;
+    auto child = std::lower_bound(children.begin(),
+                                  children.end(),
+                                  std::make_pair(c, uint32_t(0)));
+    if (child != children.end() && child->first == c) {
+      node = child->second;
+      continue;
+    }
+
+    auto next = static_cast<uint32_t>(trie.size());
+    children.insert(child, std::make_pair(c, next));
+    // The children reference is invalid after the trie grows.
+    trie.emplace_back();
+    node = next;
+  }
+  return node;
+}
+
+template <typename Completion>
+void INotifyPathIndex::walk(const std::vector<Node>& trie,
+                            const std::string& path,
+                            bool fold,
+                            Completion complete) {
+  uint32_t node = 0;
+  for (size_t depth = 0;; depth++) {
+    for (const auto& entry : trie[node].entries) {
+      complete(entry, depth);
+    }
+
+    if (depth == path.size()) {
+      break;
+    }
+
+    auto c = path[depth];
+    if (fold) {
+      c = static_cast<char>(::tolower(static_cast<unsigned char>(c)));
+    }
+
+    const auto& children = trie[node].children;
+    auto child = std::lower_bound(children.begin(),
+                                  children.end(),
+                                  std::make_pair(c, uint32_t(0)));
+    if (child == children.end() || child->first != c) {
+      break;
+    }
+    node = child->second;
+  }
+}
+
+void INotifyPathIndex::add(size_t id, const INotifySubscriptionContext& sc) {
+  Entry entry;
+  entry.id = id;
+  entry.path = sc.path;
+  entry.flags = 0;
+
+  auto position = static_cast<uint32_t>(entries_.size());
+  if (sc.recursive && !sc.recursive_match) {
+    entry.type = MatchType::PREFIX;
+    prefixes_[insert(prefixes_, sc.path, false)].entries.push_back(position);
+  } else {
+    // Subscriptions match "path*", the literal is the path before a pattern.
+    auto literal = sc.path.substr(0, sc.path.find_first_of("*?[\\"));
+    if (literal.size() == sc.path.size() && !sc.recursive_match) {
+      entry.type = MatchType::NAME;
+    } else {
+      entry.type = MatchType::GLOB;
+      entry.pattern = sc.path + "*";
+      entry.flags = FNM_PATHNAME | FNM_CASEFOLD |
+                    ((sc.recursive_match) ? FNM_LEADING_DIR : 0);
+    }
+    names_[insert(names_, literal, true)].entries.push_back(position);
+  }
+  entries_.push_back(std::move(entry));
+
+  ids_.insert(std::upper_bound(ids_.begin(), ids_.end(), id), id);
+}
+
+void INotifyPathIndex::match(const std::string& path,
+                             std::vector<size_t>& ids) const {
+  ids.clear();
+  walk(prefixes_, path, false, [this, &ids](uint32_t entry, size_t depth) {
+    ids.push_back(entries_[entry].id);
+  });
+
+  walk(names_,
+       path,
+       true,
+       [this, &path, &ids](uint32_t position, size_t depth) {
+         const auto& entry = entries_[position];
+         if (entry.type == MatchType::NAME) {
+           // The trailing wildcard does not match path separators.
+           if (path.find('/', depth) == std::string::npos) {
+             ids.push_back(entry.id);
+           }
+         } else if (path == entry.path ||
+                    fnmatch(entry.pattern.c_str(), path.c_str(), entry.flags) ==
+                        0) {
+           ids.push_back(entry.id);
+         }
+       });
+
+  std::sort(ids.begin(), ids.end());
+  ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+}
+
+bool INotifyPathIndex::contains(size_t id) const {
+  return std::binary_search(ids_.begin(), ids_.end(), id);
+}
 }
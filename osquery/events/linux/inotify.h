@@ -10,12 +10,18 @@
 
 #pragma once
 
+#include <atomic>
 #include <map>
+#include <memory>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include <sys/inotify.h>
 #include <sys/stat.h>
 
+#include <boost/noncopyable.hpp>
+
 #include <osquery/events.h>
 
 namespace osquery {
@@ -25,6 +31,8 @@ extern std::map<int, std::string> kMaskActions;
 extern const uint32_t kFileDefaultMasks;
 extern const uint32_t kFileAccessMasks;
 
+class INotifyPathIndex;
+
 /**
  * @brief Subscription details for INotifyEventPublisher events.
  *
@@ -71,8 +79,15 @@ struct INotifySubscriptionContext : public SubscriptionContext {
   /// A configure-time pattern was expanded to match absolute paths.
   bool recursive_match{false};
 
+  /// Identifies this subscription within the publisher's path index.
+  size_t match_id_{nextMatchID()};
+
+  /// Assign a unique identifier when a subscription is created.
+  static size_t nextMatchID();
+
  private:
   friend class INotifyEventPublisher;
+  friend class INotifyPathIndex;
 };
 
 /**
@@ -90,16 +105,116 @@ struct INotifyEventContext : public EventContext {
 
   /// A no-op event transaction id.
   uint32_t transaction_id{0};
+
+ private:
+  /// The path index used to resolve matching subscriptions.
+  std::shared_ptr<const INotifyPathIndex> index_{nullptr};
+
+  /// Sorted match identifiers of the indexed subscriptions matching the path.
+  std::vector<size_t> matches_;
+
+ private:
+  friend class INotifyEventPublisher;
 };
 
 using INotifyEventContextRef = std::shared_ptr<INotifyEventContext>;
 using INotifySubscriptionContextRef =
     std::shared_ptr<INotifySubscriptionContext>;
 
+/**
+ * @brief Subscription paths compiled for matching event paths.
+ *
+ * Every subscription path is reduced to its literal prefix (the path before
+ * any wildcard) and stored in a character trie. Walking an event path through
+ * the trie once yields the subscriptions whose prefix matches. Recursive and
+ * wildcard-free subscriptions need no further work; only subscriptions with
+ * an inline wildcard whose prefix matched fall back to fnmatch.
+ *
+ * The index is built by the publisher after configure and is immutable, so
+ * events may use an index while a replacement is built.
+ */
+class INotifyPathIndex : private boost::noncopyable {
+ public:
+  /**
+   * @brief Compile a configured subscription into the index.
+   *
+   * @param id a non-zero identifier returned from match.
+   * @param sc the subscription, after the publisher has monitored its path.
+   */
+  void add(size_t id, const INotifySubscriptionContext& sc);
+
+  /// Collect the sorted identifiers of subscriptions matching a path.
+  void match(const std::string& path, std::vector<size_t>& ids) const;
+
+  /// Check if a subscription identifier was compiled into this index.
+  bool contains(size_t id) const;
+
+  /// The number of compiled subscriptions.
+  size_t size() const {
+    return entries_.size();
+  }
+
+  /// The uncompiled match of a subscription path, which the index implements.
+  static bool matches(const INotifySubscriptionContext& sc,
+                      const std::string& path);
+
+ private:
+  /// How a subscription whose literal prefix matched is completed.
+  enum class MatchType {
+    /// A recursive subscription, any path beneath the prefix.
+    PREFIX,
+    /// The prefix and a name, without further path components.
+    NAME,
+    /// An inline wildcard, the pattern is matched with fnmatch.
+    GLOB,
+  };
+
+  struct Entry {
+    size_t id;
+    MatchType type;
+    std::string path;
+    std::string pattern;
+    int flags;
+  };
+
+  struct Node {
+    /// Sorted (character, node) transitions.
+    std::vector<std::pair<char, uint32_t>> children;
+
+    /// Entries whose literal prefix ends at this node.
+    std::vector<uint32_t> entries;
+  };
+
+  /// Add a literal to a trie and return its final node.
+  static uint32_t insert(std::vector<Node>& trie,
+                         const std::string& literal,
+                         bool fold);
+
+  /// Walk a path through a trie, calling the completion for each entry.
+  template <typename Completion>
+  static void walk(const std::vector<Node>& trie,
+                   const std::string& path,
+                   bool fold,
+                   Completion complete);
+
+ private:
+  /// Case-sensitive literals of recursive subscriptions.
+  std::vector<Node> prefixes_{1};
+
+  /// Case-folded literals, subscription matching uses FNM_CASEFOLD.
+  std::vector<Node> names_{1};
+
+  /// The compiled subscriptions.
+  std::vector<Entry> entries_;
+
+  /// Sorted identifiers of the compiled subscriptions.
+  std::vector<size_t> ids_;
+};
+
 // Publisher containers
 using DescriptorVector = std::vector<int>;
 using PathDescriptorMap = std::map<std::string, int>;
-using DescriptorPathMap = std::map<int, std::string>;
+using DescriptorPathMap = std::unordered_map<int, std::string>;
 
 /**
  * @brief A Linux `inotify` EventPublisher.
@@ -134,14 +249,33 @@ class INotifyEventPublisher
   /// The calling for beginning the thread's run loop.
   Status run() override;
 
+  /// Read and fire events until the handle would block.
+  Status drain();
+
   /// Remove all monitors and subscriptions.
   void removeSubscriptions(const std::string& subscriber) override;
 
+  /// Compile the configured subscriptions into a new path index.
+  void buildPathIndex();
+
  private:
   /// Helper/specialized event context creation.
   INotifyEventContextRef createEventContextFrom(
       struct inotify_event* event) const;
 
+  /**
+   * @brief Check if an event repeats a recent modification of the same path.
+   *
+   * Writes to a file produce an IN_MODIFY per write. Within the
+   * `--inotify_coalesce_window` only the first is fired; any other action on
+   * the watch ends the window.
+   *
+   * @param event the inotify record read from the handle.
+   * @param now a monotonic time in milliseconds.
+   * @return true if the event should be dropped.
+   */
+  bool isCoalesced(const struct inotify_event* event, size_t now);
+
   /// Check if the application-global `inotify` handle is alive.
   bool isHandleOpen() const {
     return inotify_handle_ > 0;
@@ -192,7 +326,7 @@ class INotifyEventPublisher
     return descriptors_.size();
   }
 
-  /// If we overflow, try and restart the monitor
+  /// If we overflow, count the loss and rescan recursive subscriptions.
   Status restartMonitoring();
 
   // Consider an event queue if separating buffering from firing/servicing.
@@ -210,8 +344,20 @@ class INotifyEventPublisher
   /// Time in seconds of the last inotify restart.
   std::atomic<int> last_restart_{-1};
 
-  /// Access to path and descriptor mappings.
-  mutable Mutex path_mutex_;
+  /// Access to path and descriptor mappings, written only when watches change.
+  mutable ReadWriteMutex path_mutex_;
+
+  /// Reusable read buffer, grown during event bursts.
+  std::vector<char> buffer_;
+
+  /// Map of watch descriptor to the last fired modification (name, time).
+  std::unordered_map<int, std::pair<std::string, size_t>> modifications_;
+
+  /// The compiled subscription paths, replaced when subscriptions change.
+  std::shared_ptr<const INotifyPathIndex> path_index_{nullptr};
+
+  /// Access to the path index.
+  mutable Mutex index_mutex_;
 
  public:
   friend class INotifyTests;
@@ -220,5 +366,7 @@ class INotifyEventPublisher
   FRIEND_TEST(INotifyTests, test_inotify_recursion);
   FRIEND_TEST(INotifyTests, test_inotify_match_subscription);
   FRIEND_TEST(INotifyTests, test_inotify_embedded_wildcards);
+  FRIEND_TEST(INotifyTests, test_inotify_coalesce);
+  FRIEND_TEST(INotifyTests, test_inotify_path_index);
 };
 }
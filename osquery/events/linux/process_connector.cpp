@@ -0,0 +1,311 @@
+/*
+ *  Copyright (c) 2014-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <utility>
+
+#include <linux/cn_proc.h>
+#include <linux/connector.h>
+#include <linux/netlink.h>
+
+#include <osquery/flags.h>
+#include <osquery/logger.h>
+#include <osquery/system.h>
+
+#include "osquery/events/linux/process_connector.h"
+#include "osquery/events/linux/reactor.h"
+
+namespace osquery {
+
+/// The proc connector requires CAP_NET_ADMIN and is an alternative to audit.
+FLAG(bool,
+     disable_proc_connector,
+     true,
+     "Disable receiving process events from the netlink proc connector");
+
+/// Size of each receive; many small connector messages fit in one read.
+static const size_t kProcConnectorBufferSize = 64 * 1024;
+
+/// Requested kernel socket buffer, process storms overrun the default.
+static const int kProcConnectorSocketBuffer = 4 * 1024 * 1024;
+
+/// Poll timeout used to let the publisher observe an ending state.
+static const int kProcConnectorMLatency = 1000;
+
+REGISTER(ProcConnectorEventPublisher, "event_publisher", "proc_connector");
+
+Status ProcConnectorEventPublisher::setUp() {
+  if (FLAGS_disable_proc_connector) {
+    return Status(1, "Publisher disabled via configuration");
+  }
+
+  WriteLock lock(mutex_);
+  socket_ = ::socket(PF_NETLINK,
+                     SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC,
+                     NETLINK_CONNECTOR);
+  if (socket_ < 0) {
+    return Status(1, "Could not open proc connector socket");
+  }
+
+  // Prefer a forced buffer size (requires CAP_NET_ADMIN, which the connector
+  // requires anyway) and fall back to the sysctl-limited size.
+  int size = kProcConnectorSocketBuffer;
+  if (setsockopt(socket_, SOL_SOCKET, SO_RCVBUFFORCE, &size, sizeof(size)) !=
+      0) {
+    setsockopt(socket_, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+  }
+
+  struct sockaddr_nl addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.nl_family = AF_NETLINK;
+  addr.nl_groups = CN_IDX_PROC;
+  if (::bind(socket_, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+    ::close(socket_);
+    socket_ = -1;
+    return Status(1, "Could not bind proc connector socket");
+  }
+
+  auto status = control(true);
+  if (!status.ok()) {
+    ::close(socket_);
+    socket_ = -1;
+    return status;
+  }
+
+  buffer_.resize(kProcConnectorBufferSize);
+  if (EventReactor::enabled()) {
+    // Messages are drained from the shared reactor thread.
+    auto fd = socket_;
+    if (EventReactor::attach(fd, [this, fd]() { drain(fd); }).ok()) {
+      hasReactor(true);
+    }
+  }
+  return Status(0, "OK");
+}
+
+void ProcConnectorEventPublisher::tearDown() {
+  if (hasReactor()) {
+    // Detach before locking, a running drain must be allowed to finish.
+    EventReactor::detach(socket_);
+    hasReactor(false);
+  }
+
+  WriteLock lock(mutex_);
+  if (socket_ >= 0) {
+    control(false);
+    ::close(socket_);
+    socket_ = -1;
+  }
+}
+
+Status ProcConnectorEventPublisher::control(bool listen) {
+  // A netlink header, connector header, and the multicast operation.
+  char request[NLMSG_SPACE(sizeof(struct cn_msg) +
+                           sizeof(enum proc_cn_mcast_op))];
+  memset(request, 0, sizeof(request));
+
+  auto nlh = reinterpret_cast<struct nlmsghdr*>(request);
+  nlh->nlmsg_len = sizeof(request);
+  nlh->nlmsg_type = NLMSG_DONE;
+  nlh->nlmsg_pid = getpid();
+
+  auto cn = static_cast<struct cn_msg*>(NLMSG_DATA(nlh));
+  cn->id.idx = CN_IDX_PROC;
+  cn->id.val = CN_VAL_PROC;
+  cn->len = sizeof(enum proc_cn_mcast_op);
+
+  enum proc_cn_mcast_op op =
+      (listen) ? PROC_CN_MCAST_LISTEN : PROC_CN_MCAST_IGNORE;
+  memcpy(cn->data, &op, sizeof(op));
+
+  if (::send(socket_, &request, sizeof(request), 0) < 0) {
+    return Status(1, "Could not request proc connector events");
+  }
+  return Status(0, "OK");
+}
+
+Status ProcConnectorEventPublisher::decode(
+    const char* data, size_t size, const ProcConnectorEventContextRef& ec) {
+  if (size < sizeof(struct cn_msg)) {
+    return Status(1, "Truncated connector message");
+  }
+
+  auto cn = reinterpret_cast<const struct cn_msg*>(data);
+  if (cn->id.idx != CN_IDX_PROC || cn->id.val != CN_VAL_PROC) {
+    return Status(1, "Not a proc connector message");
+  }
+
+  // The event payload is smaller for older kernels, but always contains the
+  // header fields and the largest union member osquery reads (fork/exit).
+  size_t event_size = offsetof(struct proc_event, event_data) +
+                      sizeof(std::declval<struct proc_event>().event_data.fork);
+  if (cn->len < event_size || size < sizeof(struct cn_msg) + event_size) {
+    return Status(1, "Truncated proc event");
+  }
+
+  struct proc_event event;
+  memset(&event, 0, sizeof(event));
+  memcpy(&event,
+         data + sizeof(struct cn_msg),
+         std::min(static_cast<size_t>(cn->len), sizeof(event)));
+
+  ec->what = event.what;
+  ec->timestamp_ns = event.timestamp_ns;
+  switch (event.what) {
+  case proc_event::PROC_EVENT_FORK:
+    ec->parent_pid = event.event_data.fork.parent_pid;
+    ec->parent_tgid = event.event_data.fork.parent_tgid;
+    ec->pid = event.event_data.fork.child_pid;
+    ec->tgid = event.event_data.fork.child_tgid;
+    break;
+  case proc_event::PROC_EVENT_EXEC:
+    ec->pid = event.event_data.exec.process_pid;
+    ec->tgid = event.event_data.exec.process_tgid;
+    break;
+  case proc_event::PROC_EVENT_UID:
+    ec->pid = event.event_data.id.process_pid;
+    ec->tgid = event.event_data.id.process_tgid;
+    ec->real_id = event.event_data.id.r.ruid;
+    ec->effective_id = event.event_data.id.e.euid;
+    break;
+  case proc_event::PROC_EVENT_GID:
+    ec->pid = event.event_data.id.process_pid;
+    ec->tgid = event.event_data.id.process_tgid;
+    ec->real_id = event.event_data.id.r.rgid;
+    ec->effective_id = event.event_data.id.e.egid;
+    break;
+  case proc_event::PROC_EVENT_EXIT:
+    ec->pid = event.event_data.exit.process_pid;
+    ec->tgid = event.event_data.exit.process_tgid;
+    ec->exit_code = event.event_data.exit.exit_code;
+    ec->exit_signal = event.event_data.exit.exit_signal;
+    break;
+  default:
+    // Acknowledgements and event types osquery does not publish.
+    return Status(1, "Unsupported proc event");
+  }
+  return Status(0, "OK");
+}
+
+void ProcConnectorEventPublisher::count(size_t events) {
+  auto now = getUnixTime();
+  if (now != window_start_) {
+    // A window with no reads since the last complete second had no events.
+    events_per_second_ = (now == window_start_ + 1) ? window_events_.load() : 0;
+    window_start_ = now;
+    window_events_ = 0;
+  }
+  window_events_ += events;
+}
+
+size_t ProcConnectorEventPublisher::eventsPerSecond() const {
+  // The window is only rolled by reads, so it may have ended without events.
+  auto now = getUnixTime();
+  auto start = window_start_.load();
+  if (now == start) {
+    return events_per_second_;
+  } else if (now == start + 1) {
+    return window_events_;
+  }
+  return 0;
+}
+
+Status ProcConnectorEventPublisher::run() {
+  int fd = -1;
+  {
+    WriteLock lock(mutex_);
+    if (socket_ < 0) {
+      return Status(1, "No proc connector socket");
+    }
+    fd = socket_;
+  }
+
+  struct pollfd pfd;
+  pfd.fd = fd;
+  pfd.events = POLLIN;
+  pfd.revents = 0;
+  int selector = ::poll(&pfd, 1, kProcConnectorMLatency);
+  if (selector == -1 && errno != EINTR) {
+    LOG(ERROR) << "Could not read proc connector socket";
+    return Status(1, "proc connector failed");
+  }
+
+  drain(fd);
+  return Status(0, "OK");
+}
+
+void ProcConnectorEventPublisher::drain(int fd) {
+  // Drain every queued message; the factory pauses between run calls and the
+  // connector is multicast, so a slow reader loses events to ENOBUFS.
+  size_t received = 0;
+  while (!isEnding()) {
+    auto len = ::recv(fd, buffer_.data(), buffer_.size(), 0);
+    if (len < 0) {
+      if (errno == ENOBUFS) {
+        // Socket overruns are reported as publisher overflows.
+        if (overflow_count_++ == 0) {
+          LOG(WARNING) << "Process connector socket overrun, events dropped";
+        } else {
+          VLOG(1) << "Process connector overruns: " << overflow_count_;
+        }
+        continue;
+      } else if (errno == EINTR) {
+        continue;
+      }
+      // EAGAIN, the socket is drained.
+      break;
+    } else if (len == 0) {
+      break;
+    }
+
+    auto nlh = reinterpret_cast<struct nlmsghdr*>(buffer_.data());
+    for (int remaining = static_cast<int>(len); NLMSG_OK(nlh, remaining);
+         nlh = NLMSG_NEXT(nlh, remaining)) {
+      if (nlh->nlmsg_type == NLMSG_NOOP) {
+        continue;
+      } else if (nlh->nlmsg_type == NLMSG_ERROR ||
+                 nlh->nlmsg_type == NLMSG_OVERRUN) {
+        overflow_count_++;
+        continue;
+      }
+
+      auto ec = createEventContext();
+      auto payload = static_cast<const char*>(NLMSG_DATA(nlh));
+      if (decode(payload, NLMSG_PAYLOAD(nlh, 0), ec).ok()) {
+        received++;
+        fire(ec);
+      }
+    }
+  }
+
+  count(received);
+}
+
+bool ProcConnectorEventPublisher::shouldFire(
+    const ProcConnectorSubscriptionContextRef& sc,
+    const ProcConnectorEventContextRef& ec) const {
+  if ((sc->events & ec->what) == 0) {
+    return false;
+  }
+
+  // Threads are forks sharing the parent's thread group.
+  if (sc->skip_threads && ec->what == PROC_CONNECTOR_FORK &&
+      ec->pid != ec->tgid) {
+    return false;
+  }
+  return true;
+}
+}
@@ -0,0 +1,151 @@
+/*
+ *  Copyright (c) 2014-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+
+#pragma once
+
+#include <atomic>
+#include <vector>
+
+#include <osquery/events.h>
+#include <osquery/status.h>
+
+namespace osquery {
+
+/**
+ * @brief Process connector event types.
+ *
+ * These match the kernel's proc_event 'what' values, which are bit flags and
+ * may be combined into a subscription mask.
+ */
+enum ProcConnectorEventType : uint32_t {
+  PROC_CONNECTOR_NONE = 0x00000000,
+  PROC_CONNECTOR_FORK = 0x00000001,
+  PROC_CONNECTOR_EXEC = 0x00000002,
+  PROC_CONNECTOR_UID = 0x00000004,
+  PROC_CONNECTOR_GID = 0x00000040,
+  PROC_CONNECTOR_EXIT = 0x80000000,
+  PROC_CONNECTOR_ALL = 0x80000047,
+};
+
+/// Subscription details for ProcConnectorEventPublisher events.
+struct ProcConnectorSubscriptionContext : public SubscriptionContext {
+  /// A mask of ProcConnectorEventType%s to receive.
+  uint32_t events{PROC_CONNECTOR_ALL};
+
+  /// Ignore fork events creating threads within an existing thread group.
+  bool skip_threads{true};
+};
+
+/**
+ * @brief Event details for ProcConnectorEventPublisher events.
+ *
+ * The kernel only reports identifiers, anything else about the process must
+ * be read from /proc by the subscriber while the process still exists.
+ */
+struct ProcConnectorEventContext : public EventContext {
+  /// The ProcConnectorEventType.
+  uint32_t what{PROC_CONNECTOR_NONE};
+
+  /// The thread ID and thread group ID (process ID) of the event.
+  pid_t pid{0};
+  pid_t tgid{0};
+
+  /// Fork only: the parent thread and thread group ID.
+  pid_t parent_pid{0};
+  pid_t parent_tgid{0};
+
+  /// UID and GID only: the real and effective user or group ID.
+  uint32_t real_id{0};
+  uint32_t effective_id{0};
+
+  /// Exit only: the wait(2)-style exit code and signal.
+  uint32_t exit_code{0};
+  uint32_t exit_signal{0};
+
+  /// The kernel's monotonic event timestamp in nanoseconds.
+  uint64_t timestamp_ns{0};
+};
+
+using ProcConnectorEventContextRef = std::shared_ptr<ProcConnectorEventContext>;
+using ProcConnectorSubscriptionContextRef =
+    std::shared_ptr<ProcConnectorSubscriptionContext>;
+
+/**
+ * @brief A Linux NETLINK_CONNECTOR process events publisher.
+ *
+ * The proc connector multicasts a small binary record for every fork, exec,
+ * exit, and credential change. This is much cheaper than audit for following
+ * process execution but requires the subscriber to enrich events from /proc.
+ */
+class ProcConnectorEventPublisher
+    : public EventPublisher<ProcConnectorSubscriptionContext,
+                            ProcConnectorEventContext> {
+  DECLARE_PUBLISHER("proc_connector");
+
+ public:
+  virtual ~ProcConnectorEventPublisher() {
+    tearDown();
+  }
+
+  Status setUp() override;
+
+  void tearDown() override;
+
+  Status run() override;
+
+  /**
+   * @brief Decode a single connector message payload into an event context.
+   *
+   * @param data The netlink message payload, beginning with a cn_msg.
+   * @param size The size of the payload in bytes.
+   * @param ec The output event context.
+   * @return Failure if the payload is truncated or not a process event.
+   */
+  static Status decode(const char* data,
+                       size_t size,
+                       const ProcConnectorEventContextRef& ec);
+
+  /// The number of events received during the last full second.
+  size_t eventsPerSecond() const override;
+
+ private:
+  /// Request (or stop) multicast delivery of process events.
+  Status control(bool listen);
+
+  /// Read and fire every queued message without blocking.
+  void drain(int fd);
+
+  /// Account for received events and roll the one-second throughput window.
+  void count(size_t events);
+
+  /// Check subscription details.
+  bool shouldFire(const ProcConnectorSubscriptionContextRef& sc,
+                  const ProcConnectorEventContextRef& ec) const override;
+
+ private:
+  /// The netlink connector socket.
+  int socket_{-1};
+
+  /// Receive buffer reused for every read.
+  std::vector<char> buffer_;
+
+  /// Start of the current one-second throughput window, in seconds.
+  std::atomic<size_t> window_start_{0};
+
+  /// Events counted in the current throughput window.
+  std::atomic<size_t> window_events_{0};
+
+  /// Events counted in the last complete throughput window.
+  std::atomic<size_t> events_per_second_{0};
+
+  /// Protection around the socket.
+  Mutex mutex_;
+};
+}
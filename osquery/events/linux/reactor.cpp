@@ -0,0 +1,154 @@
+/*
+ *  Copyright (c) 2014-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <osquery/flags.h>
+#include <osquery/logger.h>
+
+#include "osquery/events/linux/reactor.h"
+
+namespace osquery {
+
+FLAG(bool,
+     events_reactor,
+     false,
+     "Service Linux event publishers from a single epoll thread");
+
+/// Maximum number of ready descriptors handled per wakeup.
+static const int kReactorMaxEvents = 32;
+
+/// Wait timeout, the reactor is woken explicitly when stopping.
+static const int kReactorMLatency = 1000;
+
+std::atomic<bool> EventReactor::started_{false};
+
+EventReactor::EventReactor() {
+  epoll_ = ::epoll_create1(EPOLL_CLOEXEC);
+  wake_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (epoll_ >= 0 && wake_ >= 0) {
+    struct epoll_event event;
+    event.events = EPOLLIN;
+    event.data.fd = wake_;
+    ::epoll_ctl(epoll_, EPOLL_CTL_ADD, wake_, &event);
+  }
+}
+
+EventReactor::~EventReactor() {
+  if (wake_ >= 0) {
+    ::close(wake_);
+  }
+  if (epoll_ >= 0) {
+    ::close(epoll_);
+  }
+}
+
+bool EventReactor::enabled() {
+  return FLAGS_events_reactor;
+}
+
+std::shared_ptr<EventReactor> EventReactor::instance() {
+  static auto reactor = std::make_shared<EventReactor>();
+  return reactor;
+}
+
+Status EventReactor::attach(int fd, Callback ready) {
+  auto reactor = instance();
+  auto status = reactor->add(fd, std::move(ready));
+  if (!status.ok()) {
+    return status;
+  }
+
+  if (!started_.exchange(true)) {
+    status = Dispatcher::addService(reactor);
+    if (!status.ok()) {
+      started_ = false;
+      reactor->remove(fd);
+      return status;
+    }
+  }
+  return Status(0, "OK");
+}
+
+void EventReactor::detach(int fd) {
+  instance()->remove(fd);
+}
+
+Status EventReactor::add(int fd, Callback ready) {
+  if (epoll_ < 0 || fd < 0) {
+    return Status(1, "Cannot add descriptor to reactor");
+  }
+
+  RecursiveLock lock(mutex_);
+  struct epoll_event event;
+  event.events = EPOLLIN;
+  event.data.fd = fd;
+  if (::epoll_ctl(epoll_, EPOLL_CTL_ADD, fd, &event) != 0) {
+    return Status(1, "Cannot add descriptor to reactor");
+  }
+  callbacks_[fd] = std::move(ready);
+  return Status(0, "OK");
+}
+
+void EventReactor::remove(int fd) {
+  // Callbacks run with the lock held, this waits for an in-flight callback.
+  RecursiveLock lock(mutex_);
+  if (callbacks_.erase(fd) > 0) {
+    ::epoll_ctl(epoll_, EPOLL_CTL_DEL, fd, nullptr);
+  }
+}
+
+size_t EventReactor::size() const {
+  RecursiveLock lock(mutex_);
+  return callbacks_.size();
+}
+
+void EventReactor::start() {
+  struct epoll_event events[kReactorMaxEvents];
+  while (!interrupted()) {
+    auto count =
+        ::epoll_wait(epoll_, events, kReactorMaxEvents, kReactorMLatency);
+    if (count < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      LOG(WARNING) << "Event reactor wait failed: " << errno;
+      break;
+    }
+
+    for (int i = 0; i < count; i++) {
+      auto fd = events[i].data.fd;
+      if (fd == wake_) {
+        uint64_t value = 0;
+        ::read(wake_, &value, sizeof(value));
+        continue;
+      }
+
+      // The descriptor may have been removed by an earlier callback.
+      // Call a copy, the callback may remove its own registration.
+      RecursiveLock lock(mutex_);
+      auto callback = callbacks_.find(fd);
+      if (callback != callbacks_.end() && callback->second != nullptr) {
+        auto ready = callback->second;
+        ready();
+      }
+    }
+  }
+}
+
+void EventReactor::stop() {
+  if (wake_ >= 0) {
+    uint64_t value = 1;
+    ::write(wake_, &value, sizeof(value));
+  }
+}
+}
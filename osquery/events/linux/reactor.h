@@ -0,0 +1,102 @@
+/*
+ *  Copyright (c) 2014-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <map>
+#include <memory>
+
+#include <osquery/core.h>
+#include <osquery/dispatcher.h>
+#include <osquery/status.h>
+
+namespace osquery {
+
+/**
+ * @brief A shared epoll-driven event loop for Linux event publishers.
+ *
+ * By default each EventPublisher owns a thread that calls its run method and
+ * then pauses. When `--events_reactor` is enabled, publishers that support it
+ * instead register their descriptors with the reactor. A single thread waits
+ * on every registered descriptor and calls the owning publisher's readiness
+ * callback, which must drain the descriptor (read until EAGAIN).
+ *
+ * The reactor only sleeps in epoll_wait, so there is no added latency between
+ * a descriptor becoming readable and the publisher firing events.
+ */
+class EventReactor : public InternalRunnable {
+ public:
+  /// A readiness callback, called from the reactor thread.
+  using Callback = std::function<void()>;
+
+ public:
+  EventReactor();
+  virtual ~EventReactor();
+
+  /// Check if publishers should use the shared reactor.
+  static bool enabled();
+
+  /**
+   * @brief Register a descriptor with the shared reactor.
+   *
+   * The shared reactor's thread is started as a dispatcher service on the first
+   * attach. The callback is called whenever the descriptor is readable.
+   */
+  static Status attach(int fd, Callback ready);
+
+  /**
+   * @brief Remove a descriptor from the shared reactor.
+   *
+   * When detach returns the descriptor's callback is not running and will not
+   * be called again, so the caller may close the descriptor. A publisher must
+   * not hold a lock its callback acquires while detaching.
+   */
+  static void detach(int fd);
+
+ public:
+  /// Register a descriptor with this reactor.
+  Status add(int fd, Callback ready);
+
+  /// Remove a descriptor from this reactor, see detach.
+  void remove(int fd);
+
+  /// The number of descriptors registered.
+  size_t size() const;
+
+ protected:
+  /// The reactor's run loop.
+  void start() override;
+
+  /// Wake the run loop so it may observe the interruption.
+  void stop() override;
+
+ private:
+  /// The shared reactor instance.
+  static std::shared_ptr<EventReactor> instance();
+
+ private:
+  /// The epoll descriptor.
+  int epoll_{-1};
+
+  /// An eventfd used to wake epoll_wait when stopping.
+  int wake_{-1};
+
+  /// Map of registered descriptors to their readiness callbacks.
+  std::map<int, Callback> callbacks_;
+
+  /// Protects callbacks, held while a callback runs.
+  mutable RecursiveMutex mutex_;
+
+  /// Set when the shared reactor has been added to the dispatcher.
+  static std::atomic<bool> started_;
+};
+}
@@ -60,11 +60,51 @@ TEST_F(AuditTests, test_handle_reply) {
   EXPECT_EQ(1440542781U, ec->time);
   EXPECT_EQ(403030U, ec->auid);
   EXPECT_EQ(ec->fields.size(), 4U);
-  EXPECT_EQ(ec->fields.count("argc"), 1U);
-  EXPECT_EQ(ec->fields["argc"], "3");
-  EXPECT_EQ(ec->fields["a0"], "\"H=1 \"");
-  EXPECT_EQ(ec->fields["a1"], "\"/bin/sh\"");
-  EXPECT_EQ(ec->fields["a2"], "c");
+  EXPECT_TRUE(ec->fields.has("argc"));
+  EXPECT_EQ(ec->fields.str("argc"), "3");
+  EXPECT_EQ(ec->fields.str("a0"), "\"H=1 \"");
+  EXPECT_EQ(ec->fields.str("a1"), "\"/bin/sh\"");
+  EXPECT_EQ(ec->fields.str("a2"), "c");
+}
+
+TEST_F(AuditTests, test_record_fields) {
+  AuditRecordFields fields;
+  fields.parse(
+      "arch=c000003e syscall=59 success=yes  ppid=8422 pid=8423 uid=1000 "
+      "comm=\"git status\" a10=1 a1[0]=2 a1_len=3 flag exe=\"/usr/bin/git\"");
+
+  // Fields are kept in message order.
+  ASSERT_EQ(12U, fields.size());
+  EXPECT_EQ("arch", fields.key(*fields.begin()).to_string());
+
+  // Common keys are interned and have typed accessors.
+  long long syscall = 0;
+  EXPECT_TRUE(fields.integer(AUDIT_KEY_SYSCALL, syscall));
+  EXPECT_EQ(59, syscall);
+  EXPECT_EQ("8423", fields.str(AUDIT_KEY_PID));
+  EXPECT_EQ("8422", fields.str(AUDIT_KEY_PPID));
+  EXPECT_EQ("git status", fields.decoded(AUDIT_KEY_COMM));
+  EXPECT_EQ("/usr/bin/git", fields.decoded(AUDIT_KEY_EXE));
+  EXPECT_FALSE(fields.has(AUDIT_KEY_GID));
+  EXPECT_EQ("0", fields.str(AUDIT_KEY_GID, "0"));
+
+  // Arguments and chunks are interned with their index.
+  auto arg = fields.find("a10");
+  ASSERT_NE(nullptr, arg);
+  EXPECT_EQ(AUDIT_KEY_ARG, arg->id);
+  EXPECT_EQ(10U, arg->index);
+  arg = fields.find("a1[0]");
+  ASSERT_NE(nullptr, arg);
+  EXPECT_EQ(AUDIT_KEY_ARG, arg->id);
+  EXPECT_EQ(1U, arg->index);
+  EXPECT_EQ("2", fields.value(*arg).to_string());
+  EXPECT_EQ(nullptr, fields.find("a1"));
+
+  // Uninterned keys are still searchable.
+  EXPECT_EQ("c000003e", fields.str("arch"));
+  EXPECT_EQ("3", fields.str("a1_len"));
+  EXPECT_TRUE(fields.has("flag"));
+  EXPECT_TRUE(fields.get("flag").empty());
 }
 
 TEST_F(AuditTests, test_audit_value_decode) {
@@ -83,10 +123,10 @@ TEST_F(AuditTests, test_audit_value_decode) {
 
 size_t kAuditCounter{0};
 
-bool SimpleUpdate(size_t t, const AuditFields& f, AuditFields& m) {
+bool SimpleUpdate(size_t t, const AuditRecordFields& f, AuditFields& m) {
   kAuditCounter++;
   for (const auto& i : f) {
-    m[i.first] = i.second;
+    m[f.key(i).to_string()] = f.value(i).to_string();
   }
   return true;
 }
@@ -98,7 +138,8 @@ TEST_F(AuditTests, test_audit_assembler) {
   std::vector<size_t> expected_types{1, 2, 3};
   asmb.start(3, expected_types, nullptr);
 
-  AuditFields expected_fields{{"1", "1"}};
+  AuditRecordFields expected_fields;
+  expected_fields.add("1", "1");
   asmb.add(100U, 1, expected_fields);
 
   EXPECT_EQ(3U, asmb.capacity_);
@@ -108,7 +149,8 @@ TEST_F(AuditTests, test_audit_assembler) {
   // This will be empty since there is no update method.
   EXPECT_TRUE(asmb.m_[100].empty());
 
-  expected_fields = {{"2", "2"}};
+  expected_fields = AuditRecordFields();
+  expected_fields.add("2", "2");
   asmb.add(100U, 1, expected_fields);
 
   // Again empty.
@@ -151,7 +193,7 @@ TEST_F(AuditTests, test_audit_assembler) {
   EXPECT_FALSE(asmb.add(1, 2, expected_fields).is_initialized());
   auto fields = asmb.add(1, 3, expected_fields);
   EXPECT_TRUE(fields.is_initialized());
-  EXPECT_EQ(*fields, expected_fields);
+  EXPECT_EQ(*fields, AuditFields({{"2", "2"}}));
 }
 
 TEST_F(AuditTests, test_parse_sock_addr) {
@@ -9,6 +9,7 @@
  */
 
 #include <stdio.h>
+#include <string.h>
 
 #include <boost/filesystem/operations.hpp>
 #include <boost/filesystem/path.hpp>
@@ -17,6 +18,7 @@
 
 #include <osquery/events.h>
 #include <osquery/filesystem.h>
+#include <osquery/flags.h>
 #include <osquery/tables.h>
 
 #include "osquery/events/linux/inotify.h"
@@ -26,6 +28,8 @@ namespace fs = boost::filesystem;
 
 namespace osquery {
 
+DECLARE_uint64(inotify_coalesce_window);
+
 const int kMaxEventLatency = 3000;
 
 class INotifyTests : public testing::Test {
@@ -501,4 +505,95 @@ TEST_F(INotifyTests, test_inotify_embedded_wildcards) {
   ASSERT_EQ(event_pub_->numDescriptors(), 1U);
   EXPECT_EQ(event_pub_->path_descriptors_.count(real_test_dir + "/2/1/"), 1U);
 }
+
+TEST_F(INotifyTests, test_inotify_coalesce) {
+  auto pub = std::make_shared<INotifyEventPublisher>();
+
+  // Build an inotify record with a trailing name, as read from the handle.
+  alignas(struct inotify_event) char buffer[sizeof(struct inotify_event) + 16];
+  auto event = reinterpret_cast<struct inotify_event*>(buffer);
+  memset(buffer, 0, sizeof(buffer));
+  event->wd = 1;
+  event->mask = IN_MODIFY;
+  event->len = 16;
+  strncpy(event->name, "file", 15);
+
+  // The first modification is fired, repeats within the window are not.
+  EXPECT_FALSE(pub->isCoalesced(event, 1000));
+  EXPECT_TRUE(pub->isCoalesced(event, 1001));
+  EXPECT_TRUE(pub->isCoalesced(event, 1002));
+
+  // Another file within the same watched directory is fired.
+  strncpy(event->name, "other", 15);
+  EXPECT_FALSE(pub->isCoalesced(event, 1003));
+
+  // Any other action ends the window.
+  event->mask = IN_CLOSE_WRITE;
+  EXPECT_FALSE(pub->isCoalesced(event, 1004));
+  event->mask = IN_MODIFY;
+  EXPECT_FALSE(pub->isCoalesced(event, 1005));
+
+  // Modifications after the window are fired.
+  EXPECT_FALSE(pub->isCoalesced(event, 1005 + FLAGS_inotify_coalesce_window));
+}
+
+TEST_F(INotifyTests, test_inotify_path_index) {
+  auto pub = std::make_shared<INotifyEventPublisher>();
+
+  // Subscriptions are compiled after the publisher monitors their paths.
+  std::vector<std::pair<std::string, bool>> paths = {
+      {"/etc", false},
+      {"/etc/passwd", false},
+      {"/var/lib/", true},
+      {"/home/*/.ssh/", false},
+      {"/opt/*/bin/**", false},
+  };
+
+  INotifyPathIndex index;
+  std::vector<INotifySubscriptionContextRef> subscriptions;
+  for (const auto& path : paths) {
+    auto sc = pub->createSubscriptionContext();
+    sc->path = path.first;
+    sc->recursive = path.second;
+    pub->monitorSubscription(sc, false);
+    subscriptions.push_back(sc);
+    index.add(subscriptions.size(), *sc);
+  }
+  EXPECT_EQ(paths.size(), index.size());
+  EXPECT_TRUE(index.contains(1));
+  EXPECT_FALSE(index.contains(paths.size() + 1));
+
+  std::vector<std::string> events = {
+      "/etc/",
+      "/etc/passwd",
+      "/etc/passwd.bak",
+      "/etc/ssh/sshd_config",
+      "/ETC/group",
+      "/var/lib/",
+      "/var/lib/a/b/c",
+      "/var/library",
+      "/home/user/.ssh/authorized_keys",
+      "/home/user/.ssh/keys/id",
+      "/opt/app/bin/tool",
+      "/opt/app/bin/sub/tool",
+      "/usr/bin/ls",
+  };
+
+  // The index must agree with matching each subscription path.
+  std::vector<size_t> ids;
+  for (const auto& path : events) {
+    index.match(path, ids);
+    for (size_t id = 1; id <= subscriptions.size(); id++) {
+      const auto& sc = subscriptions[id - 1];
+      auto indexed = std::binary_search(ids.begin(), ids.end(), id);
+      EXPECT_EQ(INotifyPathIndex::matches(*sc, path), indexed)
+          << sc->path << " " << path;
+    }
+  }
+
+  index.match("/etc/passwd", ids);
+  EXPECT_EQ(std::vector<size_t>({1, 2}), ids);
+  index.match("/usr/bin/ls", ids);
+  EXPECT_TRUE(ids.empty());
+}
 }
@@ -0,0 +1,85 @@
+/*
+ *  Copyright (c) 2014-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+
+#include <cstring>
+#include <vector>
+
+#include <linux/cn_proc.h>
+#include <linux/connector.h>
+
+#include <gtest/gtest.h>
+
+#include "osquery/events/linux/process_connector.h"
+#include "osquery/tests/test_util.h"
+
+namespace osquery {
+
+class ProcConnectorTests : public testing::Test {
+ protected:
+  /// Build a connector message payload as the kernel would deliver it.
+  std::vector<char> message(const struct proc_event& event) {
+    std::vector<char> buffer(sizeof(struct cn_msg) + sizeof(event), 0);
+    auto cn = reinterpret_cast<struct cn_msg*>(buffer.data());
+    cn->id.idx = CN_IDX_PROC;
+    cn->id.val = CN_VAL_PROC;
+    cn->len = sizeof(event);
+    memcpy(buffer.data() + sizeof(struct cn_msg), &event, sizeof(event));
+    return buffer;
+  }
+};
+
+TEST_F(ProcConnectorTests, test_decode) {
+  struct proc_event event;
+  memset(&event, 0, sizeof(event));
+  event.what = proc_event::PROC_EVENT_FORK;
+  event.timestamp_ns = 1000;
+  event.event_data.fork.parent_pid = 10;
+  event.event_data.fork.parent_tgid = 10;
+  event.event_data.fork.child_pid = 11;
+  event.event_data.fork.child_tgid = 11;
+
+  auto buffer = message(event);
+  auto ec = std::make_shared<ProcConnectorEventContext>();
+  auto status =
+      ProcConnectorEventPublisher::decode(buffer.data(), buffer.size(), ec);
+  ASSERT_TRUE(status.ok());
+  EXPECT_EQ(PROC_CONNECTOR_FORK, ec->what);
+  EXPECT_EQ(1000U, ec->timestamp_ns);
+  EXPECT_EQ(10, ec->parent_tgid);
+  EXPECT_EQ(11, ec->pid);
+  EXPECT_EQ(11, ec->tgid);
+
+  memset(&event, 0, sizeof(event));
+  event.what = proc_event::PROC_EVENT_EXIT;
+  event.event_data.exit.process_pid = 12;
+  event.event_data.exit.process_tgid = 12;
+  event.event_data.exit.exit_code = 256;
+  buffer = message(event);
+  ec = std::make_shared<ProcConnectorEventContext>();
+  status =
+      ProcConnectorEventPublisher::decode(buffer.data(), buffer.size(), ec);
+  ASSERT_TRUE(status.ok());
+  EXPECT_EQ(PROC_CONNECTOR_EXIT, ec->what);
+  EXPECT_EQ(12, ec->tgid);
+  EXPECT_EQ(256U, ec->exit_code);
+
+  // A truncated payload must not be decoded.
+  status = ProcConnectorEventPublisher::decode(
+      buffer.data(), sizeof(struct cn_msg) + 4, ec);
+  EXPECT_FALSE(status.ok());
+
+  // Messages from other connector indexes are ignored.
+  auto cn = reinterpret_cast<struct cn_msg*>(buffer.data());
+  cn->id.idx = CN_IDX_PROC + 1;
+  status =
+      ProcConnectorEventPublisher::decode(buffer.data(), buffer.size(), ec);
+  EXPECT_FALSE(status.ok());
+}
+}
@@ -0,0 +1,71 @@
+/*
+ *  Copyright (c) 2014-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include "osquery/events/linux/reactor.h"
+#include "osquery/tests/test_util.h"
+
+namespace osquery {
+
+class EventReactorTests : public testing::Test {};
+
+TEST_F(EventReactorTests, test_reactor_drain) {
+  int fds[2];
+  ASSERT_EQ(0, ::pipe2(fds, O_NONBLOCK));
+
+  std::atomic<size_t> reads{0};
+  std::atomic<size_t> bytes{0};
+  auto reactor = std::make_shared<EventReactor>();
+  auto status = reactor->add(fds[0], [&reads, &bytes, &fds]() {
+    // Drain the descriptor, as publishers must.
+    char buffer[2];
+    ssize_t size = 0;
+    while ((size = ::read(fds[0], buffer, sizeof(buffer))) > 0) {
+      bytes += size;
+    }
+    reads++;
+  });
+  ASSERT_TRUE(status.ok());
+  EXPECT_EQ(1U, reactor->size());
+
+  std::thread loop([&reactor]() { reactor->run(); });
+  ASSERT_EQ(5, ::write(fds[1], "abcde", 5));
+
+  size_t delay = 0;
+  while (bytes < 5 && delay < 2000) {
+    ::usleep(1000);
+    delay++;
+  }
+  EXPECT_EQ(5U, bytes);
+  EXPECT_GE(reads, 1U);
+
+  // A removed descriptor is no longer serviced.
+  reactor->remove(fds[0]);
+  EXPECT_EQ(0U, reactor->size());
+  size_t last_reads = reads;
+  ASSERT_EQ(1, ::write(fds[1], "f", 1));
+  ::usleep(20 * 1000);
+  EXPECT_EQ(last_reads, reads);
+
+  // Interrupting wakes the reactor without waiting for its timeout.
+  reactor->interrupt();
+  loop.join();
+
+  ::close(fds[0]);
+  ::close(fds[1]);
+}
+}
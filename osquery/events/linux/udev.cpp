@@ -12,6 +12,7 @@
 #include <osquery/filesystem.h>
 #include <osquery/logger.h>
 
+#include "osquery/events/linux/reactor.h"
 #include "osquery/events/linux/udev.h"
 
 namespace osquery {
@@ -40,10 +41,24 @@ Status UdevEventPublisher::setUp() {
   }
 
   udev_monitor_enable_receiving(monitor_);
+  if (EventReactor::enabled()) {
+    // Devices are drained from the shared reactor thread.
+    auto fd = udev_monitor_get_fd(monitor_);
+    if (EventReactor::attach(fd, [this]() { drain(); }).ok()) {
+      reactor_fd_ = fd;
+      hasReactor(true);
+    }
+  }
   return Status(0, "OK");
 }
 
 void UdevEventPublisher::tearDown() {
+  if (hasReactor()) {
+    // Detach before locking, a running drain must be allowed to finish.
+    EventReactor::detach(reactor_fd_);
+    hasReactor(false);
+  }
+
   WriteLock lock(mutex_);
   if (monitor_ != nullptr) {
     udev_monitor_unref(monitor_);
@@ -98,6 +113,25 @@ Status UdevEventPublisher::run() {
   return Status(0, "OK");
 }
 
+void UdevEventPublisher::drain() {
+  WriteLock lock(mutex_);
+  if (monitor_ == nullptr) {
+    return;
+  }
+
+  // The monitor socket is non-blocking, receive until no device is queued.
+  while (!isEnding()) {
+    struct udev_device* device = udev_monitor_receive_device(monitor_);
+    if (device == nullptr) {
+      break;
+    }
+
+    auto ec = createEventContextFrom(device);
+    fire(ec);
+    udev_device_unref(device);
+  }
+}
+
 std::string UdevEventPublisher::getValue(struct udev_device* device,
                                          const std::string& property) {
   auto value = udev_device_get_property_value(device, property.c_str());
@@ -119,11 +119,17 @@ class UdevEventPublisher
   /// Protection around udev resources.
   Mutex mutex_;
 
+  /// The monitor descriptor attached to the shared reactor.
+  int reactor_fd_{-1};
+
  private:
   /// Check subscription details.
   bool shouldFire(const UdevSubscriptionContextRef& mc,
                   const UdevEventContextRef& ec) const override;
 
+  /// Receive and fire every queued device, called from the shared reactor.
+  void drain();
+
   /// Helper function to create an EventContext using a udev_device pointer.
   UdevEventContextRef createEventContextFrom(struct udev_device* device);
 };
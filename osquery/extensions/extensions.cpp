@@ -8,7 +8,13 @@
  *
  */
 
+#include <chrono>
 #include <csignal>
+#include <limits>
+
+#ifndef WIN32
+#include <poll.h>
+#endif
 
 #include <boost/algorithm/string/predicate.hpp>
 #include <boost/algorithm/string/trim.hpp>
@@ -85,6 +91,42 @@ CLI_FLAG(string,
          "",
          "Comma-separated list of required extensions");
 
+CLI_FLAG(uint64,
+         extensions_pool_size,
+         4,
+         "Idle connections kept per extension socket (0 disables reuse)");
+
+CLI_FLAG(uint64,
+         extensions_server_workers,
+         0,
+         "Concurrent requests served for extensions (0 is unbounded)");
+
+CLI_FLAG(uint64,
+         extensions_request_quota,
+         0,
+         "Requests per second served for each extension (0 is unlimited)");
+
+CLI_FLAG(uint64,
+         extensions_batch_rows,
+         1024,
+         "Rows read per batch from extension tables (0 reads all at once)");
+
+const std::vector<size_t> kExtensionLatencyBuckets = {
+    100, 250, 500, 1000, 2500, 5000, 10000, 25000, 100000, 1000000,
+};
+
+/// Pools of connected clients, keyed by extension socket path.
+static std::map<std::string, std::shared_ptr<EXClientPool>> kClientPools;
+
+/// Protects the map of client pools.
+static Mutex kClientPoolsMutex;
+
+/// Extensions built without table cursor support, their tables use callTable.
+static std::set<RouteUUID> kTableCursorUnsupported;
+
+/// Protects the set of extensions without table cursor support.
+static Mutex kTableCursorMutex;
+
 /**
  * @brief Alias the extensions_socket (used by core) to a simple 'socket'.
  *
@@ -256,6 +298,8 @@ void ExtensionManagerWatcher::watch() {
     if (uuid.second > 1) {
       LOG(INFO) << "Extension UUID " << uuid.first << " has gone away";
       Registry::removeBroadcast(uuid.first);
+      // Pooled connections to the extension are no longer usable.
+      EXClientPool::remove(getExtensionSocket(uuid.first));
       failures_[uuid.first] = 1;
     }
   }
@@ -634,20 +678,16 @@ Status callExtension(const std::string& extension_path,
                      const std::string& item,
                      const PluginRequest& request,
                      PluginResponse& response) {
-  // Make sure the extension manager path exists, and is writable.
-  auto status = extensionPathActive(extension_path);
+  // The pool checks the socket path before connecting a new client.
+  ExtensionResponse ext_response;
+  auto status = EXClientPool::get(extension_path)->call(
+      ([&ext_response, &registry, &item, &request](EXClient& client) {
+        client.get()->call(ext_response, registry, item, request);
+      }));
   if (!status.ok()) {
     return status;
   }
 
-  ExtensionResponse ext_response;
-  try {
-    auto client = EXClient(extension_path);
-    client.get()->call(ext_response, registry, item, request);
-  } catch (const std::exception& e) {
-    return Status(1, "Extension call failed: " + std::string(e.what()));
-  }
-
   // Convert from Thrift-internal list type to PluginResponse type.
   if (ext_response.status.code == ExtensionCode::EXT_SUCCESS) {
     for (const auto& response_item : ext_response.response) {
@@ -657,6 +697,322 @@ Status callExtension(const std::string& extension_path,
   return Status(ext_response.status.code, ext_response.status.message);
 }
 
+size_t ExtensionCallStats::percentile(double p) const {
+  size_t total = 0;
+  for (const auto& count : latency) {
+    total += count;
+  }
+
+  size_t seen = 0;
+  for (size_t i = 0; i < latency.size() && total > 0; i++) {
+    seen += latency[i];
+    if (seen >= total * p) {
+      // The slowest bucket is unbounded, report the last bound.
+      return kExtensionLatencyBuckets[std::min(
+          i, kExtensionLatencyBuckets.size() - 1)];
+    }
+  }
+  return 0;
+}
+
+Status getExtensionCallStats(const std::string& path,
+                             ExtensionCallStats& stats) {
+  WriteLock lock(kClientPoolsMutex);
+  auto pool = kClientPools.find(path);
+  if (pool == kClientPools.end()) {
+    return Status(1, "No calls to extension: " + path);
+  }
+  stats = pool->second->stats();
+  return Status(0, "OK");
+}
+
+std::shared_ptr<EXClientPool> EXClientPool::get(const std::string& path) {
+  WriteLock lock(kClientPoolsMutex);
+  auto& pool = kClientPools[path];
+  if (pool == nullptr) {
+    pool = std::make_shared<EXClientPool>(path);
+  }
+  return pool;
+}
+
+void EXClientPool::remove(const std::string& path) {
+  std::shared_ptr<EXClientPool> pool;
+  {
+    WriteLock lock(kClientPoolsMutex);
+    auto it = kClientPools.find(path);
+    if (it == kClientPools.end()) {
+      return;
+    }
+    pool = it->second;
+    kClientPools.erase(it);
+  }
+  pool->clear();
+}
+
+bool EXInternal::connected() const {
+  if (!transport_->isOpen()) {
+    return false;
+  }
+
+#ifndef WIN32
+  // An idle connection has nothing to read unless the peer closed it.
+  struct pollfd fds;
+  fds.fd = socket_->getSocketFD();
+  fds.events = POLLIN;
+  fds.revents = 0;
+  if (::poll(&fds, 1, 0) != 0) {
+    return false;
+  }
+#endif
+  return true;
+}
+
+EXClientRef EXClientPool::acquire() {
+  while (true) {
+    EXClientRef client = nullptr;
+    {
+      WriteLock lock(mutex_);
+      if (idle_.empty()) {
+        break;
+      }
+      client = std::move(idle_.back());
+      idle_.pop_back();
+    }
+
+    if (client->connected()) {
+      return client;
+    }
+
+    // The extension closed the idle connection, it may have restarted.
+    WriteLock lock(mutex_);
+    stats_.reconnects++;
+  }
+
+  // Path might exist without a connected extension or extension manager.
+  if (!socketExists(path_).ok()) {
+    return nullptr;
+  }
+  auto client = std::make_shared<EXClient>(path_);
+  return (client->connected()) ? client : nullptr;
+}
+
+void EXClientPool::release(EXClientRef client) {
+  WriteLock lock(mutex_);
+  // Each idle connection holds a server thread within the extension.
+  if (idle_.size() < FLAGS_extensions_pool_size) {
+    idle_.push_back(std::move(client));
+  }
+}
+
+void EXClientPool::clear() {
+  std::vector<EXClientRef> idle;
+  {
+    WriteLock lock(mutex_);
+    idle.swap(idle_);
+  }
+  // The connections close as the clients are destroyed, outside the lock.
+}
+
+void EXClientPool::record(size_t usec, bool success) {
+  WriteLock lock(mutex_);
+  if (stats_.latency.empty()) {
+    stats_.latency.resize(kExtensionLatencyBuckets.size() + 1, 0);
+  }
+
+  if (!success) {
+    stats_.failures++;
+    return;
+  }
+
+  stats_.calls++;
+  auto bucket = std::lower_bound(kExtensionLatencyBuckets.begin(),
+                                 kExtensionLatencyBuckets.end(),
+                                 usec);
+  stats_.latency[bucket - kExtensionLatencyBuckets.begin()]++;
+}
+
+ExtensionCallStats EXClientPool::stats() const {
+  WriteLock lock(mutex_);
+  auto stats = stats_;
+  stats.idle = idle_.size();
+  return stats;
+}
+
+Status EXClientPool::call(const std::function<void(EXClient&)>& request) {
+  EXClientRef client = nullptr;
+  try {
+    client = acquire();
+  } catch (const std::exception& e) {
+    record(0, false);
+    return Status(1, "Extension call failed: " + std::string(e.what()));
+  }
+
+  if (client == nullptr) {
+    record(0, false);
+    return Status(1, "Extension socket not available: " + path_);
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  ExtensionServerProcessor::callingPeer(path_, true);
+  try {
+    request(*client);
+  } catch (const std::exception& e) {
+    // The request may have been handled, it is not retried. The connection
+    // state is unknown, do not return it to the pool.
+    ExtensionServerProcessor::callingPeer(path_, false);
+    record(0, false);
+    return Status(1, "Extension call failed: " + std::string(e.what()));
+  }
+  ExtensionServerProcessor::callingPeer(path_, false);
+
+  auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - start);
+  record(static_cast<size_t>(elapsed.count()), true);
+  release(std::move(client));
+  return Status(0, "OK");
+}
+
+/// The rows requested in each extension table batch.
+static int32_t tableBatchSize() {
+  return static_cast<int32_t>(std::min(
+      FLAGS_extensions_batch_rows,
+      static_cast<uint64_t>(std::numeric_limits<int32_t>::max())));
+}
+
+/// Convert a columnar table batch into rows.
+static Status readTableBatch(const ExtensionTableBatch& batch,
+                             QueryData& rows) {
+  rows.clear();
+  if (batch.status.code != ExtensionCode::EXT_SUCCESS) {
+    return Status(batch.status.code, batch.status.message);
+  }
+
+  if (batch.values.size() != batch.columns.size() ||
+      batch.nulls.size() != batch.columns.size()) {
+    return Status(1, "Malformed extension table batch");
+  }
+
+  size_t count = (batch.values.empty()) ? 0 : batch.values[0].size();
+  rows.resize(count);
+  for (size_t column = 0; column < batch.columns.size(); column++) {
+    const auto& name = batch.columns[column];
+    const auto& values = batch.values[column];
+    const auto& nulls = batch.nulls[column];
+    if (values.size() != count) {
+      rows.clear();
+      return Status(1, "Malformed extension table batch");
+    }
+
+    // Null row indexes are ascending, skip each while filling the column.
+    size_t null = 0;
+    for (size_t i = 0; i < count; i++) {
+      if (null < nulls.size() && static_cast<size_t>(nulls[null]) == i) {
+        null++;
+        continue;
+      }
+      rows[i][name] = values[i];
+    }
+  }
+  return Status(0, "OK");
+}
+
+ExtensionTableCursor::~ExtensionTableCursor() {
+  if (!done_ && cursor_ != 0) {
+    // The extension discards the rows that were not read.
+    auto cursor = cursor_;
+    EXClientPool::get(path_)->call(([cursor](EXClient& client) {
+      ExtensionStatus status;
+      client.get()->closeTable(status, cursor);
+    }));
+  }
+}
+
+RouteUUID ExtensionTableCursor::route(const std::string& table) {
+  if (FLAGS_disable_extensions || FLAGS_extensions_batch_rows == 0) {
+    return 0;
+  }
+
+  RouteUUID uuid = 0;
+  {
+    const auto& external = Registry::registry("table")->getExternal();
+    auto route = external.find(table);
+    if (route == external.end()) {
+      return 0;
+    }
+    uuid = route->second;
+  }
+
+  WriteLock lock(kTableCursorMutex);
+  return (kTableCursorUnsupported.count(uuid) > 0) ? 0 : uuid;
+}
+
+bool ExtensionTableCursor::enabled(const std::string& table) {
+  return route(table) != 0;
+}
+
+Status ExtensionTableCursor::open(QueryContext& context, QueryData& rows) {
+  auto uuid = route(table_);
+  if (uuid == 0) {
+    unsupported_ = true;
+    return Status(1, "Table cursors are not supported: " + table_);
+  }
+
+  PluginRequest request = {{"action", "generate"}};
+  TablePlugin::setRequestFromContext(context, request);
+
+  path_ = getExtensionSocket(uuid);
+  bool unsupported = false;
+  ExtensionTableBatch batch;
+  auto status = EXClientPool::get(path_)->call(
+      ([this, &batch, &request, &unsupported](EXClient& client) {
+        try {
+          client.get()->openTable(batch, table_, request, tableBatchSize());
+        } catch (const TApplicationException& e) {
+          if (e.getType() != TApplicationException::UNKNOWN_METHOD) {
+            throw;
+          }
+          unsupported = true;
+        }
+      }));
+
+  if (unsupported) {
+    VLOG(1) << "Extension UUID " << uuid << " does not support table cursors";
+    WriteLock lock(kTableCursorMutex);
+    kTableCursorUnsupported.insert(uuid);
+    unsupported_ = true;
+    return Status(1, "Extension does not support table cursors");
+  } else if (!status.ok()) {
+    return status;
+  }
+
+  status = readTableBatch(batch, rows);
+  done_ = (!status.ok() || batch.done);
+  cursor_ = batch.cursor;
+  return status;
+}
+
+Status ExtensionTableCursor::next(QueryData& rows) {
+  rows.clear();
+  if (done_) {
+    return Status(0, "OK");
+  }
+
+  ExtensionTableBatch batch;
+  auto cursor = cursor_;
+  auto status = EXClientPool::get(path_)->call(
+      ([&batch, cursor](EXClient& client) {
+        client.get()->nextTableBatch(batch, cursor, tableBatchSize());
+      }));
+  if (status.ok()) {
+    status = readTableBatch(batch, rows);
+  }
+
+  // A failed batch ends the scan, the extension drops an unknown cursor.
+  done_ = (!status.ok() || batch.done);
+  cursor_ = batch.cursor;
+  return status;
+}
+
 Status startExtensionWatcher(const std::string& manager_path,
                              size_t interval,
                              bool fatal) {
@@ -8,6 +8,17 @@
  *
  */
 
+#ifndef WIN32
+#include <sys/socket.h>
+#endif
+
+#ifdef __APPLE__
+#include <sys/un.h>
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
 #include <string>
 
 #include <thrift/TOutput.h>
@@ -28,6 +39,302 @@ const std::vector<std::string> kSDKVersionChanges = {
     {"1.7.7"},
 };
 
+/// Maximum open table cursors, more are refused until one is idle.
+const size_t kMaxTableCursors = 64;
+
+/// Seconds a table cursor may go unread before it may be discarded.
+const size_t kTableCursorIdle = 60;
+
+DECLARE_uint64(extensions_server_workers);
+DECLARE_uint64(extensions_request_quota);
+
+/// Maximum extension processes with request counters.
+const size_t kMaxServerPeers = 256;
+
+/// Peers without credentials are numbered per connection beginning here.
+const uint64_t kServerConnectionPeer = 1ULL << 32;
+
+/// Request counters and quota window for an extension process.
+struct ExtensionServerPeer {
+  ExtensionServerStats stats;
+
+  /// Open connections from the process.
+  size_t connections{0};
+
+  /// Requests waiting for a dispatch worker.
+  size_t queued{0};
+
+  /// Calls from the core to the process that have not returned.
+  size_t outbound{0};
+
+  /// Start (milliseconds) of the current quota window.
+  uint64_t window{0};
+
+  /// Requests within the current quota window.
+  size_t window_requests{0};
+};
+
+/// Request counters for each extension process, identified by pid.
+static std::map<uint64_t, ExtensionServerPeer> kServerPeers;
+
+/// Map of registered extension UUID to its process.
+static std::map<RouteUUID, uint64_t> kServerRoutes;
+
+/// Request counters for every extension.
+static ExtensionServerStats kServerTotals;
+
+/// Requests waiting for a dispatch worker.
+static size_t kServerQueued{0};
+
+/// The next dispatch ticket, and the number of completed dispatches.
+static uint64_t kServerTickets{0};
+static uint64_t kServerCompleted{0};
+
+/// Numbering for connections without peer credentials.
+static uint64_t kServerConnections{0};
+
+/// Protects the request counters and dispatch tickets.
+static Mutex kServerMutex;
+
+/// Signaled when a dispatch completes.
+static std::condition_variable kServerDispatch;
+
+/// The process of the request dispatched by this thread.
+static thread_local uint64_t kServerCurrentPeer{0};
+
+static uint64_t getServerMilliseconds() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+/// Identify the process connected to an ExtensionManager socket.
+static uint64_t getServerPeer(TProtocolRef input) {
+#ifndef WIN32
+  auto buffered = OSQUERY_THRIFT_POINTER::dynamic_pointer_cast<
+      TBufferedTransport>(input->getTransport());
+  auto socket =
+      (buffered == nullptr)
+          ? nullptr
+          : OSQUERY_THRIFT_POINTER::dynamic_pointer_cast<TSocket>(
+                buffered->getUnderlyingTransport());
+  if (socket != nullptr) {
+#if defined(__linux__)
+    struct ucred cred;
+    socklen_t size = sizeof(cred);
+    if (getsockopt(socket->getSocketFD(),
+                   SOL_SOCKET,
+                   SO_PEERCRED,
+                   &cred,
+                   &size) == 0 &&
+        cred.pid > 0) {
+      return static_cast<uint64_t>(cred.pid);
+    }
+#elif defined(__APPLE__)
+    pid_t pid = 0;
+    socklen_t size = sizeof(pid);
+    if (getsockopt(socket->getSocketFD(),
+                   SOL_LOCAL,
+                   LOCAL_PEERPID,
+                   &pid,
+                   &size) == 0 &&
+        pid > 0) {
+      return static_cast<uint64_t>(pid);
+    }
+#endif
+  }
+#endif
+
+  // Without credentials the quota applies to each connection.
+  WriteLock lock(kServerMutex);
+  return kServerConnectionPeer + (++kServerConnections);
+}
+
+/// Access a peer's counters, kServerMutex must be held.
+static ExtensionServerPeer& getServerPeerState(uint64_t peer) {
+  if (kServerPeers.size() >= kMaxServerPeers && kServerPeers.count(peer) == 0) {
+    // Forget processes without connections that are not registered.
+    for (auto it = kServerPeers.begin(); it != kServerPeers.end();) {
+      bool routed = false;
+      for (const auto& route : kServerRoutes) {
+        routed = routed || (route.second == it->first);
+      }
+      if (it->second.connections == 0 && !routed) {
+        it = kServerPeers.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+  return kServerPeers[peer];
+}
+
+void* ExtensionServerEventHandler::createContext(TProtocolRef input,
+                                                 TProtocolRef output) {
+  auto peer = new uint64_t(getServerPeer(input));
+  WriteLock lock(kServerMutex);
+  getServerPeerState(*peer).connections++;
+  return peer;
+}
+
+void ExtensionServerEventHandler::deleteContext(void* context,
+                                                TProtocolRef input,
+                                                TProtocolRef output) {
+  auto peer = static_cast<uint64_t*>(context);
+  if (peer == nullptr) {
+    return;
+  }
+
+  {
+    WriteLock lock(kServerMutex);
+    auto state = kServerPeers.find(*peer);
+    if (state != kServerPeers.end() && state->second.connections > 0) {
+      state->second.connections--;
+    }
+  }
+  delete peer;
+}
+
+bool ExtensionServerProcessor::process(TProtocolRef in,
+                                       TProtocolRef out,
+                                       void* context) {
+  // Wait for a request before counting the connection against the quota.
+  if (!in->getTransport()->peek()) {
+    return false;
+  }
+
+  auto peer = (context == nullptr) ? 0 : *static_cast<uint64_t*>(context);
+  uint64_t delay = 0;
+  auto quota = FLAGS_extensions_request_quota;
+  if (quota > 0) {
+    WriteLock lock(kServerMutex);
+    auto& state = getServerPeerState(peer);
+    auto now = getServerMilliseconds();
+    if (now >= state.window + 1000) {
+      state.window = now;
+      state.window_requests = 0;
+    } else if (state.window_requests >= quota) {
+      // Move the request to the next window and wait for it to start.
+      delay = state.window + 1000 - now;
+      state.window += 1000;
+      state.window_requests = 0;
+      state.stats.throttled++;
+      kServerTotals.throttled++;
+    }
+    state.window_requests++;
+  }
+
+  if (delay > 0) {
+    sleepFor(delay);
+  }
+
+  auto queued_at = std::chrono::steady_clock::now();
+  bool nested = false;
+  {
+    std::unique_lock<Mutex> lock(kServerMutex);
+    auto& state = getServerPeerState(peer);
+    state.queued++;
+    state.stats.max_queued = std::max(state.stats.max_queued, state.queued);
+    kServerQueued++;
+    kServerTotals.max_queued = std::max(kServerTotals.max_queued, kServerQueued);
+
+    // While the core waits on a call to the process, such as a scan of its
+    // table, the process may call back before answering. Its requests may be
+    // needed to release a worker, so they do not wait for one.
+    nested = (state.outbound > 0);
+    if (!nested) {
+      // Requests are dispatched in ticket order by at most the worker count.
+      auto ticket = kServerTickets++;
+      kServerDispatch.wait(lock, [ticket]() {
+        auto workers = FLAGS_extensions_server_workers;
+        return workers == 0 || ticket < kServerCompleted + workers;
+      });
+    }
+
+    auto wait = std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now() - queued_at)
+                    .count();
+    state.queued--;
+    state.stats.requests++;
+    state.stats.wait += wait;
+    kServerQueued--;
+    kServerTotals.requests++;
+    kServerTotals.wait += wait;
+  }
+
+  auto complete = ([nested]() {
+    kServerCurrentPeer = 0;
+    if (!nested) {
+      {
+        WriteLock lock(kServerMutex);
+        kServerCompleted++;
+      }
+      kServerDispatch.notify_all();
+    }
+  });
+
+  bool result = false;
+  kServerCurrentPeer = peer;
+  try {
+    result = processor_->process(in, out, context);
+  } catch (...) {
+    complete();
+    throw;
+  }
+  complete();
+  return result;
+}
+
+void ExtensionServerProcessor::registerPeer(RouteUUID uuid) {
+  if (kServerCurrentPeer != 0) {
+    WriteLock lock(kServerMutex);
+    kServerRoutes[uuid] = kServerCurrentPeer;
+  }
+}
+
+void ExtensionServerProcessor::removePeer(RouteUUID uuid) {
+  WriteLock lock(kServerMutex);
+  kServerRoutes.erase(uuid);
+}
+
+void ExtensionServerProcessor::callingPeer(const std::string& path,
+                                           bool calling) {
+  WriteLock lock(kServerMutex);
+  for (const auto& route : kServerRoutes) {
+    if (getExtensionSocket(route.first) != path) {
+      continue;
+    }
+
+    auto& state = getServerPeerState(route.second);
+    if (calling) {
+      state.outbound++;
+    } else if (state.outbound > 0) {
+      state.outbound--;
+    }
+    break;
+  }
+}
+
+Status getExtensionServerStats(RouteUUID uuid, ExtensionServerStats& stats) {
+  WriteLock lock(kServerMutex);
+  if (uuid == 0) {
+    stats = kServerTotals;
+    return Status(0, "OK");
+  }
+
+  auto route = kServerRoutes.find(uuid);
+  if (route == kServerRoutes.end()) {
+    return Status(1, "No requests served for extension");
+  }
+
+  auto state = kServerPeers.find(route->second);
+  if (state == kServerPeers.end()) {
+    return Status(1, "No requests served for extension");
+  }
+  stats = state->second.stats;
+  return Status(0, "OK");
+}
+
 void ExtensionHandler::ping(ExtensionStatus& _return) {
   _return.code = ExtensionCode::EXT_SUCCESS;
   _return.message = "pong";
@@ -66,6 +373,146 @@ void ExtensionHandler::call(ExtensionResponse& _return,
   }
 }
 
+void ExtensionHandler::fillTableBatch(TableCursor& cursor,
+                                      int32_t batch_size,
+                                      ExtensionTableBatch& batch) {
+  auto count = std::min(cursor.rows.size() - cursor.position,
+                        static_cast<size_t>(std::max(batch_size, 1)));
+
+  // Assign an index to each column name, in the order first seen.
+  std::map<std::string, size_t> indexes;
+  for (size_t i = cursor.position; i < cursor.position + count; i++) {
+    for (const auto& column : cursor.rows[i]) {
+      if (indexes.count(column.first) == 0) {
+        indexes[column.first] = batch.columns.size();
+        batch.columns.push_back(column.first);
+      }
+    }
+  }
+
+  batch.values.assign(batch.columns.size(), std::vector<std::string>(count));
+  batch.nulls.assign(batch.columns.size(), std::vector<int32_t>());
+  std::vector<std::vector<bool>> present(batch.columns.size(),
+                                         std::vector<bool>(count, false));
+  for (size_t i = 0; i < count; i++) {
+    // Rows are moved into the batch, releasing them as the cursor advances.
+    auto& row = cursor.rows[cursor.position + i];
+    for (auto& column : row) {
+      auto index = indexes.at(column.first);
+      batch.values[index][i] = std::move(column.second);
+      present[index][i] = true;
+    }
+    row.clear();
+  }
+
+  for (size_t column = 0; column < present.size(); column++) {
+    for (size_t i = 0; i < count; i++) {
+      if (!present[column][i]) {
+        batch.nulls[column].push_back(static_cast<int32_t>(i));
+      }
+    }
+  }
+
+  cursor.position += count;
+  batch.done = (cursor.position >= cursor.rows.size());
+}
+
+void ExtensionHandler::openTable(ExtensionTableBatch& _return,
+                                 const std::string& item,
+                                 const ExtensionPluginRequest& request,
+                                 const int32_t batch_size) {
+  PluginRequest plugin_request;
+  for (const auto& request_item : request) {
+    plugin_request[request_item.first] = request_item.second;
+  }
+
+  // Tables are generated completely, the batches bound each response.
+  auto cursor = std::make_shared<TableCursor>();
+  auto local_item = Registry::getAlias("table", item);
+  auto status =
+      Registry::call("table", local_item, plugin_request, cursor->rows);
+  _return.status.code = status.getCode();
+  _return.status.message = status.getMessage();
+  _return.status.uuid = uuid_;
+  _return.done = true;
+  if (!status.ok()) {
+    return;
+  }
+
+  fillTableBatch(*cursor, batch_size, _return);
+  if (_return.done) {
+    return;
+  }
+
+  WriteLock lock(cursors_mutex_);
+  auto now = getUnixTime();
+  if (cursors_.size() >= kMaxTableCursors) {
+    // A caller that stopped reading did not close its cursor.
+    for (auto it = cursors_.begin(); it != cursors_.end();) {
+      if (now - it->second->accessed > kTableCursorIdle) {
+        it = cursors_.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+
+  if (cursors_.size() >= kMaxTableCursors) {
+    // Every cursor is still being read, do not drop rows from any of them.
+    _return = ExtensionTableBatch();
+    _return.status.code = ExtensionCode::EXT_FAILED;
+    _return.status.message = "Too many open table cursors";
+    _return.status.uuid = uuid_;
+    _return.done = true;
+    return;
+  }
+
+  cursor->accessed = now;
+  _return.cursor = ++last_cursor_;
+  cursors_[_return.cursor] = cursor;
+}
+
+void ExtensionHandler::nextTableBatch(ExtensionTableBatch& _return,
+                                      const ExtensionCursorID cursor,
+                                      const int32_t batch_size) {
+  std::shared_ptr<TableCursor> table_cursor;
+  {
+    WriteLock lock(cursors_mutex_);
+    auto it = cursors_.find(cursor);
+    if (it != cursors_.end()) {
+      table_cursor = it->second;
+      table_cursor->accessed = getUnixTime();
+    }
+  }
+
+  _return.status.uuid = uuid_;
+  _return.done = true;
+  if (table_cursor == nullptr) {
+    _return.status.code = ExtensionCode::EXT_FAILED;
+    _return.status.message = "Unknown or expired table cursor";
+    return;
+  }
+
+  fillTableBatch(*table_cursor, batch_size, _return);
+  _return.status.code = ExtensionCode::EXT_SUCCESS;
+  _return.status.message = "OK";
+  if (_return.done) {
+    WriteLock lock(cursors_mutex_);
+    cursors_.erase(cursor);
+  } else {
+    _return.cursor = cursor;
+  }
+}
+
+void ExtensionHandler::closeTable(ExtensionStatus& _return,
+                                  const ExtensionCursorID cursor) {
+  WriteLock lock(cursors_mutex_);
+  cursors_.erase(cursor);
+  _return.code = ExtensionCode::EXT_SUCCESS;
+  _return.message = "OK";
+  _return.uuid = uuid_;
+}
+
 void ExtensionHandler::shutdown() {
   // Request a graceful shutdown of the Thrift listener.
   VLOG(1) << "Extension " << uuid_ << " requested shutdown";
@@ -140,6 +587,7 @@ void ExtensionManagerHandler::registerExtension(
   }
 
   extensions_[uuid] = info;
+  ExtensionServerProcessor::registerPeer(uuid);
   _return.code = ExtensionCode::EXT_SUCCESS;
   _return.message = "OK";
   _return.uuid = uuid;
@@ -157,6 +605,7 @@ void ExtensionManagerHandler::deregisterExtension(
   // On success return the uuid of the now de-registered extension.
   Registry::removeBroadcast(uuid);
   extensions_.erase(uuid);
+  ExtensionServerProcessor::removePeer(uuid);
   _return.code = ExtensionCode::EXT_SUCCESS;
   _return.uuid = uuid;
 }
@@ -205,6 +654,7 @@ void ExtensionManagerHandler::refresh() {
   // Remove each from the manager's list of extension metadata.
   for (const auto& uuid : removed_routes) {
     extensions_.erase(uuid);
+    ExtensionServerProcessor::removePeer(uuid);
   }
 }
 
@@ -249,7 +699,7 @@ inline void removeStalePaths(const std::string& manager) {
   }
 }
 
-void ExtensionRunnerCore::startServer(TProcessorRef processor) {
+void ExtensionRunnerCore::startServer(TProcessorRef processor, bool bounded) {
   {
     std::unique_lock<std::mutex> lock(service_start_);
     // A request to stop the service may occur before the thread starts.
@@ -269,9 +719,18 @@ void ExtensionRunnerCore::startServer(TProcessorRef processor) {
     auto transport_fac = TTransportFactoryRef(new TBufferedTransportFactory());
     auto protocol_fac = TProtocolFactoryRef(new TBinaryProtocolFactory());
 
+    if (bounded) {
+      // Dispatch requests through the worker bound and request quotas.
+      processor = TProcessorRef(new ExtensionServerProcessor(processor));
+    }
+
     // Start the Thrift server's run loop.
     server_ = TThreadedServerRef(new TThreadedServer(
         processor, transport_, transport_fac, protocol_fac));
+    if (bounded) {
+      server_->setServerEventHandler(SHARED_PTR_IMPL<TServerEventHandler>(
+          new ExtensionServerEventHandler()));
+    }
   }
 
   server_->serve();
@@ -306,7 +765,7 @@ void ExtensionManagerRunner::start() {
 
   VLOG(1) << "Extension manager service starting: " << path_;
   try {
-    startServer(processor);
+    startServer(processor, true);
   } catch (const std::exception& e) {
     LOG(WARNING) << "Extensions disabled: cannot start extension manager ("
                  << path_ << ") (" << e.what() << ")";
@@ -10,6 +10,10 @@
 
 #pragma once
 
+#include <functional>
+
+#include <boost/noncopyable.hpp>
+
 #include <osquery/dispatcher.h>
 #include <osquery/extensions.h>
 
@@ -119,9 +123,60 @@ class ExtensionHandler : virtual public ExtensionIf {
   /// Request an extension to shutdown.
   void shutdown();
 
+  /**
+   * @brief Generate a table and return the first batch of rows.
+   *
+   * The remaining rows are kept with a cursor ID, returned in the batch,
+   * until they are read with nextTableBatch or discarded with closeTable.
+   * Cursors left unread for a minute may be discarded to open new cursors;
+   * if too many cursors are still being read the open fails.
+   *
+   * @param _return The first batch, and cursor if rows remain.
+   * @param item The table plugin name.
+   * @param request The table generate request, including the query context.
+   * @param batch_size The maximum number of rows in each batch.
+   */
+  void openTable(ExtensionTableBatch& _return,
+                 const std::string& item,
+                 const ExtensionPluginRequest& request,
+                 const int32_t batch_size);
+
+  /// Return the next batch of rows from a table cursor.
+  void nextTableBatch(ExtensionTableBatch& _return,
+                      const ExtensionCursorID cursor,
+                      const int32_t batch_size);
+
+  /// Discard the remaining rows of a table cursor.
+  void closeTable(ExtensionStatus& _return, const ExtensionCursorID cursor);
+
  protected:
   /// Transient UUID assigned to the extension after registering.
   RouteUUID uuid_;
+
+ private:
+  /// Rows generated by a table and not yet returned in a batch.
+  struct TableCursor {
+    QueryData rows;
+    size_t position{0};
+
+    /// Time (seconds) the cursor was opened or last read.
+    size_t accessed{0};
+  };
+
+  /// Move the next batch of rows from a cursor into a columnar batch.
+  static void fillTableBatch(TableCursor& cursor,
+                             int32_t batch_size,
+                             ExtensionTableBatch& batch);
+
+ private:
+  /// Table cursors with remaining rows.
+  std::map<ExtensionCursorID, std::shared_ptr<TableCursor>> cursors_;
+
+  /// The last assigned table cursor ID.
+  ExtensionCursorID last_cursor_{0};
+
+  /// Protects the table cursors.
+  Mutex cursors_mutex_;
 };
 
 /**
@@ -281,6 +336,59 @@ class ExtensionManagerWatcher : public ExtensionWatcher {
   std::map<RouteUUID, size_t> failures_;
 };
 
+/**
+ * @brief Bound and meter the requests served by an ExtensionManager.
+ *
+ * Each extension connection is read by its own server thread, but at most
+ * `--extensions_server_workers` requests are dispatched to the handler at
+ * once, in the order they arrived. Requests from a process the core is
+ * waiting on, such as for a table scan, are nested calls and dispatched
+ * immediately, as waiting could deadlock. An extension process sending more
+ * than `--extensions_request_quota` requests in a second is delayed until the
+ * next second, without holding a worker.
+ */
+class ExtensionServerProcessor : public TProcessor {
+ public:
+  explicit ExtensionServerProcessor(TProcessorRef processor)
+      : processor_(std::move(processor)) {}
+
+  /// Wait for a request, then for the quota and a worker, then dispatch.
+  bool process(TProtocolRef in, TProtocolRef out, void* context) override;
+
+  /**
+   * @brief Attribute the requesting extension process to an extension UUID.
+   *
+   * Called while dispatching an extension's registration.
+   */
+  static void registerPeer(RouteUUID uuid);
+
+  /// Stop attributing requests to a removed extension UUID.
+  static void removePeer(RouteUUID uuid);
+
+  /**
+   * @brief Note the start or end of a call from the core to an extension.
+   *
+   * Requests the extension sends while the core waits on its socket path
+   * are nested calls and not bounded by the worker count.
+   */
+  static void callingPeer(const std::string& path, bool calling);
+
+ private:
+  /// The generated processor for the ExtensionManager handler.
+  TProcessorRef processor_;
+};
+
+/// Identifies the extension process of each ExtensionManager connection.
+class ExtensionServerEventHandler : public TServerEventHandler {
+ public:
+  /// Returns the connection context passed to ExtensionServerProcessor.
+  void* createContext(TProtocolRef input, TProtocolRef output) override;
+
+  void deleteContext(void* context,
+                     TProtocolRef input,
+                     TProtocolRef output) override;
+};
+
 class ExtensionRunnerCore : public InternalRunnable {
  public:
   virtual ~ExtensionRunnerCore();
@@ -288,8 +396,13 @@ class ExtensionRunnerCore : public InternalRunnable {
       : path_(path), server_(nullptr) {}
 
  public:
-  /// Given a handler transport and protocol start a thrift threaded server.
-  void startServer(TProcessorRef processor);
+  /**
+   * @brief Given a handler transport and protocol start a thrift threaded server.
+   *
+   * @param processor The generated processor for the service handler.
+   * @param bounded Dispatch requests through an ExtensionServerProcessor.
+   */
+  void startServer(TProcessorRef processor, bool bounded = false);
 
   // The Dispatcher thread service stop point.
   void stop();
@@ -368,6 +481,9 @@ class EXInternal {
     transport_->close();
   }
 
+  /// Check if the connection is open and was not closed by the peer.
+  bool connected() const;
+
  protected:
   TPlatformSocketRef socket_;
   TTransportRef transport_;
@@ -391,6 +507,69 @@ class EXClient : public EXInternal {
   std::shared_ptr<extensions::ExtensionClient> client_;
 };
 
+using EXClientRef = std::shared_ptr<EXClient>;
+
+/**
+ * @brief A pool of connected clients to a single extension socket.
+ *
+ * Registry calls routed to an extension reuse an idle connection instead of
+ * checking the socket path, pinging, and connecting for each call. An idle
+ * connection the extension has closed, for example by restarting, is
+ * discarded before a request is written and a new connection is used. A
+ * request that fails once written is not retried, since the extension may
+ * have handled it.
+ *
+ * Each pool also keeps the call counters and latency histogram reported by
+ * the osquery_extensions table.
+ */
+class EXClientPool : private boost::noncopyable {
+ public:
+  explicit EXClientPool(const std::string& path) : path_(path) {}
+
+  /// Get (or create) the pool for an extension socket path.
+  static std::shared_ptr<EXClientPool> get(const std::string& path);
+
+  /// Close and forget the pool for an extension socket that has gone away.
+  static void remove(const std::string& path);
+
+  /**
+   * @brief Run a Thrift request using a pooled client.
+   *
+   * @param request called with a connected client, it may throw.
+   * @return failure if the request could not be completed.
+   */
+  Status call(const std::function<void(EXClient&)>& request);
+
+  /// Close all idle connections.
+  void clear();
+
+  /// A snapshot of the call counters.
+  ExtensionCallStats stats() const;
+
+ private:
+  /// Take an open idle client or connect a new one, nullptr if not connected.
+  EXClientRef acquire();
+
+  /// Return a client after a successful request.
+  void release(EXClientRef client);
+
+  /// Add a call outcome and latency to the counters.
+  void record(size_t usec, bool success);
+
+ private:
+  /// The extension's UNIX domain socket path.
+  std::string path_;
+
+  /// Connected clients not used by a request.
+  std::vector<EXClientRef> idle_;
+
+  /// The call counters and latency histogram.
+  ExtensionCallStats stats_;
+
+  /// Protects the idle clients and counters.
+  mutable Mutex mutex_;
+};
+
 /// Internal accessor for a client to an extension manager (from an extension).
 class EXManagerClient : public EXInternal {
  public:
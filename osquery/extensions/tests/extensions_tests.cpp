@@ -19,6 +19,7 @@
 
 #include <osquery/extensions.h>
 #include <osquery/filesystem.h>
+#include <osquery/tables.h>
 
 #include "osquery/core/process.h"
 #include "osquery/extensions/interface.h"
@@ -229,6 +230,13 @@ TEST_F(ExtensionsTest, test_extension_broadcast) {
   EXPECT_EQ(extensions.at(uuid).version, "0.1");
   EXPECT_EQ(extensions.at(uuid).sdk_version, "0.0.0");
 
+  // The registration was served by the manager and attributed to the UUID.
+  ExtensionServerStats server_stats;
+  EXPECT_TRUE(getExtensionServerStats(uuid, server_stats).ok());
+  EXPECT_GE(server_stats.requests, 1U);
+  EXPECT_TRUE(getExtensionServerStats(0, server_stats).ok());
+  EXPECT_GE(server_stats.requests, 1U);
+
   // We are broadcasting to our own registry in the test, which internally has
   // a "test_item" aliased to "test_alias", "test_item" is internally callable
   // but "test_alias" can only be resolved by an EM call.
@@ -253,10 +261,134 @@ TEST_F(ExtensionsTest, test_extension_broadcast) {
   EXPECT_EQ(response.size(), 1U);
   EXPECT_EQ(response[0]["test_key"], "test_value");
 
+  // A second call reuses the pooled connection.
+  response.clear();
+  status = callExtension(ext_socket,
+                         "extension_test",
+                         "test_alias",
+                         {{"test_key", "test_value"}},
+                         response);
+  EXPECT_TRUE(status.ok());
+  EXPECT_EQ(response.size(), 1U);
+
+  ExtensionCallStats stats;
+  EXPECT_TRUE(getExtensionCallStats(ext_socket, stats).ok());
+  EXPECT_EQ(2U, stats.calls);
+  EXPECT_EQ(0U, stats.failures);
+  EXPECT_EQ(0U, stats.reconnects);
+  EXPECT_EQ(1U, stats.idle);
+  EXPECT_GT(stats.percentile(0.5), 0U);
+
   Registry::removeBroadcast(uuid);
+  EXClientPool::remove(ext_socket);
+  EXPECT_FALSE(getExtensionCallStats(ext_socket, stats).ok());
   Registry::allowDuplicates(false);
 }
 
+class CursorTablePlugin : public TablePlugin {
+ private:
+  TableColumns columns() const override {
+    return {
+        std::make_tuple("id", INTEGER_TYPE, ColumnOptions::DEFAULT),
+        std::make_tuple("name", TEXT_TYPE, ColumnOptions::DEFAULT),
+    };
+  }
+
+  QueryData generate(QueryContext& context) override {
+    QueryData results;
+    for (size_t i = 0; i < 5; i++) {
+      Row r = {{"id", std::to_string(i)}};
+      if (i != 3) {
+        r["name"] = "row" + std::to_string(i);
+      }
+      results.push_back(r);
+    }
+    return results;
+  }
+};
+
+TEST_F(ExtensionsTest, test_extension_table_cursor) {
+  Registry::add<CursorTablePlugin>("table", "cursor_table");
+
+  // Internal tables are not read through a cursor, they are generated.
+  EXPECT_FALSE(ExtensionTableCursor::enabled("cursor_table"));
+  QueryContext context;
+  QueryData rows;
+  ExtensionTableCursor internal("cursor_table");
+  EXPECT_FALSE(internal.open(context, rows).ok());
+  EXPECT_TRUE(internal.unsupported());
+
+  ExtensionHandler handler(1);
+
+  ExtensionTableBatch batch;
+  handler.openTable(batch, "cursor_table", {{"action", "generate"}}, 2);
+  ASSERT_EQ(ExtensionCode::EXT_SUCCESS, batch.status.code);
+  EXPECT_FALSE(batch.done);
+  EXPECT_NE(0, batch.cursor);
+  ASSERT_EQ(2U, batch.columns.size());
+  EXPECT_EQ(2U, batch.values[0].size());
+
+  // The second batch includes the row without a name.
+  auto cursor = batch.cursor;
+  batch = ExtensionTableBatch();
+  handler.nextTableBatch(batch, cursor, 2);
+  ASSERT_EQ(ExtensionCode::EXT_SUCCESS, batch.status.code);
+  EXPECT_FALSE(batch.done);
+  for (size_t i = 0; i < batch.columns.size(); i++) {
+    if (batch.columns[i] == "name") {
+      ASSERT_EQ(1U, batch.nulls[i].size());
+      EXPECT_EQ(1, batch.nulls[i][0]);
+    } else {
+      EXPECT_TRUE(batch.nulls[i].empty());
+    }
+  }
+
+  batch = ExtensionTableBatch();
+  handler.nextTableBatch(batch, cursor, 2);
+  EXPECT_TRUE(batch.done);
+  EXPECT_EQ(1U, batch.values[0].size());
+
+  // The cursor is released after the last batch.
+  batch = ExtensionTableBatch();
+  handler.nextTableBatch(batch, cursor, 2);
+  EXPECT_NE(ExtensionCode::EXT_SUCCESS, batch.status.code);
+
+  // A closed cursor discards the remaining rows.
+  batch = ExtensionTableBatch();
+  handler.openTable(batch, "cursor_table", {{"action", "generate"}}, 4);
+  EXPECT_FALSE(batch.done);
+  ExtensionStatus status;
+  handler.closeTable(status, batch.cursor);
+  EXPECT_EQ(ExtensionCode::EXT_SUCCESS, status.code);
+
+  cursor = batch.cursor;
+  batch = ExtensionTableBatch();
+  handler.nextTableBatch(batch, cursor, 4);
+  EXPECT_NE(ExtensionCode::EXT_SUCCESS, batch.status.code);
+
+  // Cursors being read are not discarded, opening more fails instead.
+  std::vector<ExtensionCursorID> cursors;
+  for (size_t i = 0; i < 64; i++) {
+    batch = ExtensionTableBatch();
+    handler.openTable(batch, "cursor_table", {{"action", "generate"}}, 1);
+    ASSERT_EQ(ExtensionCode::EXT_SUCCESS, batch.status.code);
+    cursors.push_back(batch.cursor);
+  }
+  batch = ExtensionTableBatch();
+  handler.openTable(batch, "cursor_table", {{"action", "generate"}}, 1);
+  EXPECT_EQ(ExtensionCode::EXT_FAILED, batch.status.code);
+  EXPECT_TRUE(batch.done);
+  EXPECT_TRUE(batch.columns.empty());
+
+  batch = ExtensionTableBatch();
+  handler.nextTableBatch(batch, cursors[0], 1);
+  EXPECT_EQ(ExtensionCode::EXT_SUCCESS, batch.status.code);
+  for (const auto& open_cursor : cursors) {
+    handler.closeTable(status, open_cursor);
+  }
+  Registry::registry("table")->remove("cursor_table");
+}
+
 TEST_F(ExtensionsTest, test_extension_module_search) {
   createMockFileStructure();
   EXPECT_FALSE(loadModules(kFakeDirectory + "/root.txt"));
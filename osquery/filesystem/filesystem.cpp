@@ -8,6 +8,8 @@
  *
  */
 
+#include <algorithm>
+#include <cstring>
 #include <sstream>
 
 #include <fcntl.h>
@@ -31,6 +33,7 @@
 
 #include "osquery/core/json.h"
 #include "osquery/filesystem/fileops.h"
+#include "osquery/filesystem/walker.h"
 
 namespace pt = boost::property_tree;
 namespace fs = boost::filesystem;
@@ -47,8 +50,6 @@ HIDDEN_FLAG(bool, allow_unsafe, false, "Allow unsafe executable permissions");
 /// Disable forensics (atime/mtime preserving) file reads.
 HIDDEN_FLAG(bool, disable_forensic, true, "Disable atime/mtime preservation");
 
-static const size_t kMaxRecursiveGlobs = 64;
-
 Status writeTextFile(const fs::path& path,
                      const std::string& content,
                      int permissions,
@@ -244,42 +245,38 @@ Status remove(const fs::path& path) {
   return Status(status_code, "N/A");
 }
 
-static void genGlobs(std::string path,
+/// The number of path components, ignoring a directory's trailing separator.
+static size_t pathDepth(const std::string& path) {
+  auto end = path.size();
+  if (end > 0 && (path[end - 1] == '/' || path[end - 1] == '\\')) {
+    end--;
+  }
+  return std::count_if(path.begin(), path.begin() + end, [](char c) {
+    return c == '/' || c == '\\';
+  });
+}
+
+static void genGlobs(const std::string& path,
                      std::vector<std::string>& results,
                      GlobLimits limits) {
-  // Use our helped escape/replace for wildcards.
-  replaceGlobWildcards(path, limits);
-
-  // Generate a glob set and recurse for double star.
-  size_t glob_index = 0;
-  while (++glob_index < kMaxRecursiveGlobs) {
-    auto glob_results = platformGlob(path);
-
-    for (auto const& result_path : glob_results) {
-      results.push_back(result_path);
-    }
-
-    // The end state is a non-recursive ending or empty set of matches.
-    size_t wild = path.rfind("**");
-    // Allow a trailing slash after the double wild indicator.
-    if (glob_results.size() == 0 || wild > path.size() ||
-        wild < path.size() - 3) {
-      break;
-    }
-    path += "/**";
-  }
-
-  // Prune results based on settings/requested glob limitations.
-  auto end = std::remove_if(
-      results.begin(), results.end(), [limits](const std::string& found) {
-        return !(((found[found.length() - 1] == '/' ||
-                   found[found.length() - 1] == '\\') &&
-                  limits & GLOB_FOLDERS) ||
-                 ((found[found.length() - 1] != '/' &&
-                   found[found.length() - 1] != '\\') &&
-                  limits & GLOB_FILES));
-      });
-  results.erase(end, results.end());
+  auto start = results.size();
+  Mutex results_mutex;
+  walkFilePattern(path, limits, ([&results, &results_mutex](
+                                    const WalkEntry& entry) {
+                    WriteLock lock(results_mutex);
+                    results.push_back(entry.path);
+                    return true;
+                  }));
+
+  // The walk reports in any order, sort as the iterative globs did: by depth,
+  // then by path.
+  std::sort(results.begin() + start,
+            results.end(),
+            [](const std::string& a, const std::string& b) {
+              auto a_depth = pathDepth(a);
+              auto b_depth = pathDepth(b);
+              return (a_depth != b_depth) ? a_depth < b_depth : a < b;
+            });
 }
 
 Status resolveFilePattern(const fs::path& fs_path,
@@ -333,6 +330,92 @@ inline void replaceGlobWildcards(std::string& pattern, GlobLimits limits) {
   }
 }
 
+/// Check if a path names a directory, as marked by GLOB_MARK.
+static inline bool isMarkedDirectory(const std::string& path) {
+  return !path.empty() && (path.back() == '/' || path.back() == '\\');
+}
+
+/// Apply the GLOB_FILES and GLOB_FOLDERS limits to a (marked) path.
+static inline bool isWithinLimits(const std::string& path, GlobLimits limits) {
+  return (isMarkedDirectory(path)) ? (limits & GLOB_FOLDERS) != 0
+                                   : (limits & GLOB_FILES) != 0;
+}
+
+Status walkFilePattern(const std::string& pattern,
+                       GlobLimits limits,
+                       const WalkCallback& callback) {
+  // Use our helped escape/replace for wildcards.
+  auto path = pattern;
+  replaceGlobWildcards(path, limits);
+
+  auto report = ([&callback, limits](const std::string& found) {
+    if (!isWithinLimits(found, limits)) {
+      return true;
+    }
+
+    WalkEntry entry;
+    entry.path = found;
+#ifdef WIN32
+    auto result = ::stat(found.c_str(), &entry.info);
+#else
+    auto result = ::lstat(found.c_str(), &entry.info);
+#endif
+    if (result != 0) {
+      memset(&entry.info, 0, sizeof(entry.info));
+    }
+    return callback(entry);
+  });
+
+  // Allow a trailing slash after the double wild indicator.
+  size_t wild = path.rfind("**");
+  if (wild == std::string::npos || wild + 3 < path.size()) {
+    for (const auto& found : platformGlob(path)) {
+      if (!report(found)) {
+        break;
+      }
+    }
+    return Status(0, "OK");
+  }
+
+  // A trailing slash restricts the recursive matches to folders.
+  if (wild + 2 < path.size()) {
+    limits = static_cast<GlobLimits>(limits & ~GLOB_FILES);
+  }
+
+  // The recursive wildcard matches everything beneath the directories matching
+  // the pattern before it; a partial name is globbed and its matches reported.
+  auto base = path.substr(0, wild);
+  std::vector<std::string> roots;
+  if (isMarkedDirectory(base)) {
+    if (base.find_first_of("*?[{~") != std::string::npos) {
+      roots = platformGlob(base);
+    } else {
+      roots.push_back(base);
+    }
+  } else {
+    for (const auto& found : platformGlob(base + "*")) {
+      if (!report(found)) {
+        return Status(0, "OK");
+      }
+      if (isMarkedDirectory(found)) {
+        roots.push_back(found);
+      }
+    }
+  }
+
+  // Like a glob, hidden names are not matched by the wildcard and symbolic
+  // links to directories are followed.
+  WalkOptions options;
+  options.hidden = false;
+  options.mark_directories = true;
+  options.follow_symlinks = true;
+  DirectoryWalker walker(options);
+  walker.walk(roots, ([&callback, limits](const WalkEntry& entry) {
+                return !isWithinLimits(entry.path, limits) || callback(entry);
+              }));
+  return Status(0, "OK");
+}
+
 inline Status listInAbsoluteDirectory(const fs::path& path,
                                       std::vector<std::string>& results,
                                       GlobLimits limits) {
@@ -0,0 +1,101 @@
+/*
+ *  Copyright (c) 2014-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <boost/filesystem.hpp>
+
+#include <osquery/filesystem.h>
+#include <osquery/flags.h>
+#include <osquery/tables.h>
+
+namespace osquery {
+
+DECLARE_uint64(proc_index_ttl);
+DECLARE_uint64(table_threads);
+
+static void PROC_descriptors_directory_iterator(benchmark::State& state) {
+  // The per-table walk: boost directory iterators and a readlink per path.
+  while (state.KeepRunning()) {
+    std::set<std::string> pids;
+    procProcesses(pids);
+
+    std::map<std::string, std::pair<std::string, std::string>> sockets;
+    for (const auto& pid : pids) {
+      try {
+        boost::filesystem::directory_iterator it("/proc/" + pid + "/fd"), end;
+        for (; it != end; ++it) {
+          auto fd = it->path().leaf().string();
+          std::string link;
+          if (procReadDescriptor(pid, fd, link).ok() &&
+              link.find("socket:[") == 0) {
+            sockets[link.substr(8, link.size() - 9)] = std::make_pair(fd, pid);
+          }
+        }
+      } catch (const boost::filesystem::filesystem_error& /* e */) {
+        continue;
+      }
+    }
+  }
+}
+
+BENCHMARK(PROC_descriptors_directory_iterator);
+
+static void PROC_descriptors_index(benchmark::State& state) {
+  // Always rebuild the index to measure a single getdents64 /proc walk.
+  auto ttl = FLAGS_proc_index_ttl;
+  auto threads = FLAGS_table_threads;
+  FLAGS_proc_index_ttl = 0;
+  FLAGS_table_threads = state.range_x();
+  while (state.KeepRunning()) {
+    auto index = procDescriptorIndex();
+  }
+  FLAGS_proc_index_ttl = ttl;
+  FLAGS_table_threads = threads;
+}
+
+BENCHMARK(PROC_descriptors_index)->Arg(1)->Arg(2)->Arg(4)->Arg(8);
+
+static void PROC_descriptors_index_shared(benchmark::State& state) {
+  // Tables within the TTL share the index.
+  while (state.KeepRunning()) {
+    auto index = procDescriptorIndex();
+  }
+}
+
+BENCHMARK(PROC_descriptors_index_shared);
+
+static void PROC_generate_processes(benchmark::State& state) {
+  // Read the attributes the processes table reads, serially or in parallel.
+  auto threads = FLAGS_table_threads;
+  FLAGS_table_threads = state.range_x();
+  while (state.KeepRunning()) {
+    std::set<std::string> pids;
+    procProcesses(pids);
+    auto results = parallelGenerate(
+        {pids.begin(), pids.end()},
+        [](const std::string& pid, QueryData& rows) {
+          ProcessDirectory proc(pid);
+          ProcView content;
+          Row r;
+          for (const auto& attr : {"stat", "status", "cmdline"}) {
+            if (proc.read(attr, content).ok()) {
+              r[attr] = content.to_string();
+            }
+          }
+          proc.readLink("exe", r["path"]);
+          rows.push_back(std::move(r));
+        });
+  }
+  FLAGS_table_threads = threads;
+}
+
+BENCHMARK(PROC_generate_processes)->Arg(1)->Arg(2)->Arg(4)->Arg(8);
+}
@@ -8,18 +8,84 @@
  *
  */
 
+#include <dirent.h>
+#include <fcntl.h>
 #include <linux/limits.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
 #include <unistd.h>
 
+#include <chrono>
+#include <mutex>
+
 #include <boost/filesystem.hpp>
 
+#include <osquery/core.h>
 #include <osquery/filesystem.h>
+#include <osquery/flags.h>
 #include <osquery/logger.h>
+#include <osquery/tables.h>
 
 namespace osquery {
 
+FLAG(uint64,
+     proc_index_ttl,
+     1000,
+     "Milliseconds a /proc descriptor index is shared between tables");
+
 const std::string kLinuxProcPath = "/proc";
 
+DECLARE_uint64(read_max);
+
+/// Size of the reusable buffer for getdents64 directory reads.
+const size_t kProcDirentBufferSize = 32 * 1024;
+
+/// Initial size of each thread's attribute read buffer.
+const size_t kProcReadBufferSize = 16 * 1024;
+
+/// Protect the shared descriptor index.
+static Mutex kProcIndexMutex;
+
+void forEachDirent(int dir_fd,
+                   std::vector<char>& buffer,
+                   std::function<bool(const char* name)> predicate) {
+  while (true) {
+    auto size = syscall(SYS_getdents64, dir_fd, buffer.data(), buffer.size());
+    if (size <= 0) {
+      break;
+    }
+
+    for (long offset = 0; offset < size;) {
+      auto entry = reinterpret_cast<struct dirent64*>(buffer.data() + offset);
+      offset += entry->d_reclen;
+      const char* name = entry->d_name;
+      if (name[0] == '.' &&
+          (name[1] == 0 || (name[1] == '.' && name[2] == 0))) {
+        continue;
+      }
+      if (!predicate(name)) {
+        return;
+      }
+    }
+  }
+}
+
+/// Read each descriptor link within an open /proc/<pid>/fd directory.
+static void readDescriptors(
+    int fd_dir,
+    std::vector<char>& buffer,
+    std::vector<std::pair<std::string, std::string>>& descriptors) {
+  char link[PATH_MAX] = {0};
+  forEachDirent(fd_dir, buffer, [&](const char* name) {
+    auto size = readlinkat(fd_dir, name, link, sizeof(link) - 1);
+    if (size >= 0) {
+      descriptors.push_back(std::make_pair(std::string(name),
+                                           std::string(link, size)));
+    }
+    return true;
+  });
+}
+
 Status procProcesses(std::set<std::string>& processes) {
   // Iterate over each process-like directory in proc.
   boost::filesystem::directory_iterator it(kLinuxProcPath), end;
@@ -43,23 +109,93 @@ Status procProcesses(std::set<std::string>& processes) {
 Status procDescriptors(const std::string& process,
                        std::map<std::string, std::string>& descriptors) {
   auto descriptors_path = kLinuxProcPath + "/" + process + "/fd";
-  try {
-    // Access to the process' /fd may be restricted.
-    boost::filesystem::directory_iterator it(descriptors_path), end;
-    for (; it != end; ++it) {
-      auto fd = it->path().leaf().string();
-      std::string linkname;
-      if (procReadDescriptor(process, fd, linkname).ok()) {
-        descriptors[fd] = linkname;
-      }
-    }
-  } catch (boost::filesystem::filesystem_error& e) {
+  // Access to the process' /fd may be restricted.
+  int fd_dir =
+      open(descriptors_path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (fd_dir < 0) {
     return Status(1, "Cannot access descriptors for " + process);
   }
 
+  std::vector<char> buffer(kProcDirentBufferSize);
+  std::vector<std::pair<std::string, std::string>> links;
+  readDescriptors(fd_dir, buffer, links);
+  close(fd_dir);
+
+  for (auto& link : links) {
+    descriptors[link.first] = std::move(link.second);
+  }
   return Status(0, "OK");
 }
 
+/// Walk /proc once, reading the descriptors of every process.
+static void buildDescriptorIndex(ProcDescriptorIndex& index) {
+  int proc_dir =
+      open(kLinuxProcPath.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (proc_dir < 0) {
+    return;
+  }
+
+  std::vector<std::string> pids;
+  std::vector<char> proc_buffer(kProcDirentBufferSize);
+  forEachDirent(proc_dir, proc_buffer, [&pids](const char* name) {
+    // Only process (pid) directories are inspected.
+    if (name[0] >= '1' && name[0] <= '9') {
+      pids.push_back(name);
+    }
+    return true;
+  });
+
+  // Each process' descriptors are read into its own slot, possibly in parallel.
+  std::vector<std::vector<std::pair<std::string, std::string>>> descriptors(
+      pids.size());
+  auto threads = parallelThreads(pids.size());
+  std::vector<std::vector<char>> fd_buffers(
+      threads, std::vector<char>(kProcDirentBufferSize));
+  parallelFor(pids.size(), threads, [&](size_t thread, size_t item) {
+    auto fd_path = pids[item] + "/fd";
+    int fd_dir = openat(
+        proc_dir, fd_path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd_dir < 0) {
+      // Access to the process' /fd may be restricted.
+      return;
+    }
+
+    readDescriptors(fd_dir, fd_buffers[thread], descriptors[item]);
+    close(fd_dir);
+  });
+  close(proc_dir);
+
+  for (size_t item = 0; item < pids.size(); item++) {
+    const auto& pid = pids[item];
+    for (const auto& descriptor : descriptors[item]) {
+      const auto& link = descriptor.second;
+      if (link.compare(0, 8, "socket:[") == 0 && link.size() > 9) {
+        index.sockets[link.substr(8, link.size() - 9)] =
+            std::make_pair(descriptor.first, pid);
+      }
+    }
+    if (!descriptors[item].empty()) {
+      index.descriptors[pid] = std::move(descriptors[item]);
+    }
+  }
+}
+
+std::shared_ptr<const ProcDescriptorIndex> procDescriptorIndex() {
+  static std::shared_ptr<const ProcDescriptorIndex> index{nullptr};
+  static std::chrono::steady_clock::time_point built;
+
+  WriteLock lock(kProcIndexMutex);
+  auto now = std::chrono::steady_clock::now();
+  if (index == nullptr ||
+      now - built > std::chrono::milliseconds(FLAGS_proc_index_ttl)) {
+    auto fresh = std::make_shared<ProcDescriptorIndex>();
+    buildDescriptorIndex(*fresh);
+    index = std::move(fresh);
+    built = now;
+  }
+  return index;
+}
+
 Status procReadDescriptor(const std::string& process,
                           const std::string& descriptor,
                           std::string& result) {
@@ -77,4 +213,71 @@ Status procReadDescriptor(const std::string& process,
     return Status(1, "Could not read path");
   }
 }
+
+ProcessDirectory::ProcessDirectory(const std::string& pid) {
+  auto path = kLinuxProcPath + "/" + pid;
+  fd_ = open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+}
+
+ProcessDirectory::~ProcessDirectory() {
+  if (fd_ >= 0) {
+    close(fd_);
+  }
+}
+
+Status ProcessDirectory::read(const char* attr, ProcView& content) const {
+  // Each thread reuses its buffer, growing it for large attributes (maps).
+  thread_local std::vector<char> buffer(kProcReadBufferSize);
+
+  content.clear();
+  int fd = openat(fd_, attr, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return Status(1, "Cannot open process attribute");
+  }
+
+  // procfs reports a size of 0, read until the end of the content.
+  size_t size = 0;
+  while (true) {
+    if (size == buffer.size()) {
+      if (buffer.size() * 2 > FLAGS_read_max) {
+        close(fd);
+        return Status(1, "Process attribute exceeds read limits");
+      }
+      buffer.resize(buffer.size() * 2);
+    }
+
+    auto bytes = pread(fd, buffer.data() + size, buffer.size() - size, size);
+    if (bytes < 0 && errno == EINTR) {
+      continue;
+    } else if (bytes < 0) {
+      close(fd);
+      return Status(1, "Cannot read process attribute");
+    } else if (bytes == 0) {
+      break;
+    }
+    size += static_cast<size_t>(bytes);
+  }
+
+  close(fd);
+  content = ProcView(buffer.data(), size);
+  return Status(0, "OK");
+}
+
+Status ProcessDirectory::readLink(const char* attr, std::string& target) const {
+  char link[PATH_MAX] = {0};
+  auto size = readlinkat(fd_, attr, link, sizeof(link) - 1);
+  if (size < 0) {
+    return Status(1, "Cannot read process link");
+  }
+
+  target.assign(link, static_cast<size_t>(size));
+  return Status(0, "OK");
+}
+
+Status ProcessDirectory::stat(const char* attr, struct stat& info) const {
+  if (fstatat(fd_, attr, &info, 0) != 0) {
+    return Status(1, "Cannot stat process attribute");
+  }
+  return Status(0, "OK");
+}
 }
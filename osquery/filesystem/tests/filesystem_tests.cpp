@@ -22,6 +22,7 @@
 #include <osquery/logger.h>
 #include <osquery/system.h>
 
+#include "osquery/filesystem/walker.h"
 #include "osquery/tests/test_util.h"
 
 namespace fs = boost::filesystem;
@@ -268,6 +269,102 @@ TEST_F(FilesystemTests, test_wildcard_double_folders) {
                            .string()));
 }
 
+TEST_F(FilesystemTests, test_wildcard_double_order) {
+  // Recursive matches are ordered by depth then path, as iterative globs were.
+  std::vector<std::string> results;
+  resolveFilePattern(kFakeDirectory + "/%%", results);
+  ASSERT_EQ(20U, results.size());
+
+  auto depth = [](const std::string& path) {
+    auto end = path.size() - ((path.back() == '/' || path.back() == '\\'));
+    return std::count_if(path.begin(), path.begin() + end, [](char c) {
+      return c == '/' || c == '\\';
+    });
+  };
+  for (size_t i = 1; i < results.size(); i++) {
+    auto previous = depth(results[i - 1]);
+    auto current = depth(results[i]);
+    EXPECT_TRUE(previous < current ||
+                (previous == current && results[i - 1] < results[i]));
+  }
+
+  // The order is the same for every resolve.
+  std::vector<std::string> again;
+  resolveFilePattern(kFakeDirectory + "/%%", again);
+  EXPECT_EQ(results, again);
+}
+
+#ifndef WIN32
+TEST_F(FilesystemTests, test_wildcard_double_symlinks) {
+  auto root = fs::path(kTestWorkingDirectory) / "wildcard-symlinks";
+  fs::remove_all(root);
+  fs::create_directories(root / "target");
+  writeTextFile(root / "target" / "file.txt", "content");
+  fs::create_directory_symlink(root / "target", root / "link");
+
+  // Like a glob, the recursive wildcard descends into symlinked directories.
+  std::vector<std::string> results;
+  resolveFilePattern((root / "%%").string(), results);
+  EXPECT_TRUE(contains(results, (root / "link" / "file.txt").string()));
+  EXPECT_TRUE(contains(results, (root / "target" / "file.txt").string()));
+  EXPECT_EQ(4U, results.size());
+
+  // Links to directories are matched as folders.
+  results.clear();
+  resolveFilePattern((root / "%%").string(), results, GLOB_FOLDERS);
+  EXPECT_TRUE(contains(results, (root / "link").string() + "/"));
+  fs::remove_all(root);
+}
+#endif
+
+TEST_F(FilesystemTests, test_directory_walker) {
+  std::vector<std::string> results;
+  Mutex results_mutex;
+  auto collect = ([&results, &results_mutex](const WalkEntry& entry) {
+    WriteLock lock(results_mutex);
+    results.push_back(entry.path);
+    return true;
+  });
+
+  // A single thread and several threads report the same entries.
+  WalkOptions options;
+  options.threads = 1;
+  DirectoryWalker serial(options);
+  EXPECT_TRUE(serial.walk({kFakeDirectory}, collect).ok());
+  EXPECT_EQ(20U, results.size());
+  EXPECT_EQ(20U, serial.count());
+  auto expected = results;
+  std::sort(expected.begin(), expected.end());
+
+  results.clear();
+  options.threads = 4;
+  DirectoryWalker parallel(options);
+  EXPECT_TRUE(parallel.walk({kFakeDirectory}, collect).ok());
+  std::sort(results.begin(), results.end());
+  EXPECT_EQ(expected, results);
+
+  // Entries are not reported beneath the maximum depth.
+  results.clear();
+  options.max_depth = 1;
+  DirectoryWalker shallow(options);
+  shallow.walk({kFakeDirectory}, collect);
+  EXPECT_EQ(7U, results.size());
+  EXPECT_FALSE(shallow.truncated());
+
+  // The walk ends at the maximum entries.
+  results.clear();
+  options.max_depth = 0;
+  options.max_entries = 5;
+  DirectoryWalker limited(options);
+  limited.walk({kFakeDirectory}, collect);
+  EXPECT_EQ(5U, results.size());
+  EXPECT_TRUE(limited.truncated());
+
+  // Walking a file, or missing path, fails.
+  DirectoryWalker missing;
+  EXPECT_FALSE(missing.walk({kDoorTxtPath}, collect).ok());
+}
+
 TEST_F(FilesystemTests, test_wildcard_end_last_component) {
   std::vector<std::string> results;
   auto status = resolveFilePattern(kFakeDirectory + "/%11/%sh", results);
@@ -377,6 +474,60 @@ TEST_F(FilesystemTests, test_read_proc) {
   EXPECT_TRUE(readFile("/proc/" + std::to_string(getpid()) + "/stat", content));
   EXPECT_GT(content.size(), 0U);
 }
+
+TEST_F(FilesystemTests, test_proc_descriptor_index) {
+  auto pid = std::to_string(getpid());
+  std::map<std::string, std::string> descriptors;
+  ASSERT_TRUE(procDescriptors(pid, descriptors).ok());
+  EXPECT_GT(descriptors.size(), 0U);
+
+  // The index includes this process and its descriptors.
+  auto index = procDescriptorIndex();
+  ASSERT_EQ(index->descriptors.count(pid), 1U);
+  EXPECT_GT(index->descriptors.at(pid).size(), 0U);
+
+  // Within the TTL the index is shared.
+  EXPECT_EQ(index, procDescriptorIndex());
+}
+
+TEST_F(FilesystemTests, test_process_directory) {
+  ProcessDirectory proc(std::to_string(getpid()));
+  ASSERT_TRUE(proc.isValid());
+
+  // The stat content begins with the pid.
+  ProcView content;
+  ASSERT_TRUE(proc.read("stat", content).ok());
+  std::vector<std::string> fields;
+  procTokens(content, " ", [&fields](ProcView field) {
+    fields.push_back(field.to_string());
+    return fields.size() < 2;
+  });
+  ASSERT_EQ(fields.size(), 2U);
+  EXPECT_EQ(fields[0], std::to_string(getpid()));
+
+  std::string exe;
+  EXPECT_TRUE(proc.readLink("exe", exe).ok());
+  EXPECT_FALSE(exe.empty());
+
+  // The exe attribute is followed to the executable.
+  struct stat exe_info;
+  ASSERT_TRUE(proc.stat("exe", exe_info).ok());
+  struct stat path_info;
+  ASSERT_EQ(::stat(exe.c_str(), &path_info), 0);
+  EXPECT_EQ(exe_info.st_ino, path_info.st_ino);
+  EXPECT_FALSE(proc.read("not_an_attribute", content).ok());
+
+  // Tokens are trimmed and empty tokens are skipped.
+  fields.clear();
+  procTokens(ProcView("a\0 b \0\0c\0", 9), ProcView("\0", 1), [&](ProcView t) {
+    fields.push_back(t.to_string());
+    return true;
+  });
+  EXPECT_EQ(fields, std::vector<std::string>({"a", "b", "c"}));
+
+  ProcessDirectory missing("0");
+  EXPECT_FALSE(missing.isValid());
+}
 #endif
 
 #ifndef WIN32
@@ -0,0 +1,318 @@
+/*
+ *  Copyright (c) 2014-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+
+#include <fcntl.h>
+
+#ifndef WIN32
+#include <dirent.h>
+#include <unistd.h>
+#endif
+
+#include <thread>
+
+#include <boost/filesystem/operations.hpp>
+
+#include <osquery/flags.h>
+#include <osquery/logger.h>
+
+#include "osquery/filesystem/walker.h"
+
+namespace fs = boost::filesystem;
+
+namespace osquery {
+
+FLAG(uint64, walk_threads, 4, "Threads used to walk a directory tree");
+
+FLAG(uint64, walk_max_depth, 64, "Maximum depth of a recursive directory walk");
+
+FLAG(uint64,
+     walk_max_entries,
+     0,
+     "Maximum entries reported by a directory walk (0 is unlimited)");
+
+FLAG(bool,
+     walk_one_filesystem,
+     false,
+     "Do not descend into other filesystems when walking a directory tree");
+
+#ifdef __linux__
+/// Size of each getdents64 read.
+const size_t kWalkBufferSize = 32 * 1024;
+#endif
+
+DirectoryWalker::DirectoryWalker(const WalkOptions& options)
+    : options_(options) {
+  if (options_.max_depth == 0) {
+    options_.max_depth = FLAGS_walk_max_depth;
+  }
+  if (options_.max_entries == 0) {
+    options_.max_entries = FLAGS_walk_max_entries;
+  }
+  if (options_.threads == 0) {
+    options_.threads = std::max(FLAGS_walk_threads, (uint64_t)1);
+  }
+  options_.one_filesystem =
+      options_.one_filesystem || FLAGS_walk_one_filesystem;
+}
+
+Status DirectoryWalker::walk(const std::vector<std::string>& roots,
+                             const WalkCallback& callback) {
+  queues_.clear();
+  for (size_t i = 0; i < options_.threads; i++) {
+    queues_.push_back(std::unique_ptr<Queue>(new Queue()));
+  }
+  pending_ = 0;
+  queued_ = 0;
+  count_ = 0;
+  stop_ = false;
+  truncated_ = false;
+
+  for (const auto& root : roots) {
+    struct stat info;
+    if (::stat(root.c_str(), &info) != 0 ||
+        (info.st_mode & S_IFMT) != S_IFDIR) {
+      continue;
+    }
+    push(0, {root, 0, info.st_dev});
+  }
+
+  if (pending_ == 0) {
+    return Status(1, "No directories to walk");
+  }
+
+  // Read the first directory before starting threads, a walk of a directory
+  // without subdirectories does not need them.
+  Directory directory;
+  if (take(0, directory)) {
+    read(0, directory, callback);
+    done();
+  }
+
+  std::vector<std::thread> threads;
+  if (pending_ > 0) {
+    for (size_t id = 1; id < options_.threads; id++) {
+      threads.emplace_back(
+          &DirectoryWalker::work, this, id, std::cref(callback));
+    }
+  }
+
+  work(0, callback);
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  if (truncated_) {
+    VLOG(1) << "Directory walk ended after " << options_.max_entries
+            << " entries";
+  }
+  return Status(0, "OK");
+}
+
+void DirectoryWalker::work(size_t id, const WalkCallback& callback) {
+  Directory directory;
+  while (!stop_) {
+    if (take(id, directory)) {
+      read(id, directory, callback);
+      done();
+      continue;
+    }
+
+    // Another thread is reading a directory that may add work.
+    std::unique_lock<Mutex> lock(idle_mutex_);
+    if (pending_ == 0) {
+      break;
+    }
+    idle_.wait(lock,
+               [this]() { return queued_ > 0 || pending_ == 0 || stop_; });
+  }
+
+  // A stopped walk ends every thread.
+  wake();
+}
+
+void DirectoryWalker::done() {
+  if (--pending_ == 0) {
+    wake();
+  }
+}
+
+void DirectoryWalker::wake() {
+  {
+    // A thread checking the wait condition holds the lock, it cannot miss
+    // the change.
+    WriteLock lock(idle_mutex_);
+  }
+  idle_.notify_all();
+}
+
+bool DirectoryWalker::take(size_t id, Directory& directory) {
+  {
+    auto& queue = *queues_[id];
+    WriteLock lock(queue.mutex);
+    if (!queue.directories.empty()) {
+      directory = std::move(queue.directories.back());
+      queue.directories.pop_back();
+      queued_--;
+      return true;
+    }
+  }
+
+  // Steal the oldest directory, the one closest to its root, from a victim.
+  for (size_t i = 1; i < queues_.size(); i++) {
+    auto& queue = *queues_[(id + i) % queues_.size()];
+    WriteLock lock(queue.mutex);
+    if (!queue.directories.empty()) {
+      directory = std::move(queue.directories.front());
+      queue.directories.pop_front();
+      queued_--;
+      return true;
+    }
+  }
+  return false;
+}
+
+void DirectoryWalker::push(size_t id, Directory directory) {
+  pending_++;
+  {
+    auto& queue = *queues_[id];
+    WriteLock lock(queue.mutex);
+    queue.directories.push_back(std::move(directory));
+    queued_++;
+  }
+
+  // Only wake idle threads when there are several.
+  if (queues_.size() > 1) {
+    {
+      WriteLock lock(idle_mutex_);
+    }
+    idle_.notify_one();
+  }
+}
+
+void DirectoryWalker::visit(size_t id,
+                            const Directory& directory,
+                            WalkEntry& entry,
+                            const WalkCallback& callback) {
+  if (entry.isDirectory() && entry.depth < options_.max_depth &&
+      (!options_.one_filesystem || entry.info.st_dev == directory.device)) {
+    push(id, {entry.path, entry.depth, directory.device});
+  }
+
+  if (count_++ >= options_.max_entries && options_.max_entries > 0) {
+    count_--;
+    truncated_ = true;
+    stop_ = true;
+    return;
+  }
+
+  if (options_.mark_directories && entry.isDirectory()) {
+    entry.path += fs::path::preferred_separator;
+  }
+
+  try {
+    if (!callback(entry)) {
+      stop_ = true;
+    }
+  } catch (const std::exception& e) {
+    VLOG(1) << "Directory walk callback failed: " << e.what();
+    stop_ = true;
+  }
+}
+
+void DirectoryWalker::read(size_t id,
+                           const Directory& directory,
+                           const WalkCallback& callback) {
+  auto prefix = directory.path;
+  if (prefix.empty() || (prefix.back() != '/' && prefix.back() != '\\')) {
+    prefix += fs::path::preferred_separator;
+  }
+
+#ifdef WIN32
+  boost::system::error_code ec;
+  fs::directory_iterator it(directory.path, ec), end;
+  for (; !ec && it != end && !stop_; it.increment(ec)) {
+    auto name = it->path().filename().string();
+    if (!options_.hidden && name[0] == '.') {
+      continue;
+    }
+
+    WalkEntry entry;
+    entry.path = prefix + name;
+    entry.depth = directory.depth + 1;
+    if (::stat(entry.path.c_str(), &entry.info) != 0) {
+      continue;
+    }
+    visit(id, directory, entry, callback);
+  }
+#else
+  // Subdirectories are only opened through a symbolic link if following.
+  int flags = O_RDONLY | O_DIRECTORY | O_CLOEXEC;
+  if (directory.depth > 0 && !options_.follow_symlinks) {
+    flags |= O_NOFOLLOW;
+  }
+
+  int fd = ::open(directory.path.c_str(), flags);
+  if (fd < 0) {
+    return;
+  }
+
+  auto entry_of = [this, &prefix, &directory, fd](const char* name,
+                                                  WalkEntry& entry) {
+    // Skip "." and "..", and hidden names unless requested.
+    if (name[0] == '.' && (!options_.hidden || name[1] == 0 ||
+                           (name[1] == '.' && name[2] == 0))) {
+      return false;
+    }
+
+    if (::fstatat(fd, name, &entry.info, AT_SYMLINK_NOFOLLOW) != 0) {
+      return false;
+    }
+
+    // A followed link, to a directory or not, is reported as its target.
+    struct stat target;
+    if (options_.follow_symlinks && S_ISLNK(entry.info.st_mode) &&
+        ::fstatat(fd, name, &target, 0) == 0) {
+      entry.info = target;
+    }
+    entry.path = prefix + name;
+    entry.depth = directory.depth + 1;
+    return true;
+  };
+
+#ifdef __linux__
+  std::vector<char> buffer(kWalkBufferSize);
+  forEachDirent(fd, buffer, [&](const char* name) {
+    WalkEntry entry;
+    if (entry_of(name, entry)) {
+      visit(id, directory, entry, callback);
+    }
+    return !stop_;
+  });
+  ::close(fd);
+#else
+  // The directory stream owns and closes the descriptor.
+  auto dir = ::fdopendir(fd);
+  if (dir == nullptr) {
+    ::close(fd);
+    return;
+  }
+
+  struct dirent* dirent = nullptr;
+  while (!stop_ && (dirent = ::readdir(dir)) != nullptr) {
+    WalkEntry entry;
+    if (entry_of(dirent->d_name, entry)) {
+      visit(id, directory, entry, callback);
+    }
+  }
+  ::closedir(dir);
+#endif
+#endif
+}
+}
@@ -0,0 +1,205 @@
+/*
+ *  Copyright (c) 2014-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+
+#pragma once
+
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+
+#include <osquery/core.h>
+#include <osquery/filesystem.h>
+
+namespace osquery {
+
+/// A filesystem entry found while walking a directory tree.
+struct WalkEntry {
+  /// The complete path, directories may include a trailing separator.
+  std::string path;
+
+  /// Depth below the walk root, entries within a root have a depth of 1.
+  size_t depth{0};
+
+  /// The entry's lstat, symbolic links are not followed.
+  struct stat info;
+
+  bool isDirectory() const {
+    return (info.st_mode & S_IFMT) == S_IFDIR;
+  }
+
+  bool isRegularFile() const {
+    return (info.st_mode & S_IFMT) == S_IFREG;
+  }
+};
+
+/**
+ * @brief Called for each entry, return false to end the walk.
+ *
+ * A walk using several threads calls the callback concurrently, callbacks
+ * must synchronize access to their output.
+ */
+using WalkCallback = std::function<bool(const WalkEntry& entry)>;
+
+/// Limits and options for a DirectoryWalker, 0 values use the walk flags.
+struct WalkOptions {
+  /// Maximum depth of entries, `--walk_max_depth` if 0.
+  size_t max_depth{0};
+
+  /// Maximum entries visited before the walk ends, `--walk_max_entries` if 0.
+  size_t max_entries{0};
+
+  /// Threads reading directories, `--walk_threads` if 0.
+  size_t threads{0};
+
+  /// Do not descend into other devices, also set by `--walk_one_filesystem`.
+  bool one_filesystem{false};
+
+  /// Include and descend into entries whose name begins with a period.
+  bool hidden{true};
+
+  /// Report directories with a trailing separator, like GLOB_MARK.
+  bool mark_directories{false};
+
+  /**
+   * @brief Follow symbolic links to directories, like a glob.
+   *
+   * A followed link is reported with the information of its target. Loops
+   * end at the maximum depth.
+   */
+  bool follow_symlinks{false};
+};
+
+/**
+ * @brief A parallel walk of one or more directory trees.
+ *
+ * Each thread reads directories from its own queue, reading the most recently
+ * found directory first, and steals the oldest directory from another queue
+ * when its own is empty. Directories are read with getdents64 on Linux and
+ * readdir elsewhere; entries are stat-ed relative to the open directory.
+ *
+ * Entries are streamed to the callback as they are read, in no particular
+ * order. Symbolic links are reported but not followed unless requested.
+ * Threads without a directory to read wait until one is queued.
+ */
+class DirectoryWalker : private boost::noncopyable {
+ public:
+  explicit DirectoryWalker(const WalkOptions& options = WalkOptions());
+
+  /**
+   * @brief Walk each root directory, the roots themselves are not reported.
+   *
+   * @param roots The directories to walk.
+   * @param callback Called, possibly concurrently, for each entry.
+   * @return failure if no root could be walked.
+   */
+  Status walk(const std::vector<std::string>& roots,
+              const WalkCallback& callback);
+
+  /// The number of entries reported by the last walk.
+  size_t count() const {
+    return count_;
+  }
+
+  /// Check if the last walk ended at the entry limit.
+  bool truncated() const {
+    return truncated_;
+  }
+
+ private:
+  /// A directory waiting to be read.
+  struct Directory {
+    std::string path;
+    size_t depth;
+    dev_t device;
+  };
+
+  /// A thread's queue of directories.
+  struct Queue {
+    Mutex mutex;
+    std::deque<Directory> directories;
+  };
+
+  /// A walk thread, reads directories until every queue is empty.
+  void work(size_t id, const WalkCallback& callback);
+
+  /// Take a directory from a thread's queue, or steal from another queue.
+  bool take(size_t id, Directory& directory);
+
+  /// Add a directory to a thread's queue.
+  void push(size_t id, Directory directory);
+
+  /// Mark a taken directory as read, waking idle threads if the walk is done.
+  void done();
+
+  /// Wake the threads waiting for a directory.
+  void wake();
+
+  /// Read a directory, report its entries and queue its subdirectories.
+  void read(size_t id, const Directory& directory, const WalkCallback& callback);
+
+  /// Report an entry found within a directory.
+  void visit(size_t id,
+             const Directory& directory,
+             WalkEntry& entry,
+             const WalkCallback& callback);
+
+ private:
+  /// Options with flag defaults applied.
+  WalkOptions options_;
+
+  /// Directory queues, one for each thread.
+  std::vector<std::unique_ptr<Queue>> queues_;
+
+  /// Directories queued or being read.
+  std::atomic<size_t> pending_{0};
+
+  /// Directories queued and not yet taken.
+  std::atomic<size_t> queued_{0};
+
+  /// Idle threads wait for a queued directory or the end of the walk.
+  Mutex idle_mutex_;
+  std::condition_variable idle_;
+
+  /// Entries reported.
+  std::atomic<size_t> count_{0};
+
+  /// Set when the callback or the entry limit ends the walk.
+  std::atomic<bool> stop_{false};
+
+  /// Set when the entry limit ended the walk.
+  std::atomic<bool> truncated_{false};
+};
+
+/**
+ * @brief Stream the paths matching a filesystem glob pattern.
+ *
+ * This is a streaming resolveFilePattern. A pattern ending in a recursive
+ * wildcard walks the directories before the wildcard using a DirectoryWalker,
+ * other patterns are globbed. Like a glob, symbolic links to directories are
+ * followed and directories are reported with a trailing separator. Unlike
+ * resolveFilePattern, walked matches are reported in no particular order.
+ *
+ * @param pattern filesystem globbing pattern, SQL wildcards are replaced.
+ * @param limits the types of entries to report and canonicalization options.
+ * @param callback Called, possibly concurrently, for each matching entry.
+ */
+Status walkFilePattern(const std::string& pattern,
+                       GlobLimits limits,
+                       const WalkCallback& callback);
+}
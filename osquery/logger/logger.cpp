@@ -22,6 +22,7 @@
 #include <osquery/filesystem.h>
 #include <osquery/flags.h>
 #include <osquery/logger.h>
+#include <osquery/sql.h>
 
 #include "osquery/core/conversions.h"
 #include "osquery/core/json.h"
@@ -486,17 +487,21 @@ Status logQueryLogItem(const QueryLogItem& results,
 
   std::vector<std::string> json_items;
   Status status;
-  if (FLAGS_log_result_events) {
-    status = serializeQueryLogItemAsEventsJSON(results, json_items);
-  } else {
-    std::string json;
-    status = serializeQueryLogItemJSON(results, json);
-    json_items.push_back(json);
+  {
+    QueryPhaseTimer timer(QueryPhase::SERIALIZE);
+    if (FLAGS_log_result_events) {
+      status = serializeQueryLogItemAsEventsJSON(results, json_items);
+    } else {
+      std::string json;
+      status = serializeQueryLogItemJSON(results, json);
+      json_items.push_back(json);
+    }
   }
   if (!status.ok()) {
     return status;
   }
 
+  QueryPhaseTimer timer(QueryPhase::LOG);
   for (auto& json : json_items) {
     if (!json.empty() && json.back() == '\n') {
       json.pop_back();
@@ -512,12 +517,17 @@ Status logSnapshotQuery(const QueryLogItem& item) {
   }
 
   std::string json;
-  if (!serializeQueryLogItemJSON(item, json)) {
-    return Status(1, "Could not serialize snapshot");
+  {
+    QueryPhaseTimer timer(QueryPhase::SERIALIZE);
+    if (!serializeQueryLogItemJSON(item, json)) {
+      return Status(1, "Could not serialize snapshot");
+    }
   }
   if (!json.empty() && json.back() == '\n') {
     json.pop_back();
   }
+
+  QueryPhaseTimer timer(QueryPhase::LOG);
   return Registry::call("logger", {{"snapshot", json}});
 }
 
@@ -33,6 +33,11 @@ FLAG(uint64,
      1000000,
      "Maximum number of logs in buffered output plugins (0 = unlimited)");
 
+FLAG(uint64,
+     buffered_log_expiry,
+     0,
+     "Seconds to keep buffered logs before RocksDB drops them (0 = forever)");
+
 const std::chrono::seconds BufferedLogForwarder::kLogPeriod =
     std::chrono::seconds(4);
 const size_t BufferedLogForwarder::kMaxLogLines = 1024;
@@ -134,8 +139,10 @@ void BufferedLogForwarder::purge() {
   indexes.insert(indexes.end(), status_indexes.begin(), status_indexes.end());
 
   if (indexes.size() < purge_count) {
-    LOG(ERROR) << "Trying to purge " << purge_count << " logs but only found "
-               << indexes.size();
+    // The backing store may have dropped expired logs, recount the buffer.
+    VLOG(1) << "Trying to purge " << purge_count << " logs but only found "
+            << indexes.size();
+    BufferedLogForwarder::setUp();
     return;
   }
 
@@ -8,18 +8,45 @@
  *
  */
 
+#include <algorithm>
+#include <atomic>
+#include <deque>
 #include <sstream>
 
 #include <osquery/core.h>
 #include <osquery/logger.h>
 #include <osquery/registry.h>
 #include <osquery/sql.h>
+#include <osquery/system.h>
 #include <osquery/tables.h>
 
 namespace osquery {
 
 FLAG(int32, value_max, 512, "Maximum returned row value size");
 
+FLAG(uint64,
+     query_profiles,
+     0,
+     "Number of recent scheduled query profiles kept, 0 disables profiling");
+
+/// The active profile of a thread, and the depth of nested starts.
+struct ActiveProfile {
+  QueryProfile profile;
+  uint64_t start{0};
+  size_t depth{0};
+};
+
+static thread_local ActiveProfile kActiveProfile;
+
+/// Identifiers assigned to started profiles.
+static std::atomic<size_t> kQueryProfileID{0};
+
+/// Protect the finished profiles.
+static Mutex kQueryProfilesMutex;
+
+/// The most recently finished profiles, bounded by `--query_profiles`.
+static std::deque<QueryProfile> kQueryProfiles;
+
 SQL::SQL(const std::string& q) {
   status_ = query(q, results_);
 }
@@ -148,4 +175,102 @@ Status getQueryColumns(const std::string& q, TableColumns& columns) {
   }
   return status;
 }
+
+bool QueryProfiler::enabled() {
+  return FLAGS_query_profiles > 0;
+}
+
+bool QueryProfiler::active() {
+  return kActiveProfile.depth > 0;
+}
+
+void QueryProfiler::start(const std::string& name, const std::string& query) {
+  if (kActiveProfile.depth++ > 0) {
+    // Nested executions are accumulated into the outer profile.
+    return;
+  }
+
+  kActiveProfile.profile = QueryProfile();
+  kActiveProfile.profile.id = ++kQueryProfileID;
+  kActiveProfile.profile.name = name;
+  kActiveProfile.profile.query = query;
+  kActiveProfile.profile.time = getUnixTime();
+  kActiveProfile.start = now();
+}
+
+bool QueryProfiler::finish(QueryProfile& profile) {
+  if (kActiveProfile.depth == 0 || --kActiveProfile.depth > 0) {
+    return false;
+  }
+
+  kActiveProfile.profile.wall_time = now() - kActiveProfile.start;
+  profile = std::move(kActiveProfile.profile);
+  kActiveProfile.profile = QueryProfile();
+
+  if (FLAGS_query_profiles > 0) {
+    WriteLock lock(kQueryProfilesMutex);
+    kQueryProfiles.push_back(profile);
+    while (kQueryProfiles.size() > FLAGS_query_profiles) {
+      kQueryProfiles.pop_front();
+    }
+  }
+  return true;
+}
+
+void QueryProfiler::recordRows(size_t rows) {
+  if (active()) {
+    kActiveProfile.profile.rows += rows;
+  }
+}
+
+void QueryProfiler::recordScan(const std::string& table,
+                               const std::set<std::string>& constraints,
+                               size_t rows,
+                               uint64_t time,
+                               bool filter) {
+  if (!active()) {
+    return;
+  }
+
+  auto& tables = kActiveProfile.profile.tables;
+  auto it = std::find_if(
+      tables.begin(), tables.end(), [&table](const TableProfile& entry) {
+        return entry.table == table;
+      });
+  if (it == tables.end()) {
+    tables.push_back(TableProfile());
+    tables.back().table = table;
+    it = tables.end() - 1;
+  }
+
+  it->filters += (filter) ? 1 : 0;
+  it->rows += rows;
+  it->time += time;
+  it->constraints.insert(constraints.begin(), constraints.end());
+}
+
+void QueryProfiler::recordPhase(QueryPhase phase, uint64_t time) {
+  if (!active()) {
+    return;
+  }
+
+  auto& profile = kActiveProfile.profile;
+  switch (phase) {
+  case QueryPhase::SERIALIZE:
+    profile.serialize_time += time;
+    break;
+  case QueryPhase::DIFF:
+    profile.diff_time += time;
+    break;
+  case QueryPhase::LOG:
+    profile.log_time += time;
+    break;
+  }
+}
+
+std::vector<QueryProfile> QueryProfiler::history() {
+  WriteLock lock(kQueryProfilesMutex);
+  return std::vector<QueryProfile>(kQueryProfiles.begin(),
+                                   kQueryProfiles.end());
+}
 }
@@ -226,6 +226,7 @@ void SQLiteDBInstance::clearAffectedTables() {
 
   for (const auto& table : affected_tables_) {
     table.second->constraints.clear();
+    table.second->used_columns.clear();
     table.second->cache.clear();
   }
   // Since the affected tables are cleared, there are no more affected tables.
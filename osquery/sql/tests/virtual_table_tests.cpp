@@ -194,6 +194,7 @@ class pTablePlugin : public TablePlugin {
 
  private:
   FRIEND_TEST(VirtualTableTests, test_constraints_stacking);
+  FRIEND_TEST(VirtualTableTests, test_query_profile);
 };
 
 class kTablePlugin : public TablePlugin {
@@ -214,6 +215,7 @@ class kTablePlugin : public TablePlugin {
 
  private:
   FRIEND_TEST(VirtualTableTests, test_constraints_stacking);
+  FRIEND_TEST(VirtualTableTests, test_query_profile);
 };
 
 static QueryData makeResult(const std::string& col,
@@ -422,6 +424,110 @@ TEST_F(VirtualTableTests, test_table_cache) {
   ASSERT_EQ(results[0]["data"], "awesome_data");
 }
 
+class usedColumnsTablePlugin : public TablePlugin {
+ private:
+  TableColumns columns() const override {
+    return {
+        std::make_tuple("cheap", TEXT_TYPE, ColumnOptions::DEFAULT),
+        std::make_tuple("costly", TEXT_TYPE, ColumnOptions::DEFAULT),
+    };
+  }
+
+ public:
+  QueryData generate(QueryContext& context) override {
+    scans++;
+    Row r = {{"cheap", "1"}};
+    generated_costly = context.isColumnUsed("costly");
+    if (generated_costly) {
+      r["costly"] = "2";
+    }
+    return {r};
+  }
+
+  /// Set if the last generate included the costly column.
+  static bool generated_costly;
+
+  /// Number of times the table was generated.
+  static size_t scans;
+
+ private:
+  FRIEND_TEST(VirtualTableTests, test_used_columns);
+};
+
+bool usedColumnsTablePlugin::generated_costly{false};
+size_t usedColumnsTablePlugin::scans{0};
+
+TEST_F(VirtualTableTests, test_used_columns) {
+  Registry::add<usedColumnsTablePlugin>("table", "used_columns");
+  auto dbc = SQLiteDBManager::getUnique();
+  {
+    auto table = std::make_shared<usedColumnsTablePlugin>();
+    attachTableInternal("used_columns", table->columnDefinition(), dbc);
+  }
+
+  // The costly column is not generated when the query does not read it.
+  QueryData results;
+  auto status =
+      queryInternal("SELECT cheap FROM used_columns", results, dbc->db());
+  dbc->clearAffectedTables();
+  EXPECT_TRUE(status.ok());
+  ASSERT_EQ(results.size(), 1U);
+  EXPECT_EQ(results[0]["cheap"], "1");
+  EXPECT_FALSE(usedColumnsTablePlugin::generated_costly);
+
+  // Columns used only within a predicate are generated.
+  results.clear();
+  queryInternal("SELECT cheap FROM used_columns WHERE costly = '2'",
+                results,
+                dbc->db());
+  dbc->clearAffectedTables();
+  EXPECT_EQ(results.size(), 1U);
+  EXPECT_TRUE(usedColumnsTablePlugin::generated_costly);
+
+  results.clear();
+  queryInternal("SELECT * FROM used_columns", results, dbc->db());
+  dbc->clearAffectedTables();
+  ASSERT_EQ(results.size(), 1U);
+  EXPECT_EQ(results[0]["costly"], "2");
+
+  // Within a tick a complete scan is shared with plans reading fewer columns.
+  std::vector<std::string> order = {"all", "cheap"};
+  usedColumnsTablePlugin::scans = 0;
+  SharedScans::startTick(order);
+  results.clear();
+  queryInternal("SELECT * FROM used_columns", results, dbc->db());
+  dbc->clearAffectedTables();
+  results.clear();
+  queryInternal("SELECT cheap FROM used_columns", results, dbc->db());
+  dbc->clearAffectedTables();
+  EXPECT_EQ(1U, results.size());
+  EXPECT_EQ(1U, usedColumnsTablePlugin::scans);
+
+  // A scan that skipped a column is not shared with plans reading it.
+  SharedScans::endTick();
+  SharedScans::startTick(order);
+  results.clear();
+  queryInternal("SELECT cheap FROM used_columns", results, dbc->db());
+  dbc->clearAffectedTables();
+  results.clear();
+  queryInternal("SELECT * FROM used_columns", results, dbc->db());
+  dbc->clearAffectedTables();
+  SharedScans::endTick();
+  ASSERT_EQ(1U, results.size());
+  EXPECT_EQ(results[0]["costly"], "2");
+  EXPECT_EQ(3U, usedColumnsTablePlugin::scans);
+
+  // A context without a query plan uses every column.
+  QueryContext context;
+  EXPECT_TRUE(context.isColumnUsed("costly"));
+  EXPECT_FALSE(context.isColumnPruned());
+  context.used_columns = UsedColumns{"cheap"};
+  EXPECT_FALSE(context.isColumnUsed("costly"));
+  EXPECT_TRUE(context.isColumnPruned());
+  EXPECT_TRUE(context.isAnyColumnUsed({"costly", "cheap"}));
+  Registry::registry("table")->remove("used_columns");
+}
+
 class indexIOptimizedTablePlugin : public TablePlugin {
  private:
   TableColumns columns() const override {
@@ -560,4 +666,187 @@ TEST_F(VirtualTableTests, test_indexing_costs) {
   EXPECT_EQ(10U, i->scans);
   EXPECT_EQ(10U, j->scans);
 }
+
+class sharedScanTablePlugin : public TablePlugin {
+ private:
+  TableColumns columns() const override {
+    return {
+        std::make_tuple("i", INTEGER_TYPE, ColumnOptions::INDEX),
+    };
+  }
+
+  TableAttributes attributes() const override {
+    return attributes_;
+  }
+
+ public:
+  QueryData generate(QueryContext& context) override {
+    scans++;
+
+    QueryData results;
+    auto indexes = context.constraints["i"].getAll<int>(EQUALS);
+    for (size_t i = 0; i < 10; i++) {
+      if (indexes.empty() || indexes.count(static_cast<int>(i)) > 0) {
+        results.push_back({{"i", INTEGER(i)}});
+      }
+    }
+    return results;
+  }
+
+  size_t scans{0};
+
+  TableAttributes attributes_{TableAttributes::NONE};
+};
+
+TEST_F(VirtualTableTests, test_shared_scans) {
+  auto dbc = SQLiteDBManager::getUnique();
+  auto table_registry = Registry::registry("table");
+
+  auto shared = std::make_shared<sharedScanTablePlugin>();
+  shared->setName("shared_scan");
+  table_registry->add(shared);
+  attachTableInternal("shared_scan", shared->columnDefinition(), dbc);
+
+  // Without an open tick every query generates the table.
+  QueryData results;
+  queryInternal("SELECT * from shared_scan", results, dbc->db());
+  dbc->clearAffectedTables();
+  queryInternal("SELECT * from shared_scan", results, dbc->db());
+  dbc->clearAffectedTables();
+  EXPECT_EQ(2U, shared->scans);
+
+  // Within a tick the second query is served from the first scan.
+  shared->scans = 0;
+  std::vector<std::string> order = {"first", "second"};
+  SharedScans::startTick(order);
+  for (const auto& name : order) {
+    results.clear();
+    SharedScans::startQuery(name);
+    queryInternal("SELECT * from shared_scan", results, dbc->db());
+    dbc->clearAffectedTables();
+    SharedScans::endQuery();
+    EXPECT_EQ(10U, results.size());
+  }
+
+  // Different constraints are a different snapshot.
+  results.clear();
+  queryInternal("SELECT * from shared_scan where i = 1", results, dbc->db());
+  dbc->clearAffectedTables();
+  SharedScans::endTick();
+  EXPECT_EQ(1U, results.size());
+  EXPECT_EQ(2U, shared->scans);
+
+  // The observed table use is remembered for the next tick.
+  EXPECT_EQ(1U, SharedScans::instance().query_tables_["first"].size());
+
+  // Volatile tables are always generated.
+  shared->scans = 0;
+  shared->attributes_ = TableAttributes::VOLATILE;
+  dbc = SQLiteDBManager::getUnique();
+  attachTableInternal("shared_scan", shared->columnDefinition(), dbc);
+  SharedScans::startTick(order);
+  for (size_t i = 0; i < 2; i++) {
+    queryInternal("SELECT * from shared_scan", results, dbc->db());
+    dbc->clearAffectedTables();
+  }
+  SharedScans::endTick();
+  EXPECT_EQ(2U, shared->scans);
+
+  // Queries may touch no shareable tables.
+  SharedScans::startTick(order);
+  for (const auto& name : order) {
+    SharedScans::startQuery(name);
+    queryInternal((name == "first") ? "SELECT 1" : "SELECT * from shared_scan",
+                  results,
+                  dbc->db());
+    dbc->clearAffectedTables();
+    SharedScans::endQuery();
+  }
+  SharedScans::endTick();
+  EXPECT_TRUE(SharedScans::instance().query_tables_["first"].empty());
+  EXPECT_TRUE(SharedScans::instance().query_tables_["second"].empty());
+
+  // Queries touching the same tables are grouped and share one scan.
+  shared->attributes_ = TableAttributes::NONE;
+  dbc = SQLiteDBManager::getUnique();
+  attachTableInternal("shared_scan", shared->columnDefinition(), dbc);
+  // The expression filter is evaluated by SQLite, not used as a constraint.
+  std::map<std::string, std::string> queries = {
+      {"a", "SELECT * from shared_scan"},
+      {"b", "SELECT 1"},
+      {"c", "SELECT * from shared_scan where i + 0 > 4"},
+  };
+  auto tick = [&queries, &results, &dbc](std::vector<std::string>& names) {
+    SharedScans::startTick(names);
+    for (const auto& name : names) {
+      results.clear();
+      SharedScans::startQuery(name);
+      queryInternal(queries.at(name), results, dbc->db());
+      dbc->clearAffectedTables();
+      SharedScans::endQuery();
+    }
+    SharedScans::endTick();
+  };
+
+  // The first tick observes each query's table use.
+  order = {"a", "b", "c"};
+  tick(order);
+
+  shared->scans = 0;
+  order = {"a", "b", "c"};
+  tick(order);
+  EXPECT_EQ(std::vector<std::string>({"b", "a", "c"}), order);
+  EXPECT_EQ(5U, results.size());
+  EXPECT_EQ(1U, shared->scans);
+}
+
+TEST_F(VirtualTableTests, test_query_profile) {
+  Registry::add<pTablePlugin>("table", "p");
+  Registry::add<kTablePlugin>("table", "k");
+  auto dbc = SQLiteDBManager::getUnique();
+  {
+    auto p = std::make_shared<pTablePlugin>();
+    attachTableInternal("p", p->columnDefinition(), dbc);
+    auto k = std::make_shared<kTablePlugin>();
+    attachTableInternal("k", k->columnDefinition(), dbc);
+  }
+
+  // Scans are only recorded while a profile is active.
+  QueryData results;
+  queryInternal("select * from p", results, dbc->db());
+  EXPECT_FALSE(QueryProfiler::active());
+
+  auto profiles = FLAGS_query_profiles;
+  FLAGS_query_profiles = 1;
+  std::string query = "select k.x from p, k where k.x = p.x";
+  QueryProfiler::start("profile", query);
+  results.clear();
+  queryInternal(query, results, dbc->db());
+  QueryProfiler::recordRows(results.size());
+  QueryProfiler::recordPhase(QueryPhase::LOG, 10);
+
+  QueryProfile profile;
+  EXPECT_TRUE(QueryProfiler::finish(profile));
+  EXPECT_FALSE(QueryProfiler::active());
+  EXPECT_EQ("profile", profile.name);
+  EXPECT_EQ(2U, profile.rows);
+  EXPECT_EQ(10U, profile.log_time);
+  ASSERT_EQ(2U, profile.tables.size());
+
+  // The inner table of the JOIN is filtered for each outer row.
+  size_t filters = 0;
+  size_t constrained = 0;
+  for (const auto& table : profile.tables) {
+    filters += table.filters;
+    constrained += table.constraints.count("x =");
+  }
+  EXPECT_EQ(3U, filters);
+  EXPECT_EQ(1U, constrained);
+
+  // The finished profile is kept for the osquery_query_profile table.
+  auto history = QueryProfiler::history();
+  ASSERT_EQ(1U, history.size());
+  EXPECT_EQ(profile.id, history[0].id);
+  FLAGS_query_profiles = profiles;
+}
 }
@@ -8,11 +8,13 @@
  *
  */
 
+#include <algorithm>
 #include <atomic>
 
 #include <osquery/core.h>
 #include <osquery/flags.h>
 #include <osquery/logger.h>
+#include <osquery/sql.h>
 #include <osquery/system.h>
 
 #include "osquery/sql/virtual_table.h"
@@ -27,6 +29,180 @@ DECLARE_bool(disable_events);
 
 RecursiveMutex kAttachMutex;
 
+/**
+ * @brief The maximum number of shared snapshots kept for a table in a tick.
+ *
+ * JOINs on an index column issue a filter per outer row, each with a unique
+ * constraint set. Past this count scans are generated but not shared.
+ */
+const size_t kMaxSharedScans = 1024;
+
+/**
+ * @brief Serialize the constraints of a query context into a snapshot key.
+ *
+ * Most tables generate every column regardless of the plan, and those scans
+ * are shared by any plan with the same constraints. Only tables that skipped
+ * an unused column include the used columns in the key.
+ */
+static std::string sharedScanKey(const QueryContext& context, bool columns) {
+  std::string key;
+  for (const auto& column : context.constraints) {
+    for (const auto& constraint : column.second.getAll()) {
+      key += column.first + ' ' + std::to_string(constraint.op) + ' ' +
+             constraint.expr + '\n';
+    }
+  }
+
+  // Rows generated for a subset of columns are only shared with plans that
+  // read the same columns.
+  if (columns && context.used_columns) {
+    key += '\n';
+    std::set<std::string> used(context.used_columns->begin(),
+                               context.used_columns->end());
+    for (const auto& column : used) {
+      key += column + ',';
+    }
+  }
+  return key;
+}
+
+void SharedScans::startTick(std::vector<std::string>& queries) {
+  auto& self = instance();
+  WriteLock lock(self.mutex_);
+  self.owner_ = std::this_thread::get_id();
+  self.active_ = true;
+  self.pending_.clear();
+  self.unknown_ = 0;
+  self.snapshots_.clear();
+
+  // Group queries with the same observed tables, unknown queries run last.
+  std::map<std::string, std::string> signatures;
+  for (const auto& name : queries) {
+    auto tables = self.query_tables_.find(name);
+    if (tables == self.query_tables_.end()) {
+      self.unknown_++;
+      signatures[name] = "\xff";
+      continue;
+    }
+    // Queries without shareable tables are grouped together.
+    signatures[name] = "";
+    for (const auto& table : tables->second) {
+      self.pending_[table]++;
+      signatures[name] += table + ',';
+    }
+  }
+  std::stable_sort(
+      queries.begin(),
+      queries.end(),
+      [&signatures](const std::string& a, const std::string& b) {
+        return signatures.at(a) < signatures.at(b);
+      });
+}
+
+void SharedScans::startQuery(const std::string& name) {
+  auto& self = instance();
+  WriteLock lock(self.mutex_);
+  if (self.active_) {
+    self.query_ = name;
+    self.query_touched_.clear();
+  }
+}
+
+void SharedScans::endQuery() {
+  auto& self = instance();
+  WriteLock lock(self.mutex_);
+  if (!self.active_ || self.query_.empty()) {
+    return;
+  }
+
+  // Replace the expected table use with what was observed.
+  auto tables = self.query_tables_.find(self.query_);
+  if (tables == self.query_tables_.end()) {
+    self.unknown_--;
+  } else {
+    for (const auto& table : tables->second) {
+      if (self.pending_[table] > 0) {
+        self.pending_[table]--;
+      }
+    }
+  }
+  self.query_tables_[self.query_] = std::move(self.query_touched_);
+  self.query_touched_.clear();
+  self.query_.clear();
+  self.release();
+}
+
+void SharedScans::endTick() {
+  auto& self = instance();
+  WriteLock lock(self.mutex_);
+  self.active_ = false;
+  self.query_.clear();
+  self.pending_.clear();
+  self.snapshots_.clear();
+}
+
+void SharedScans::release() {
+  if (unknown_ > 0) {
+    // A query without observed table use may touch any table.
+    return;
+  }
+
+  for (auto it = snapshots_.begin(); it != snapshots_.end();) {
+    if (pending_[it->first] == 0) {
+      it = snapshots_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+bool SharedScans::enabled(const VirtualTableContent& content) {
+  if ((content.attributes &
+       (TableAttributes::EVENT_BASED | TableAttributes::VOLATILE)) != 0) {
+    return false;
+  }
+
+  // The tick owner and state are atomic, cursors need not take the lock.
+  auto& self = instance();
+  return (self.active_ && self.owner_ == std::this_thread::get_id());
+}
+
+std::shared_ptr<const QueryData> SharedScans::get(
+    const VirtualTableContent& content, const QueryContext& context) {
+  auto& self = instance();
+  WriteLock lock(self.mutex_);
+  self.query_touched_.insert(content.name);
+
+  auto table = self.snapshots_.find(content.name);
+  if (table == self.snapshots_.end()) {
+    return nullptr;
+  }
+  // A complete scan is shared, otherwise one generated for the same columns.
+  auto snapshot = table->second.find(sharedScanKey(context, false));
+  if (snapshot == table->second.end()) {
+    snapshot = table->second.find(sharedScanKey(context, true));
+  }
+  if (snapshot == table->second.end()) {
+    return nullptr;
+  }
+  return snapshot->second;
+}
+
+std::shared_ptr<const QueryData> SharedScans::set(
+    const VirtualTableContent& content,
+    const QueryContext& context,
+    QueryData&& data) {
+  auto snapshot = std::make_shared<const QueryData>(std::move(data));
+
+  auto& self = instance();
+  WriteLock lock(self.mutex_);
+  auto& table = self.snapshots_[content.name];
+  if (table.size() < kMaxSharedScans) {
+    table[sharedScanKey(context, context.isColumnPruned())] = snapshot;
+  }
+  return snapshot;
+}
+
 namespace tables {
 namespace sqlite {
 
@@ -120,12 +296,33 @@ int xDestroy(sqlite3_vtab* p) {
 int xNext(sqlite3_vtab_cursor* cur) {
   BaseCursor* pCur = (BaseCursor*)cur;
   pCur->row++;
+  while (pCur->remote != nullptr && pCur->row >= pCur->n &&
+         !pCur->remote->done()) {
+    // The batch is consumed, replace it with the extension's next batch.
+    auto start = (QueryProfiler::active()) ? QueryProfiler::now() : 0;
+    auto status = pCur->remote->next(pCur->data);
+    if (!status.ok()) {
+      LOG(WARNING) << "Could not read extension table batch: "
+                   << status.getMessage();
+    }
+    pCur->offset += pCur->n;
+    pCur->row = 0;
+    pCur->n = pCur->data.size();
+    if (QueryProfiler::active()) {
+      auto* pVtab = (VirtualTable*)cur->pVtab;
+      QueryProfiler::recordScan(pVtab->content->name,
+                                {},
+                                pCur->n,
+                                QueryProfiler::now() - start,
+                                false);
+    }
+  }
   return SQLITE_OK;
 }
 
 int xRowid(sqlite3_vtab_cursor* cur, sqlite_int64* pRowid) {
   const BaseCursor* pCur = (BaseCursor*)cur;
-  *pRowid = pCur->row;
+  *pRowid = pCur->offset + pCur->row;
   return SQLITE_OK;
 }
 
@@ -233,7 +430,8 @@ int xColumn(sqlite3_vtab_cursor* cur, sqlite3_context* ctx, int col) {
     // Requested column index greater than column set size.
     return SQLITE_ERROR;
   }
-  if (pCur->row >= pCur->data.size()) {
+  const auto& rows = pCur->rows();
+  if (pCur->row >= rows.size()) {
     // Request row index greater than row set size.
     return SQLITE_ERROR;
   }
@@ -249,12 +447,17 @@ int xColumn(sqlite3_vtab_cursor* cur, sqlite3_context* ctx, int col) {
   }
 
   // Attempt to cast each xFilter-populated row/column to the SQLite type.
-  const auto& value = pCur->data[pCur->row][column_name];
-  if (pCur->data[pCur->row].count(column_name) == 0) {
+  const auto& row = rows[pCur->row];
+  auto column = row.find(column_name);
+  if (column == row.end()) {
     // Missing content.
     VLOG(1) << "Error " << column_name << " is empty";
     sqlite3_result_null(ctx);
-  } else if (type == TEXT_TYPE) {
+    return SQLITE_OK;
+  }
+
+  const auto& value = column->second;
+  if (type == TEXT_TYPE) {
     sqlite3_result_text(
         ctx, value.c_str(), static_cast<int>(value.size()), SQLITE_STATIC);
   } else if (type == INTEGER_TYPE) {
@@ -376,6 +579,21 @@ static int xBestIndex(sqlite3_vtab* tab, sqlite3_index_info* pIdxInfo) {
     cost += 200;
   }
 
+  // Record the columns the plan reads, the last bit covers every column past
+  // the 63rd.
+  UsedColumns used_columns;
+  for (size_t i = 0; i < columns.size(); i++) {
+    if (pIdxInfo->colUsed & (1ULL << std::min(i, (size_t)63))) {
+      used_columns.insert(std::get<0>(columns[i]));
+      // Aliases are read from the column they alias.
+      const auto& aliases = pVtab->content->aliases;
+      if (aliases.count(std::get<0>(columns[i])) > 0) {
+        used_columns.insert(
+            std::get<0>(columns[aliases.at(std::get<0>(columns[i]))]));
+      }
+    }
+  }
+
   pIdxInfo->idxNum = static_cast<int>(kConstraintIndexID++);
 #if defined(DEBUG)
   plan("Recording constraint set for table: " + pVtab->content->name +
@@ -385,6 +603,7 @@ static int xBestIndex(sqlite3_vtab* tab, sqlite3_index_info* pIdxInfo) {
 #endif
   // Add the constraint set to the table's tracked constraints.
   pVtab->content->constraints[pIdxInfo->idxNum] = std::move(constraints);
+  pVtab->content->used_columns[pIdxInfo->idxNum] = std::move(used_columns);
   pIdxInfo->estimatedCost = cost;
   return SQLITE_OK;
 }
@@ -442,6 +661,11 @@ static int xFilter(sqlite3_vtab_cursor* pVtabCursor,
        std::to_string(argc) + " idx=" + std::to_string(idxNum) + "]");
 #endif
 
+  // Tables may skip generating the columns the plan does not read.
+  if (content->used_columns.count(idxNum) > 0) {
+    context.used_columns = content->used_columns.at(idxNum);
+  }
+
   // Iterate over every argument to xFilter, filling in constraint values.
   if (content->constraints.size() > 0) {
     auto& constraints = content->constraints[idxNum];
@@ -502,14 +726,66 @@ static int xFilter(sqlite3_vtab_cursor* pVtabCursor,
 
   // Reset the virtual table contents.
   pCur->data.clear();
+  pCur->snapshot = nullptr;
+  pCur->remote = nullptr;
+  pCur->offset = 0;
   options.clear();
 
-  // Generate the row data set.
-  plan("Scanning rows for cursor (" + std::to_string(pCur->id) + ")");
-  Registry::callTable(pVtab->content->name, context, pCur->data);
+  // Profile the time spent generating rows for this filter.
+  auto start = (QueryProfiler::active()) ? QueryProfiler::now() : 0;
+  if (SharedScans::enabled(*content)) {
+    // Within a scheduler tick the scan may be served from, or saved as, a
+    // snapshot shared with the other queries in the tick.
+    pCur->snapshot = SharedScans::get(*content, context);
+    if (pCur->snapshot == nullptr) {
+      plan("Scanning shared rows for cursor (" + std::to_string(pCur->id) +
+           ")");
+      QueryData data;
+      Registry::callTable(pVtab->content->name, context, data);
+      pCur->snapshot = SharedScans::set(*content, context, std::move(data));
+    } else {
+      plan("Using shared rows for cursor (" + std::to_string(pCur->id) + ")");
+    }
+  } else {
+    // Extension tables are read in batches when the extension supports it.
+    bool generate = true;
+    if (ExtensionTableCursor::enabled(content->name)) {
+      pCur->remote.reset(new ExtensionTableCursor(content->name));
+      auto status = pCur->remote->open(context, pCur->data);
+      if (status.ok()) {
+        plan("Reading extension batches for cursor (" +
+             std::to_string(pCur->id) + ")");
+        generate = false;
+      } else if (!pCur->remote->unsupported()) {
+        // The extension failed to generate the table, do not generate again.
+        LOG(WARNING) << "Could not read extension table " << content->name
+                     << ": " << status.getMessage();
+        generate = false;
+      }
+    }
+
+    if (generate) {
+      // Generate the row data set.
+      pCur->remote = nullptr;
+      pCur->data.clear();
+      plan("Scanning rows for cursor (" + std::to_string(pCur->id) + ")");
+      Registry::callTable(content->name, context, pCur->data);
+    }
+  }
 
   // Set the number of rows.
-  pCur->n = pCur->data.size();
+  pCur->n = pCur->rows().size();
+
+  if (QueryProfiler::active()) {
+    std::set<std::string> used;
+    for (const auto& column : context.constraints) {
+      for (const auto& constraint : column.second.getAll()) {
+        used.insert(column.first + " " + opString(constraint.op));
+      }
+    }
+    QueryProfiler::recordScan(
+        content->name, used, pCur->n, QueryProfiler::now() - start, true);
+  }
   return SQLITE_OK;
 }
 }
@@ -10,8 +10,13 @@
 
 #pragma once
 
+#include <atomic>
+#include <set>
+#include <thread>
+
 #include <boost/noncopyable.hpp>
 
+#include <osquery/extensions.h>
 #include <osquery/tables.h>
 
 #include "osquery/core/conversions.h"
@@ -44,11 +49,25 @@ struct BaseCursor : private boost::noncopyable {
   /// Table data generated from last access.
   QueryData data;
 
+  /// A table scan shared within a scheduler tick, used instead of data.
+  std::shared_ptr<const QueryData> snapshot{nullptr};
+
+  /// Accessor for the rows this cursor iterates, shared or generated.
+  const QueryData& rows() const {
+    return (snapshot != nullptr) ? *snapshot : data;
+  }
+
   /// Current cursor position.
   size_t row{0};
 
   /// Total number of rows.
   size_t n{0};
+
+  /// An extension table read in batches, data holds the current batch.
+  std::unique_ptr<ExtensionTableCursor> remote{nullptr};
+
+  /// The number of rows in batches before the current batch.
+  size_t offset{0};
 };
 
 /**
@@ -68,6 +87,97 @@ struct VirtualTable : private boost::noncopyable {
   SQLiteDBInstance *instance{nullptr};
 };
 
+/**
+ * @brief Share virtual table scans between scheduled queries in a tick.
+ *
+ * Packs often run several queries against the same expensive table at the
+ * same interval. While the scheduler has a tick open, each table is generated
+ * once per set of constraints and every other cursor opened by the scheduler
+ * thread within that tick is served from the resulting snapshot.
+ *
+ * The scheduler reports each query it launches so the tables a query touches
+ * are remembered. Later ticks group due queries by those tables and release a
+ * table's snapshots once no remaining query in the tick is expected to use it.
+ *
+ * EVENT_BASED tables and tables marked VOLATILE are never shared.
+ */
+class SharedScans : private boost::noncopyable {
+ public:
+  /**
+   * @brief Open a tick for the calling thread.
+   *
+   * The list of due query names is reordered such that queries touching the
+   * same set of tables (as observed in previous ticks) run consecutively.
+   *
+   * @param queries The names of the scheduled queries due within this tick.
+   */
+  static void startTick(std::vector<std::string>& queries);
+
+  /// Note the scheduled query about to run within the open tick.
+  static void startQuery(const std::string& name);
+
+  /// Record the tables the running query touched and release snapshots.
+  static void endQuery();
+
+  /// Close the tick and drop every remaining snapshot.
+  static void endTick();
+
+  /// Check if scans of the table may be shared by the calling thread.
+  static bool enabled(const VirtualTableContent& content);
+
+  /// Lookup a snapshot for the table and constraints, nullptr if missing.
+  static std::shared_ptr<const QueryData> get(
+      const VirtualTableContent& content, const QueryContext& context);
+
+  /// Save generated table data as the snapshot for the table and constraints.
+  static std::shared_ptr<const QueryData> set(
+      const VirtualTableContent& content,
+      const QueryContext& context,
+      QueryData&& data);
+
+ private:
+  static SharedScans& instance() {
+    static SharedScans instance;
+    return instance;
+  }
+
+  /// Drop the snapshots for tables no remaining query expects to use.
+  void release();
+
+ private:
+  /// Protect the tick state from non-scheduler cursors.
+  Mutex mutex_;
+
+  /// The scheduler thread owning the open tick.
+  std::atomic<std::thread::id> owner_;
+
+  /// True while a tick is open.
+  std::atomic<bool> active_{false};
+
+  /// The name of the scheduled query running within the tick.
+  std::string query_;
+
+  /// Tables touched by the running query.
+  std::set<std::string> query_touched_;
+
+  /// The tables each scheduled query touched the last time it ran.
+  std::map<std::string, std::set<std::string>> query_tables_;
+
+  /// Count of remaining queries in the tick expected to touch each table.
+  std::map<std::string, size_t> pending_;
+
+  /// Count of remaining queries in the tick with unknown table use.
+  size_t unknown_{0};
+
+  /// Table name to the map of serialized constraints and snapshot.
+  std::map<std::string,
+           std::map<std::string, std::shared_ptr<const QueryData>>>
+      snapshots_;
+
+ private:
+  FRIEND_TEST(VirtualTableTests, test_shared_scans);
+};
+
 /// Attach a table plugin name to an in-memory SQLite database.
 Status attachTableInternal(const std::string &name,
                            const std::string &statement,
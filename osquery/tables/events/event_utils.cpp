@@ -8,7 +8,11 @@
  *
  */
 
+#include <boost/algorithm/string/split.hpp>
+#include <boost/algorithm/string/classification.hpp>
+
 #include <osquery/events.h>
+#include <osquery/flags.h>
 #include <osquery/hash.h>
 #include <osquery/sql.h>
 
@@ -16,10 +20,41 @@
 
 namespace osquery {
 
+FLAG(string,
+     file_events_hashes,
+     "md5,sha1,sha256",
+     "Comma-separated digests (md5, sha1, sha256) computed for file events");
+
 const std::set<std::string> kCommonFileColumns = {
     "inode", "uid", "gid", "mode", "size", "atime", "mtime", "ctime",
 };
 
+/// Parse the configured file event digests into a hash mask.
+static int getFileEventHashes() {
+  static std::string flag;
+  static int mask = 0;
+  static Mutex mask_mutex;
+
+  WriteLock lock(mask_mutex);
+  if (flag != FLAGS_file_events_hashes || mask == 0) {
+    flag = FLAGS_file_events_hashes;
+    std::vector<std::string> names;
+    boost::split(names, flag, boost::is_any_of(", "));
+
+    mask = 0;
+    for (const auto& name : names) {
+      if (name == "md5") {
+        mask |= HASH_TYPE_MD5;
+      } else if (name == "sha1") {
+        mask |= HASH_TYPE_SHA1;
+      } else if (name == "sha256") {
+        mask |= HASH_TYPE_SHA256;
+      }
+    }
+  }
+  return mask;
+}
+
 void decorateFileEvent(const std::string& path, bool hash, Row& r) {
   auto results = SQL::selectAllFrom("file", "path", EQUALS, path);
   if (results.size() == 1) {
@@ -31,14 +66,17 @@ void decorateFileEvent(const std::string& path, bool hash, Row& r) {
     }
   }
 
-  if (hash) {
-    auto hashes = hashMultiFromFile(
-        HASH_TYPE_MD5 | HASH_TYPE_SHA1 | HASH_TYPE_SHA256, path);
+  auto mask = (hash) ? getFileEventHashes() : 0;
+  if (mask != 0) {
+    // Only the configured digests are computed, the others are empty.
+    auto hashes = hashMultiFromFile(mask, path);
     r["md5"] = std::move(hashes.md5);
     r["sha1"] = std::move(hashes.sha1);
     r["sha256"] = std::move(hashes.sha256);
     // Hashed determines the success/status of hashing, -1 failed, 1 success.
-    r["hashed"] = (r.at("md5").empty()) ? "-1" : "1";
+    bool hashed = !r.at("md5").empty() || !r.at("sha1").empty() ||
+                  !r.at("sha256").empty();
+    r["hashed"] = (hashed) ? "1" : "-1";
   } else {
     // Alternatively if hashing wasn't needed hashed is a 0.
     r["hashed"] = "0";
@@ -8,15 +8,29 @@
  *
  */
 
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include <boost/algorithm/string/trim.hpp>
+
 #include <osquery/config.h>
+#include <osquery/filesystem.h>
+#include <osquery/flags.h>
 #include <osquery/logger.h>
 #include <osquery/sql.h>
 #include <osquery/system.h>
 
+#include "osquery/core/conversions.h"
 #include "osquery/events/linux/audit.h"
+#include "osquery/events/linux/process_connector.h"
 
 namespace osquery {
 
+DECLARE_bool(disable_audit);
+DECLARE_bool(disable_proc_connector);
+
 #define AUDIT_SYSCALL_EXECVE 59
 
 // Depend on the external getUptime table method.
@@ -24,15 +38,17 @@ namespace tables {
 extern long getUptime();
 }
 
-bool ProcessUpdate(size_t type, const AuditFields& fields, AuditFields& r) {
+bool ProcessUpdate(size_t type,
+                   const AuditRecordFields& fields,
+                   AuditFields& r) {
   if (type == AUDIT_SYSCALL) {
-    r["pid"] = (fields.count("pid")) ? fields.at("pid") : "0";
-    r["parent"] = fields.count("ppid") ? fields.at("ppid") : "0";
-    r["uid"] = fields.count("uid") ? fields.at("uid") : "0";
-    r["euid"] = fields.count("euid") ? fields.at("euid") : "0";
-    r["gid"] = fields.count("gid") ? fields.at("gid") : "0";
-    r["egid"] = fields.count("egid") ? fields.at("euid") : "0";
-    r["path"] = (fields.count("exe")) ? decodeAuditValue(fields.at("exe")) : "";
+    r["pid"] = fields.str(AUDIT_KEY_PID, "0");
+    r["parent"] = fields.str(AUDIT_KEY_PPID, "0");
+    r["uid"] = fields.str(AUDIT_KEY_UID, "0");
+    r["euid"] = fields.str(AUDIT_KEY_EUID, "0");
+    r["gid"] = fields.str(AUDIT_KEY_GID, "0");
+    r["egid"] = fields.str(AUDIT_KEY_EGID, "0");
+    r["path"] = fields.decoded(AUDIT_KEY_EXE);
 
     auto qd = SQL::selectAllFrom("file", "path", EQUALS, r.at("path"));
     if (qd.size() == 1) {
@@ -43,7 +59,7 @@ bool ProcessUpdate(size_t type, const AuditFields& fields, AuditFields& r) {
     }
 
     // This should get overwritten during the EXECVE state.
-    r["cmdline"] = (fields.count("comm")) ? fields.at("comm") : "";
+    r["cmdline"] = fields.str(AUDIT_KEY_COMM);
     // Do not record a cmdline size. If the final state is reached and no
     // 'argc'
     // has been filled in then the EXECVE state was not used.
@@ -57,36 +73,90 @@ bool ProcessUpdate(size_t type, const AuditFields& fields, AuditFields& r) {
 
   if (type == AUDIT_EXECVE) {
     // Reset the temporary storage from the SYSCALL state.
-    r["cmdline"] = "";
+    auto& cmdline = r["cmdline"];
+    cmdline.clear();
     for (const auto& arg : fields) {
-      if (arg.first == "argc") {
+      if (arg.id != AUDIT_KEY_ARG) {
         continue;
       }
 
-      // Amalgamate all the "arg*" fields.
-      if (r.at("cmdline").size() > 0) {
-        r["cmdline"] += " ";
+      // Amalgamate all the "arg*" fields, in message order.
+      if (cmdline.size() > 0) {
+        cmdline += " ";
       }
-      r["cmdline"] += decodeAuditValue(arg.second);
+      cmdline += decodeAuditValue(fields.value(arg));
     }
 
     // There may be a better way to calculate actual size from audit.
     // Then an overflow could be calculated/determined based on
     // actual/expected.
-    r["cmdline_size"] = std::to_string(r.at("cmdline").size());
+    r["cmdline_size"] = std::to_string(cmdline.size());
 
     // Uptime is helpful for execution-based events.
     r["uptime"] = std::to_string(tables::getUptime());
   }
 
   if (type == AUDIT_PATH) {
-    r["mode"] = (fields.count("mode")) ? fields.at("mode") : "";
-    r["owner_uid"] = fields.count("ouid") ? fields.at("ouid") : "0";
-    r["owner_gid"] = fields.count("ogid") ? fields.at("ogid") : "0";
+    r["mode"] = fields.str(AUDIT_KEY_MODE);
+    r["owner_uid"] = fields.str(AUDIT_KEY_OUID, "0");
+    r["owner_gid"] = fields.str(AUDIT_KEY_OGID, "0");
   }
   return true;
 }
 
+/// Fill in process details for an exec event from /proc while it exists.
+void ProcessConnectorUpdate(pid_t pid, Row& r) {
+  auto proc = "/proc/" + std::to_string(pid);
+
+  // Read the identity of the process, the connector only reports IDs.
+  std::string status;
+  if (readFile(proc + "/status", status).ok()) {
+    for (const auto& line : osquery::split(status, "\n")) {
+      auto detail = osquery::split(line, "\t ");
+      if (detail.size() < 3) {
+        continue;
+      }
+      if (detail[0] == "PPid:") {
+        r["parent"] = detail[1];
+      } else if (detail[0] == "Uid:") {
+        r["uid"] = detail[1];
+        r["euid"] = detail[2];
+      } else if (detail[0] == "Gid:") {
+        r["gid"] = detail[1];
+        r["egid"] = detail[2];
+      }
+    }
+  }
+
+  char link[PATH_MAX] = {0};
+  auto bytes = readlink((proc + "/exe").c_str(), link, sizeof(link) - 1);
+  r["path"] = (bytes > 0) ? std::string(link, bytes) : "";
+
+  std::string cmdline;
+  readFile(proc + "/cmdline", cmdline);
+  std::replace(cmdline.begin(), cmdline.end(), '\0', ' ');
+  boost::algorithm::trim(cmdline);
+  r["cmdline"] = cmdline;
+  r["cmdline_size"] = std::to_string(cmdline.size());
+
+  struct stat file;
+  if (!r.at("path").empty() && stat(r.at("path").c_str(), &file) == 0) {
+    r["mode"] = lsperms(file.st_mode);
+    r["owner_uid"] = std::to_string(file.st_uid);
+    r["owner_gid"] = std::to_string(file.st_gid);
+    r["atime"] = std::to_string(file.st_atime);
+    r["mtime"] = std::to_string(file.st_mtime);
+    r["ctime"] = std::to_string(file.st_ctime);
+    r["btime"] = "0";
+  }
+
+  r["overflows"] = "";
+  r["env_size"] = "0";
+  r["env_count"] = "0";
+  r["env"] = "";
+  r["uptime"] = std::to_string(tables::getUptime());
+}
+
 class ProcessEventSubscriber : public EventSubscriber<AuditEventPublisher> {
  public:
   /// The process event subscriber declares an audit event type subscription.
@@ -95,6 +165,9 @@ class ProcessEventSubscriber : public EventSubscriber<AuditEventPublisher> {
   /// Kernel events matching the event type will fire.
   Status Callback(const ECRef& ec, const SCRef& sc);
 
+  /// Process connector exec events fire when audit is not used.
+  Status ConnectorCallback(const ProcConnectorEventContextRef& ec);
+
  private:
   AuditAssembler asm_;
 };
@@ -115,18 +188,36 @@ Status ProcessEventSubscriber::init() {
   sc->types = {AUDIT_SYSCALL, AUDIT_EXECVE, AUDIT_CWD, AUDIT_PATH};
   subscribe(&ProcessEventSubscriber::Callback, sc);
 
+  // The proc connector is a lighter weight source of process execution.
+  // It is only used when audit is disabled, to avoid duplicate rows.
+  if (FLAGS_disable_audit && !FLAGS_disable_proc_connector) {
+    auto connector_sc = std::make_shared<ProcConnectorSubscriptionContext>();
+    connector_sc->events = PROC_CONNECTOR_EXEC;
+    auto status = EventFactory::addSubscription(
+        "proc_connector",
+        getName(),
+        connector_sc,
+        ([this](const EventContextRef& ec, const SubscriptionContextRef&) {
+          return ConnectorCallback(
+              std::static_pointer_cast<ProcConnectorEventContext>(ec));
+        }));
+    if (status.ok()) {
+      subscription_count_++;
+    }
+  }
+
   return Status(0, "OK");
 }
 
 Status ProcessEventSubscriber::Callback(const ECRef& ec, const SCRef& sc) {
   // Check and set the valid state change.
   // If this is an unacceptable change reset the state and clear row data.
-  if (ec->fields.count("success") && ec->fields.at("success") == "no") {
+  if (ec->fields.get(AUDIT_KEY_SUCCESS) == "no") {
     return Status(0, "OK");
   }
 
-  if (ec->type == AUDIT_PATH && ec->fields.count("item") &&
-      ec->fields.at("item") != "0") {
+  if (ec->type == AUDIT_PATH && ec->fields.has(AUDIT_KEY_ITEM) &&
+      ec->fields.get(AUDIT_KEY_ITEM) != "0") {
     return Status(0, "OK");
   }
 
@@ -137,4 +228,18 @@ Status ProcessEventSubscriber::Callback(const ECRef& ec, const SCRef& sc) {
 
   return Status(0, "OK");
 }
+
+Status ProcessEventSubscriber::ConnectorCallback(
+    const ProcConnectorEventContextRef& ec) {
+  Row r;
+  r["pid"] = std::to_string(ec->tgid);
+  ProcessConnectorUpdate(ec->tgid, r);
+  if (r.count("parent") == 0) {
+    // The process exited before it could be read.
+    return Status(0, "OK");
+  }
+
+  add(r);
+  return Status(0, "OK");
+}
 }
@@ -109,9 +109,11 @@ void parseSockAddr(const std::string& saddr, AuditFields& r) {
   }
 }
 
-bool SocketUpdate(size_t type, const AuditFields& fields, AuditFields& r) {
+bool SocketUpdate(size_t type,
+                  const AuditRecordFields& fields,
+                  AuditFields& r) {
   if (type == AUDIT_TYPE_SOCKADDR) {
-    const auto& saddr = fields.at("saddr");
+    auto saddr = fields.str(AUDIT_KEY_SADDR);
     if (saddr.size() < 4 || saddr[0] == '1') {
       return false;
     }
@@ -124,12 +126,12 @@ bool SocketUpdate(size_t type, const AuditFields& fields, AuditFields& r) {
     return true;
   }
 
-  r["pid"] = fields.at("pid");
-  r["path"] = decodeAuditValue(fields.at("exe"));
+  r["pid"] = fields.str(AUDIT_KEY_PID);
+  r["path"] = fields.decoded(AUDIT_KEY_EXE);
   // TODO: This is a hex value.
-  r["fd"] = fields.at("a0");
+  r["fd"] = fields.str("a0");
   // The open/bind success status.
-  r["success"] = (fields.at("success") == "yes") ? "1" : "0";
+  r["success"] = (fields.get(AUDIT_KEY_SUCCESS) == "yes") ? "1" : "0";
   r["uptime"] = std::to_string(tables::getUptime());
   return true;
 }
@@ -154,7 +156,8 @@ Status SocketEventSubscriber::init() {
 
 Status SocketEventSubscriber::Callback(const ECRef& ec, const SCRef&) {
   if (ec->syscall == AUDIT_SYSCALL_CONNECT) {
-    if (ec->fields.count("exit") && ec->fields.at("exit") != "-115") {
+    if (ec->fields.has(AUDIT_KEY_EXIT) &&
+        ec->fields.get(AUDIT_KEY_EXIT) != "-115") {
       // The connect syscall may want an exit with EINPROGRESS.
     }
   } else if (ec->type == AUDIT_TYPE_SYSCALL &&
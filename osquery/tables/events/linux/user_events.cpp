@@ -22,9 +22,6 @@ namespace tables {
 extern long getUptime();
 }
 
-// From process_events.
-extern std::string decodeAuditValue(const std::string& s);
-
 class UserEventSubscriber : public EventSubscriber<AuditEventPublisher> {
  public:
   /// The user event subscriber declares an audit event type subscription.
@@ -47,13 +44,13 @@ Status UserEventSubscriber::init() {
 
 Status UserEventSubscriber::Callback(const ECRef& ec, const SCRef& sc) {
   Row r;
-  r["uid"] = ec->fields["uid"];
-  r["pid"] = ec->fields["pid"];
-  r["message"] = ec->fields["msg"];
+  r["uid"] = ec->fields.str(AUDIT_KEY_UID);
+  r["pid"] = ec->fields.str(AUDIT_KEY_PID);
+  r["message"] = ec->fields.str(AUDIT_KEY_MSG);
   r["type"] = INTEGER(ec->type);
-  r["path"] = decodeAuditValue(ec->fields["exe"]);
-  r["address"] = ec->fields["addr"];
-  r["terminal"] = ec->fields["terminal"];
+  r["path"] = ec->fields.decoded(AUDIT_KEY_EXE);
+  r["address"] = ec->fields.str(AUDIT_KEY_ADDR);
+  r["terminal"] = ec->fields.str(AUDIT_KEY_TERMINAL);
   r["uptime"] = INTEGER(tables::getUptime());
 
   add(r);
@@ -271,14 +271,14 @@ MultiHashes hashInode(TskFsFile* file) {
     return MultiHashes();
   }
 
-  // Set a maximum 'chunk' or block size to 1 page or the file size.
+  // Set a maximum 'chunk' or block size to 64k or the file size.
   TSK_OFF_T size = meta->getSize();
   if (size == 0) {
     return MultiHashes();
   }
 
   // Allocate some heap memory and iterate over reading a chunk and updating.
-  auto buffer_size = (size < 4096) ? size : 4096;
+  auto buffer_size = (size < 65536) ? size : 65536;
   auto* buffer = (char*)malloc(buffer_size * sizeof(char));
   if (buffer != nullptr) {
     ssize_t chunk_size = 0;
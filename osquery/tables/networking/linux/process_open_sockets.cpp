@@ -9,12 +9,21 @@
  */
 
 #include <arpa/inet.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <linux/sock_diag.h>
+#include <linux/unix_diag.h>
+#include <sys/socket.h>
+#include <unistd.h>
 
 #include <osquery/core.h>
 #include <osquery/filesystem.h>
+#include <osquery/logger.h>
 #include <osquery/tables.h>
 
 #include "osquery/core/conversions.h"
+#include "osquery/tables/networking/linux/inet_diag.h"
+#include "osquery/tables/networking/linux/sockets.h"
 
 namespace osquery {
 namespace tables {
@@ -28,8 +37,20 @@ const std::map<int, std::string> kLinuxProtocolNames = {
     {IPPROTO_RAW, "raw"},
 };
 
-// A map of socket handles (inodes) to their pid and file descriptor.
-typedef std::map<std::string, std::pair<std::string, std::string> > InodeMap;
+/// Size of the receive buffer for sock_diag dump messages.
+const size_t kSockDiagBufferSize = 32 * 1024;
+
+/// Socket handle to descriptor and process ownership, -1 if unknown.
+static inline void setSocketOwner(const InodeMap& inodes, Row& r) {
+  auto owner = inodes.find(r["socket"]);
+  if (owner != inodes.end()) {
+    r["pid"] = owner->second.second;
+    r["fd"] = owner->second.first;
+  } else {
+    r["pid"] = "-1";
+    r["fd"] = "-1";
+  }
+}
 
 std::string addressFromHex(const std::string &encoded_address, int family) {
   char addr_buffer[INET6_ADDRSTRLEN] = {0};
@@ -66,6 +87,7 @@ unsigned short portFromHex(const std::string &encoded_port) {
 void genSocketsFromProc(const InodeMap &inodes,
                         int protocol,
                         int family,
+                        uint32_t states,
                         QueryData &results) {
   std::string path = "/proc/net/";
   if (family == AF_UNIX) {
@@ -122,6 +144,14 @@ void genSocketsFromProc(const InodeMap &inodes,
         continue;
       }
 
+      // The proc interface cannot filter, apply the state mask per line.
+      unsigned long state = 0;
+      if (states != kSocketStatesAll &&
+          (!safeStrtoul(fields[3], 16, state) || state >= 32 ||
+           (states & (1U << state)) == 0)) {
+        continue;
+      }
+
       r["socket"] = fields[9];
       r["family"] = INTEGER(family);
       r["protocol"] = INTEGER(protocol);
@@ -133,31 +163,196 @@ void genSocketsFromProc(const InodeMap &inodes,
       r["path"] = "";
     }
 
-    if (inodes.count(r["socket"]) > 0) {
-      r["pid"] = inodes.at(r["socket"]).second;
-      r["fd"] = inodes.at(r["socket"]).first;
-    } else {
-      r["pid"] = "-1";
-      r["fd"] = "-1";
+    setSocketOwner(inodes, r);
+    results.push_back(r);
+  }
+}
+
+/**
+ * @brief Send a sock_diag dump request and walk each response message.
+ *
+ * The predicate is called with the payload of each message in the dump. A
+ * failure status means the kernel does not support the request, the caller
+ * should discard any partial results and use the proc interface.
+ */
+static Status sockDiagDump(
+    void *request,
+    size_t size,
+    std::function<void(const struct nlmsghdr *)> predicate) {
+  int fd = socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC, NETLINK_SOCK_DIAG);
+  if (fd < 0) {
+    return Status(1, "Cannot open NETLINK_SOCK_DIAG socket");
+  }
+
+  struct sockaddr_nl nladdr;
+  memset(&nladdr, 0, sizeof(nladdr));
+  nladdr.nl_family = AF_NETLINK;
+
+  struct iovec iov = {request, size};
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_name = &nladdr;
+  msg.msg_namelen = sizeof(nladdr);
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+
+  if (sendmsg(fd, &msg, 0) < 0) {
+    close(fd);
+    return Status(1, "Cannot send sock_diag request");
+  }
+
+  // Each dump is read into a single reusable buffer, rows are built in place.
+  std::vector<char> buffer(kSockDiagBufferSize);
+  while (true) {
+    auto length = recv(fd, buffer.data(), buffer.size(), 0);
+    if (length < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      close(fd);
+      return Status(1, "Cannot receive sock_diag response");
+    } else if (length == 0) {
+      break;
     }
 
-    results.push_back(r);
+    auto header = reinterpret_cast<const struct nlmsghdr *>(buffer.data());
+    for (; NLMSG_OK(header, length); header = NLMSG_NEXT(header, length)) {
+      if (header->nlmsg_type == NLMSG_DONE) {
+        close(fd);
+        return Status(0, "OK");
+      } else if (header->nlmsg_type == NLMSG_ERROR) {
+        // The family or protocol is not supported by sock_diag.
+        close(fd);
+        return Status(1, "Unsupported sock_diag request");
+      }
+      predicate(header);
+    }
   }
+
+  close(fd);
+  return Status(0, "OK");
 }
 
-QueryData genOpenSockets(QueryContext &context) {
-  QueryData results;
+static Status genSocketsFromNetlink(const InodeMap &inodes,
+                                    int protocol,
+                                    int family,
+                                    uint32_t states,
+                                    QueryData &results) {
+  struct {
+    struct nlmsghdr header;
+    struct inet_diag_req_v2 request;
+  } request;
 
-  // If a pid is given then set that as the only item in processes.
-  std::set<std::string> pids;
-  if (context.constraints["pid"].exists(EQUALS)) {
-    pids = context.constraints["pid"].getAll(EQUALS);
-  } else {
-    osquery::procProcesses(pids);
+  memset(&request, 0, sizeof(request));
+  request.header.nlmsg_len = sizeof(request);
+  request.header.nlmsg_type = SOCK_DIAG_BY_FAMILY;
+  request.header.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+  request.request.sdiag_family = static_cast<__u8>(family);
+  request.request.sdiag_protocol = static_cast<__u8>(protocol);
+  request.request.idiag_states = states;
+  if (protocol == IPPROTO_RAW) {
+    // The raw_diag handler reads the raw protocol from the padding.
+    request.request.pad = IPPROTO_RAW;
   }
 
-  // Generate a map of socket inode to process tid.
-  InodeMap socket_inodes;
+  QueryData sockets;
+  auto status = sockDiagDump(
+      &request, sizeof(request), [&](const struct nlmsghdr *header) {
+        if (header->nlmsg_len < NLMSG_LENGTH(sizeof(struct inet_diag_msg))) {
+          return;
+        }
+
+        auto diag =
+            reinterpret_cast<const struct inet_diag_msg *>(NLMSG_DATA(header));
+        char local[INET6_ADDRSTRLEN] = {0};
+        char remote[INET6_ADDRSTRLEN] = {0};
+        inet_ntop(family, diag->id.idiag_src, local, sizeof(local));
+        inet_ntop(family, diag->id.idiag_dst, remote, sizeof(remote));
+
+        Row r;
+        r["socket"] = BIGINT(diag->idiag_inode);
+        r["family"] = INTEGER(family);
+        r["protocol"] = INTEGER(protocol);
+        r["local_address"] = local;
+        r["local_port"] = INTEGER(ntohs(diag->id.idiag_sport));
+        r["remote_address"] = remote;
+        r["remote_port"] = INTEGER(ntohs(diag->id.idiag_dport));
+        // Path is only used for UNIX domain sockets.
+        r["path"] = "";
+        setSocketOwner(inodes, r);
+        sockets.push_back(std::move(r));
+      });
+
+  if (status.ok()) {
+    results.insert(results.end(),
+                   std::make_move_iterator(sockets.begin()),
+                   std::make_move_iterator(sockets.end()));
+  }
+  return status;
+}
+
+static Status genUnixSocketsFromNetlink(const InodeMap &inodes,
+                                        QueryData &results) {
+  struct {
+    struct nlmsghdr header;
+    struct unix_diag_req request;
+  } request;
+
+  memset(&request, 0, sizeof(request));
+  request.header.nlmsg_len = sizeof(request);
+  request.header.nlmsg_type = SOCK_DIAG_BY_FAMILY;
+  request.header.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+  request.request.sdiag_family = AF_UNIX;
+  request.request.udiag_states = kSocketStatesAll;
+  request.request.udiag_show = UDIAG_SHOW_NAME;
+
+  QueryData sockets;
+  auto status = sockDiagDump(
+      &request, sizeof(request), [&](const struct nlmsghdr *header) {
+        if (header->nlmsg_len < NLMSG_LENGTH(sizeof(struct unix_diag_msg))) {
+          return;
+        }
+
+        auto diag =
+            reinterpret_cast<const struct unix_diag_msg *>(NLMSG_DATA(header));
+        Row r;
+        r["socket"] = BIGINT(diag->udiag_ino);
+        r["family"] = "0";
+        r["protocol"] = "0";
+        r["local_address"] = "";
+        r["local_port"] = "0";
+        r["remote_address"] = "";
+        r["remote_port"] = "0";
+        r["path"] = "";
+
+        // The bound name is an optional attribute following the message.
+        auto attr_length = static_cast<int>(header->nlmsg_len) -
+                           NLMSG_LENGTH(sizeof(struct unix_diag_msg));
+        auto attr = reinterpret_cast<const struct rtattr *>(diag + 1);
+        for (; RTA_OK(attr, attr_length); attr = RTA_NEXT(attr, attr_length)) {
+          if (attr->rta_type == UNIX_DIAG_NAME && RTA_PAYLOAD(attr) > 0) {
+            const char *name = static_cast<const char *>(RTA_DATA(attr));
+            r["path"] = std::string(name, RTA_PAYLOAD(attr));
+            if (name[0] == '\0') {
+              // Abstract names are displayed as they are in /proc/net/unix.
+              r["path"][0] = '@';
+            }
+          }
+        }
+
+        setSocketOwner(inodes, r);
+        sockets.push_back(std::move(r));
+      });
+
+  if (status.ok()) {
+    results.insert(results.end(),
+                   std::make_move_iterator(sockets.begin()),
+                   std::make_move_iterator(sockets.end()));
+  }
+  return status;
+}
+
+void genSocketInodes(const std::set<std::string> &pids, InodeMap &inodes) {
   for (const auto &process : pids) {
     std::map<std::string, std::string> descriptors;
     if (osquery::procDescriptors(process, descriptors).ok()) {
@@ -165,21 +360,57 @@ QueryData genOpenSockets(QueryContext &context) {
         if (fd.second.find("socket:[") == 0) {
           // See #792: std::regex is incomplete until GCC 4.9 (skip 8 chars)
           auto inode = fd.second.substr(8);
-          socket_inodes[inode.substr(0, inode.size() - 1)] =
+          inodes[inode.substr(0, inode.size() - 1)] =
               std::make_pair(fd.first, process);
         }
       }
     }
   }
+}
 
-  // This used to use netlink (Ref: #1094) to request socket information.
-  // Use proc messages to query socket information.
+void genInetSockets(const InodeMap &inodes,
+                    uint32_t states,
+                    QueryData &results) {
   for (const auto &protocol : kLinuxProtocolNames) {
-    genSocketsFromProc(socket_inodes, protocol.first, AF_INET, results);
-    genSocketsFromProc(socket_inodes, protocol.first, AF_INET6, results);
+    for (const auto &family : {AF_INET, AF_INET6}) {
+      auto status = genSocketsFromNetlink(
+          inodes, protocol.first, family, states, results);
+      if (!status.ok()) {
+        VLOG(1) << "Using /proc/net for " << protocol.second
+                << " sockets: " << status.getMessage();
+        genSocketsFromProc(inodes, protocol.first, family, states, results);
+      }
+    }
+  }
+}
+
+void genUnixSockets(const InodeMap &inodes, QueryData &results) {
+  if (!genUnixSocketsFromNetlink(inodes, results).ok()) {
+    genSocketsFromProc(inodes, IPPROTO_IP, AF_UNIX, kSocketStatesAll, results);
+  }
+}
+
+QueryData genOpenSockets(QueryContext &context) {
+  QueryData results;
+
+  // Generate a map of socket inode to process tid.
+  // If a pid is given then set that as the only item in processes, otherwise
+  // use the descriptor index shared with the other process tables.
+  InodeMap constrained_inodes;
+  std::shared_ptr<const ProcDescriptorIndex> index{nullptr};
+  if (context.constraints["pid"].exists(EQUALS)) {
+    genSocketInodes(context.constraints["pid"].getAll(EQUALS),
+                    constrained_inodes);
+  } else {
+    index = osquery::procDescriptorIndex();
   }
+  const auto& socket_inodes =
+      (index != nullptr) ? index->sockets : constrained_inodes;
 
-  genSocketsFromProc(socket_inodes, IPPROTO_IP, AF_UNIX, results);
+  // Request socket information using sock_diag (Ref: #1094), each family and
+  // protocol falls back to the proc interface if the kernel lacks support.
+  genInetSockets(socket_inodes, kSocketStatesAll, results);
+  genUnixSockets(socket_inodes, results);
   return results;
 }
 }
@@ -0,0 +1,57 @@
+/*
+ *  Copyright (c) 2014-present, Facebook, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+
+#pragma once
+
+#include <map>
+#include <set>
+#include <string>
+
+#include <osquery/tables.h>
+
+namespace osquery {
+namespace tables {
+
+// A map of socket handles (inodes) to their file descriptor and pid.
+typedef std::map<std::string, std::pair<std::string, std::string> > InodeMap;
+
+/// Request sockets in any TCP state (see netinet/tcp.h).
+const uint32_t kSocketStatesAll = 0xFFFFFFFF;
+
+/**
+ * @brief Request only bound sockets that may accept traffic.
+ *
+ * TCP sockets in LISTEN and unconnected datagram sockets, which the kernel
+ * reports in the CLOSE state.
+ */
+const uint32_t kSocketStatesListening = (1 << 10) | (1 << 7);
+
+/// Read the socket descriptors for a set of processes.
+void genSocketInodes(const std::set<std::string>& pids, InodeMap& inodes);
+
+/**
+ * @brief Generate a row for each IPv4/IPv6 socket in a set of states.
+ *
+ * The kernel is asked for sockets using NETLINK_SOCK_DIAG, filtering the
+ * states kernel-side. If sock_diag is unavailable for a family or protocol the
+ * /proc/net text interface is parsed and filtered instead.
+ *
+ * @param inodes Socket inode to descriptor and pid map for ownership.
+ * @param states A mask of (1 << TCP_STATE) socket states to include.
+ * @param results The output socket rows.
+ */
+void genInetSockets(const InodeMap& inodes,
+                    uint32_t states,
+                    QueryData& results);
+
+/// Generate a row for each UNIX domain socket, see genInetSockets.
+void genUnixSockets(const InodeMap& inodes, QueryData& results);
+}
+}
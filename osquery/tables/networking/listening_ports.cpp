@@ -8,9 +8,14 @@
  *
  */
 
+#include <osquery/filesystem.h>
 #include <osquery/sql.h>
 #include <osquery/tables.h>
 
+#ifdef __linux__
+#include "osquery/tables/networking/linux/sockets.h"
+#endif
+
 namespace osquery {
 namespace tables {
 
@@ -20,7 +25,14 @@ typedef std::map<std::string, std::vector<ProtoFamilyPair>> PortMap;
 QueryData genListeningPorts(QueryContext& context) {
   QueryData results;
 
+#ifdef __linux__
+  // Ask the kernel for bound sockets only, rather than every open socket.
+  QueryData sockets;
+  genInetSockets(
+      osquery::procDescriptorIndex()->sockets, kSocketStatesListening, sockets);
+#else
   auto sockets = SQL::selectAllFrom("process_open_sockets");
+#endif
 
   PortMap ports;
   for (const auto& socket : sockets) {
@@ -15,6 +15,7 @@
 #include <osquery/tables.h>
 #include <osquery/status.h>
 
+#include "osquery/filesystem/walker.h"
 #include "osquery/tables/other/yara_utils.h"
 
 #ifdef CONCAT
@@ -88,18 +89,19 @@ QueryData genYara(QueryContext& context) {
       LIKE,
       paths,
       ([&](const std::string& pattern, std::set<std::string>& out) {
-        std::vector<std::string> patterns;
-        auto status =
-            resolveFilePattern(pattern, patterns, GLOB_FILES | GLOB_NO_CANON);
-        if (status.ok()) {
-          for (const auto& resolved : patterns) {
-            // Check that each resolved path is readable.
-            if (isReadable(resolved)) {
-              paths.insert(resolved);
-            }
-          }
-        }
-        return status;
+        // Resolved paths are streamed from the walk, possibly concurrently.
+        Mutex paths_mutex;
+        return walkFilePattern(
+            pattern,
+            GLOB_FILES | GLOB_NO_CANON,
+            ([&paths, &paths_mutex](const WalkEntry& entry) {
+              // Check that each resolved path is readable.
+              if (isReadable(entry.path)) {
+                WriteLock lock(paths_mutex);
+                paths.insert(entry.path);
+              }
+              return true;
+            }));
       }));
 
   // Compile all sigfiles into a map.
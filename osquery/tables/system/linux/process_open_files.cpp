@@ -16,8 +16,9 @@
 namespace osquery {
 namespace tables {
 
+template <typename Descriptors>
 void genDescriptors(const std::string& process,
-                    const std::map<std::string, std::string>& descriptors,
+                    const Descriptors& descriptors,
                     QueryData& results) {
   for (const auto& fd : descriptors) {
     if (fd.second.find("socket:") != std::string::npos ||
@@ -40,14 +41,16 @@ void genDescriptors(const std::string& process,
 QueryData genOpenFiles(QueryContext& context) {
   QueryData results;
 
-  std::set<std::string> pids;
-  if (context.constraints["pid"].exists(EQUALS)) {
-    pids = context.constraints["pid"].getAll(EQUALS);
-  } else {
-    osquery::procProcesses(pids);
+  if (!context.constraints["pid"].exists(EQUALS)) {
+    // Use the descriptor index shared with the other process tables.
+    auto index = osquery::procDescriptorIndex();
+    for (const auto& process : index->descriptors) {
+      genDescriptors(process.first, process.second, results);
+    }
+    return results;
   }
 
-  for (const auto& process : pids) {
+  for (const auto& process : context.constraints["pid"].getAll(EQUALS)) {
     std::map<std::string, std::string> descriptors;
     if (osquery::procDescriptors(process, descriptors).ok()) {
       genDescriptors(process, descriptors, results);
@@ -18,7 +18,6 @@
 #include <boost/algorithm/string/predicate.hpp>
 #include <boost/algorithm/string/trim.hpp>
 #include <boost/noncopyable.hpp>
-#include <boost/regex.hpp>
 
 #include <osquery/core.h>
 #include <osquery/filesystem.h>
@@ -30,74 +29,32 @@
 namespace osquery {
 namespace tables {
 
-inline std::string getProcAttr(const std::string& attr,
-                               const std::string& pid) {
-  return "/proc/" + pid + "/" + attr;
-}
+inline std::string readProcCMDLine(const ProcessDirectory& proc) {
+  ProcView content;
+  if (!proc.read("cmdline", content).ok()) {
+    return "";
+  }
 
-inline std::string readProcCMDLine(const std::string& pid) {
-  auto attr = getProcAttr("cmdline", pid);
-
-  std::string content;
-  readFile(attr, content);
-  // Remove \0 delimiters.
-  std::replace_if(content.begin(),
-                  content.end(),
-                  [](const char& c) { return c == 0; },
-                  ' ');
-  // Remove trailing delimiter.
-  boost::algorithm::trim(content);
-  return content;
+  // Join the \0 delimited arguments with spaces.
+  std::string cmdline;
+  procTokens(content, ProcView("\0", 1), [&cmdline](ProcView arg) {
+    if (!cmdline.empty()) {
+      cmdline += ' ';
+    }
+    cmdline.append(arg.data(), arg.size());
+    return true;
+  });
+  return cmdline;
 }
 
-inline std::string readProcLink(const std::string& attr,
-                                const std::string& pid) {
+inline std::string readProcLink(const ProcessDirectory& proc,
+                                const char* attr) {
   // The exe is a symlink to the binary on-disk.
-  auto attr_path = getProcAttr(attr, pid);
-
   std::string result;
-  char link_path[PATH_MAX] = {0};
-  auto bytes = readlink(attr_path.c_str(), link_path, sizeof(link_path) - 1);
-  if (bytes >= 0) {
-    result = std::string(link_path);
-  }
-
+  proc.readLink(attr, result);
   return result;
 }
 
-// In the case where the linked binary path ends in " (deleted)", and a file
-// actually exists at that path, check whether the inode of that file matches
-// the inode of the mapped file in /proc/%pid/maps
-Status deletedMatchesInode(const std::string& path, const std::string& pid) {
-  const std::string maps_path = getProcAttr("maps", pid);
-  std::string maps_contents;
-  auto s = osquery::readFile(maps_path, maps_contents);
-  if (!s.ok()) {
-    return Status(-1, "Cannot read maps file: " + maps_path);
-  }
-
-  // Extract the expected inode of the binary file from /proc/%pid/maps
-  boost::smatch what;
-  boost::regex expression("([0-9]+)\\h+\\Q" + path + "\\E");
-  if (!boost::regex_search(maps_contents, what, expression)) {
-    return Status(-1, "Could not find binary inode in maps file: " + maps_path);
-  }
-  std::string inode = what[1];
-
-  // stat the file at the expected binary path
-  struct stat st;
-  if (stat(path.c_str(), &st) != 0) {
-    return Status(-1, "Error in stat of binary: " + path);
-  }
-
-  // If the inodes match, the binary name actually ends with " (deleted)"
-  if (std::to_string(st.st_ino) == inode) {
-    return Status(0, "Inodes match");
-  } else {
-    return Status(1, "Inodes do not match");
-  }
-}
-
 std::set<std::string> getProcList(const QueryContext& context) {
   std::set<std::string> pidlist;
   if (context.constraints.count("pid") > 0 &&
@@ -115,73 +72,81 @@ std::set<std::string> getProcList(const QueryContext& context) {
 }
 
 void genProcessEnvironment(const std::string& pid, QueryData& results) {
-  auto attr = getProcAttr("environ", pid);
-
-  std::string content;
-  readFile(attr, content);
-  const char* variable = content.c_str();
+  ProcessDirectory proc(pid);
+  ProcView content;
+  if (!proc.read("environ", content).ok()) {
+    return;
+  }
 
   // Stop at the end of nul-delimited string content.
-  while (*variable > 0) {
-    auto buf = std::string(variable);
-    size_t idx = buf.find_first_of("=");
+  while (!content.empty() && content[0] != '\0') {
+    auto variable = content.substr(0, content.find('\0'));
+    auto idx = variable.find('=');
 
     Row r;
     r["pid"] = pid;
-    r["key"] = buf.substr(0, idx);
-    r["value"] = buf.substr(idx + 1);
+    r["key"] = variable.substr(0, idx).to_string();
+    r["value"] = (idx != ProcView::npos) ? variable.substr(idx + 1).to_string()
+                                         : variable.to_string();
     results.push_back(r);
-    variable += buf.size() + 1;
+    content.remove_prefix(std::min(variable.size() + 1, content.size()));
   }
 }
 
 void genProcessMap(const std::string& pid, QueryData& results) {
-  auto map = getProcAttr("maps", pid);
+  ProcessDirectory proc(pid);
+  ProcView content;
+  if (!proc.read("maps", content).ok()) {
+    return;
+  }
+
+  procTokens(content, "\n", [&pid, &results](ProcView line) {
+    // Fields are: address perms offset dev inode [path].
+    ProcView fields[5];
+    size_t count = 0;
+    ProcView path;
+    procTokens(line, " ", [&](ProcView field) {
+      if (count < 5) {
+        fields[count++] = field;
+        return true;
+      }
+      // The path is the remainder of the line, and may include spaces.
+      path = line.substr(field.data() - line.data());
+      return false;
+    });
 
-  std::string content;
-  readFile(map, content);
-  for (auto& line : osquery::split(content, "\n")) {
-    auto fields = osquery::split(line, " ");
     // If can't read address, not sure.
-    if (fields.size() < 5) {
-      continue;
+    if (count < 5) {
+      return true;
     }
 
     Row r;
     r["pid"] = pid;
-    if (!fields[0].empty()) {
-      auto addresses = osquery::split(fields[0], "-");
-      if (addresses.size() >= 2) {
-        r["start"] = "0x" + addresses[0];
-        r["end"] = "0x" + addresses[1];
-      } else {
-        // Problem with the address format.
-        continue;
-      }
+    auto dash = fields[0].find('-');
+    if (dash == ProcView::npos) {
+      // Problem with the address format.
+      return true;
     }
+    r["start"] = "0x" + fields[0].substr(0, dash).to_string();
+    r["end"] = "0x" + fields[0].substr(dash + 1).to_string();
 
-    r["permissions"] = fields[1];
+    r["permissions"] = fields[1].to_string();
     try {
-      auto offset = std::stoll(fields[2], nullptr, 16);
+      auto offset = std::stoll(fields[2].to_string(), nullptr, 16);
       r["offset"] = (offset != 0) ? BIGINT(offset) : r["start"];
-
     } catch (const std::exception& e) {
       // Value was out of range or could not be interpreted as a hex long long.
       r["offset"] = "-1";
     }
-    r["device"] = fields[3];
-    r["inode"] = fields[4];
-
-    // Path name must be trimmed.
-    if (fields.size() > 5) {
-      boost::trim(fields[5]);
-      r["path"] = fields[5];
-    }
+    r["device"] = fields[3].to_string();
+    r["inode"] = fields[4].to_string();
+    r["path"] = path.to_string();
 
     // BSS with name in pathname.
-    r["pseudo"] = (fields[4] == "0" && !r["path"].empty()) ? "1" : "0";
+    r["pseudo"] = (fields[4] == "0" && !path.empty()) ? "1" : "0";
     results.push_back(std::move(r));
-  }
+    return true;
+  });
 }
 
 struct SimpleProcStat : private boost::noncopyable {
@@ -208,77 +173,99 @@ struct SimpleProcStat : private boost::noncopyable {
   std::string system_time;
   std::string start_time;
 
-  explicit SimpleProcStat(const std::string& pid);
+  explicit SimpleProcStat(const ProcessDirectory& proc);
 };
 
-SimpleProcStat::SimpleProcStat(const std::string& pid) {
-  std::string content;
-  if (readFile(getProcAttr("stat", pid), content).ok()) {
-    auto start = content.find_last_of(")");
-    // Start parsing stats from ") <MODE>..."
-    if (start == std::string::npos || content.size() <= start + 2) {
-      return;
-    }
-
-    auto details = osquery::split(content.substr(start + 2), " ");
-    if (details.size() <= 19) {
-      return;
-    }
+/// Remove a " kB" suffix from a status memory value, and scale to bytes.
+static std::string procStatusBytes(ProcView value) {
+  if (value.ends_with(" kB")) {
+    value.remove_suffix(3);
+  }
+  // Memory is reported in kB.
+  return value.to_string() + "000";
+}
 
-    this->state = details.at(0);
-    this->parent = details.at(1);
-    this->group = details.at(2);
-    this->user_time = details.at(11);
-    this->system_time = details.at(12);
-    this->nice = details.at(16);
-    this->threads = details.at(17);
-    try {
-      this->start_time = TEXT(AS_LITERAL(BIGINT_LITERAL, details.at(19)) / 100);
-    } catch (const boost::bad_lexical_cast& e) {
-      this->start_time = "-1";
+SimpleProcStat::SimpleProcStat(const ProcessDirectory& proc) {
+  ProcView content;
+  if (proc.read("stat", content).ok()) {
+    auto start = content.rfind(')');
+    // Start parsing stats from ") <MODE>..."
+    if (start != ProcView::npos && content.size() > start + 2) {
+      ProcView details[20];
+      size_t count = 0;
+      procTokens(content.substr(start + 2), " ", [&](ProcView detail) {
+        details[count++] = detail;
+        return count < 20;
+      });
+
+      if (count == 20) {
+        this->state = details[0].to_string();
+        this->parent = details[1].to_string();
+        this->group = details[2].to_string();
+        this->user_time = details[11].to_string();
+        this->system_time = details[12].to_string();
+        this->nice = details[16].to_string();
+        this->threads = details[17].to_string();
+        try {
+          this->start_time = TEXT(
+              AS_LITERAL(BIGINT_LITERAL, details[19].to_string()) / 100);
+        } catch (const boost::bad_lexical_cast& e) {
+          this->start_time = "-1";
+        }
+      }
     }
   }
 
   // /proc/N/status may be not available, or readable by this user.
-  if (!readFile(getProcAttr("status", pid), content).ok()) {
+  if (!proc.read("status", content).ok()) {
     return;
   }
 
-  for (const auto& line : osquery::split(content, "\n")) {
+  procTokens(content, "\n", [this](ProcView line) {
     // Status lines are formatted: Key: Value....\n.
-    auto detail = osquery::split(line, ":", 1);
-    if (detail.size() != 2) {
-      continue;
+    auto colon = line.find(':');
+    if (colon == ProcView::npos) {
+      return true;
+    }
+
+    auto key = line.substr(0, colon);
+    // The value is trimmed of whitespace.
+    ProcView value;
+    procTokens(line.substr(colon + 1), "\n", [&value](ProcView token) {
+      value = token;
+      return false;
+    });
+    if (value.empty()) {
+      return true;
     }
 
     // There are specific fields from each detail.
-    if (detail.at(0) == "Name") {
-      this->name = detail.at(1);
-    } else if (detail.at(0) == "VmRSS") {
-      detail[1].erase(detail.at(1).end() - 3, detail.at(1).end());
-      // Memory is reported in kB.
-      this->resident_size = detail.at(1) + "000";
-    } else if (detail.at(0) == "VmSize") {
-      detail[1].erase(detail.at(1).end() - 3, detail.at(1).end());
-      // Memory is reported in kB.
-      this->total_size = detail.at(1) + "000";
-    } else if (detail.at(0) == "Gid") {
-      // Format is: R E - -
-      auto gid_detail = osquery::split(detail.at(1), "\t");
-      if (gid_detail.size() == 4) {
-        this->real_gid = gid_detail.at(0);
-        this->effective_gid = gid_detail.at(1);
-        this->saved_gid = gid_detail.at(2);
-      }
-    } else if (detail.at(0) == "Uid") {
-      auto uid_detail = osquery::split(detail.at(1), "\t");
-      if (uid_detail.size() == 4) {
-        this->real_uid = uid_detail.at(0);
-        this->effective_uid = uid_detail.at(1);
-        this->saved_uid = uid_detail.at(2);
+    if (key == "Name") {
+      this->name = value.to_string();
+    } else if (key == "VmRSS") {
+      this->resident_size = procStatusBytes(value);
+    } else if (key == "VmSize") {
+      this->total_size = procStatusBytes(value);
+    } else if (key == "Gid" || key == "Uid") {
+      // Format is: R E S F
+      ProcView ids[4];
+      size_t count = 0;
+      procTokens(value, "\t", [&ids, &count](ProcView id) {
+        ids[count++] = id;
+        return count < 4;
+      });
+      if (count == 4 && key == "Gid") {
+        this->real_gid = ids[0].to_string();
+        this->effective_gid = ids[1].to_string();
+        this->saved_gid = ids[2].to_string();
+      } else if (count == 4) {
+        this->real_uid = ids[0].to_string();
+        this->effective_uid = ids[1].to_string();
+        this->saved_uid = ids[2].to_string();
       }
     }
-  }
+    return true;
+  });
 }
 
 /**
@@ -290,12 +277,16 @@ SimpleProcStat::SimpleProcStat(const std::string& pid) {
  * executable is available and the file does NOT exist on disk, set on_disk
  * to 0.
  *
- * @param pid The string (because we're referencing file path) pid.
+ * A process running a deleted binary has an exe link ending in " (deleted)".
+ * A file may exist with that name, see #1607, which is the running binary
+ * only if it has the device and inode of the executable the link references.
+ *
+ * @param proc The open process directory.
  * @param path A mutable string found from /proc/N/exe. If this is found
  *             to contain the (deleted) suffix, it will be removed.
  * @return A tristate -1 error, 1 yes, 0 nope.
  */
-int getOnDisk(const std::string& pid, std::string& path) {
+int getOnDisk(const ProcessDirectory& proc, std::string& path) {
   if (path.empty()) {
     return -1;
   }
@@ -306,50 +297,51 @@ int getOnDisk(const std::string& pid, std::string& path) {
     return (osquery::pathExists(path)) ? 1 : 0;
   }
 
-  if (!osquery::pathExists(path)) {
+  struct stat file_info;
+  if (stat(path.c_str(), &file_info) != 0) {
     // No file exists with the path including " (deleted)", so we can strip
     // this from the path and set on_disk = 0
     path.erase(path.size() - kDeletedString.size());
     return 0;
   }
 
-  // Special case in which we have to check the inode to see whether the
-  // process is actually running from a binary file ending with
-  // " (deleted)". See #1607
-  std::string maps_contents;
-  Status deleted = deletedMatchesInode(path, pid);
-  if (deleted.getCode() == -1) {
-    LOG(ERROR) << deleted.getMessage();
+  struct stat exe_info;
+  if (!proc.stat("exe", exe_info).ok()) {
+    LOG(ERROR) << "Cannot stat the executable of process binary: " << path;
     return -1;
-  } else if (deleted.getCode() == 0) {
+  }
+
+  if (file_info.st_dev == exe_info.st_dev &&
+      file_info.st_ino == exe_info.st_ino) {
     // The process is actually running from a binary ending with
     // " (deleted)"
     return 1;
-  } else {
-    // There is a collision with a file name ending in " (deleted)", but
-    // that file is not the binary for this process
-    path.erase(path.size() - kDeletedString.size());
-    return 0;
   }
+
+  // There is a collision with a file name ending in " (deleted)", but
+  // that file is not the binary for this process
+  path.erase(path.size() - kDeletedString.size());
+  return 0;
 }
 
 void genProcess(const std::string& pid, QueryData& results) {
   // Parse the process stat and status.
-  SimpleProcStat proc_stat(pid);
+  ProcessDirectory proc(pid);
+  SimpleProcStat proc_stat(proc);
 
   Row r;
   r["pid"] = pid;
   r["parent"] = proc_stat.parent;
-  r["path"] = readProcLink("exe", pid);
+  r["path"] = readProcLink(proc, "exe");
   r["name"] = proc_stat.name;
   r["pgroup"] = proc_stat.group;
   r["state"] = proc_stat.state;
   r["nice"] = proc_stat.nice;
   r["threads"] = proc_stat.threads;
   // Read/parse cmdline arguments.
-  r["cmdline"] = readProcCMDLine(pid);
-  r["cwd"] = readProcLink("cwd", pid);
-  r["root"] = readProcLink("root", pid);
+  r["cmdline"] = readProcCMDLine(proc);
+  r["cwd"] = readProcLink(proc, "cwd");
+  r["root"] = readProcLink(proc, "root");
   r["uid"] = proc_stat.real_uid;
   r["euid"] = proc_stat.effective_uid;
   r["suid"] = proc_stat.saved_uid;
@@ -357,7 +349,7 @@ void genProcess(const std::string& pid, QueryData& results) {
   r["egid"] = proc_stat.effective_gid;
   r["sgid"] = proc_stat.saved_gid;
 
-  r["on_disk"] = INTEGER(getOnDisk(pid, r["path"]));
+  r["on_disk"] = INTEGER(getOnDisk(proc, r["path"]));
 
   // size/memory information
   r["wired_size"] = "0"; // No support for unpagable counters in linux.
@@ -373,36 +365,19 @@ void genProcess(const std::string& pid, QueryData& results) {
 }
 
 QueryData genProcesses(QueryContext& context) {
-  QueryData results;
-
   auto pidlist = getProcList(context);
-  for (const auto& pid : pidlist) {
-    genProcess(pid, results);
-  }
-
-  return results;
+  return parallelGenerate({pidlist.begin(), pidlist.end()}, genProcess);
 }
 
 QueryData genProcessEnvs(QueryContext& context) {
-  QueryData results;
-
   auto pidlist = getProcList(context);
-  for (const auto& pid : pidlist) {
-    genProcessEnvironment(pid, results);
-  }
-
-  return results;
+  return parallelGenerate({pidlist.begin(), pidlist.end()},
+                          genProcessEnvironment);
 }
 
 QueryData genProcessMemoryMap(QueryContext& context) {
-  QueryData results;
-
   auto pidlist = getProcList(context);
-  for (const auto& pid : pidlist) {
-    genProcessMap(pid, results);
-  }
-
-  return results;
+  return parallelGenerate({pidlist.begin(), pidlist.end()}, genProcessMap);
 }
 }
 }
@@ -12,13 +12,13 @@
 #include <grp.h>
 #include <sys/stat.h>
 
-#include <boost/filesystem.hpp>
+#include <boost/lexical_cast.hpp>
 
 #include <osquery/filesystem.h>
 #include <osquery/logger.h>
 #include <osquery/tables.h>
 
-namespace fs = boost::filesystem;
+#include "osquery/filesystem/walker.h"
 
 namespace osquery {
 namespace tables {
@@ -28,16 +28,12 @@ std::vector<std::string> kBinarySearchPaths = {
     "/usr/local/bin", "/usr/local/sbin", "/tmp",
 };
 
-Status genBin(const fs::path& path, int perms, QueryData& results) {
-  struct stat info;
-  // store user and group
-  if (stat(path.c_str(), &info) != 0) {
-    return Status(1, "stat failed");
-  }
-
+Status genBin(const std::string& path,
+              const struct stat& info,
+              QueryData& results) {
   // store path
   Row r;
-  r["path"] = path.string();
+  r["path"] = path;
   struct passwd* pw = getpwuid(info.st_uid);
   struct group* gr = getgrgid(info.st_gid);
 
@@ -60,11 +56,11 @@ Status genBin(const fs::path& path, int perms, QueryData& results) {
   r["groupname"] = group;
 
   r["permissions"] = "";
-  if ((perms & 04000) == 04000) {
+  if ((info.st_mode & 04000) == 04000) {
     r["permissions"] += "S";
   }
 
-  if ((perms & 02000) == 02000) {
+  if ((info.st_mode & 02000) == 02000) {
     r["permissions"] += "G";
   }
 
@@ -72,61 +68,42 @@ Status genBin(const fs::path& path, int perms, QueryData& results) {
   return Status(0, "OK");
 }
 
-bool isSuidBin(const fs::path& path, int perms) {
-  if (!fs::is_regular_file(path)) {
+bool isSuidBin(const struct stat& info) {
+  if (!S_ISREG(info.st_mode)) {
     return false;
   }
 
-  if ((perms & 04000) == 04000 || (perms & 02000) == 02000) {
+  if ((info.st_mode & 04000) == 04000 || (info.st_mode & 02000) == 02000) {
     return true;
   }
   return false;
 }
 
-void genSuidBinsFromPath(const std::string& path, QueryData& results) {
-  if (!pathExists(path).ok()) {
-    // Creating an iterator on a missing path will except.
-    return;
-  }
-
-  auto it = fs::recursive_directory_iterator(fs::path(path));
-  fs::recursive_directory_iterator end;
-  while (it != end) {
-    fs::path subpath = *it;
-    try {
-      // Do not traverse symlinked directories.
-      if (fs::is_directory(subpath) && fs::is_symlink(subpath)) {
-        it.no_push();
-      }
-
-      int perms = it.status().permissions();
-      if (isSuidBin(subpath, perms)) {
-        // Only emit suid bins.
-        genBin(subpath, perms, results);
-      }
-
-      ++it;
-    } catch (fs::filesystem_error& e) {
-      VLOG(1) << "Cannot read binary from " << subpath;
-      it.no_push();
-      // Try to recover, otherwise break.
-      try {
-        ++it;
-      } catch (fs::filesystem_error& e) {
-        break;
-      }
-    }
-  }
-}
-
 QueryData genSuidBin(QueryContext& context) {
   QueryData results;
+  Mutex results_mutex;
+
+  // The search paths are walked together, symlinked directories are not
+  // traversed but symlinks to suid binaries are reported.
+  DirectoryWalker walker;
+  walker.walk(kBinarySearchPaths,
+              ([&results, &results_mutex](const WalkEntry& entry) {
+                auto info = entry.info;
+                if (S_ISLNK(info.st_mode) &&
+                    stat(entry.path.c_str(), &info) != 0) {
+                  VLOG(1) << "Cannot read binary from " << entry.path;
+                  return true;
+                }
+
+                if (isSuidBin(info)) {
+                  // Only emit suid bins, getpwuid is not reentrant.
+                  WriteLock lock(results_mutex);
+                  genBin(entry.path, info, results);
+                }
+                return true;
+              }));
 
   // Todo: add hidden column to select on that triggers non-std path searches.
-  for (const auto& path : kBinarySearchPaths) {
-    genSuidBinsFromPath(path, results);
-  }
-
   return results;
 }
 }
@@ -16,6 +16,8 @@
 #include <osquery/logger.h>
 #include <osquery/tables.h>
 
+#include "osquery/filesystem/walker.h"
+
 namespace fs = boost::filesystem;
 
 namespace osquery {
@@ -145,15 +147,16 @@ QueryData genFile(QueryContext& context) {
       continue;
     }
 
-    try {
-      // Iterate over the directory and generate info for each regular file.
-      fs::directory_iterator begin(directory_string), end;
-      for (; begin != end; ++begin) {
-        genFileInfo(begin->path(), directory_string, "", results);
-      }
-    } catch (const fs::filesystem_error& /* e */) {
-      continue;
-    }
+    // Iterate over the directory and generate info for each entry.
+    WalkOptions options;
+    options.max_depth = 1;
+    options.threads = 1;
+    DirectoryWalker walker(options);
+    walker.walk({directory_string},
+                ([&directory_string, &results](const WalkEntry& entry) {
+                  genFileInfo(entry.path, directory_string, "", results);
+                  return true;
+                }));
   }
 
   return results;
@@ -14,36 +14,105 @@
 #include <osquery/hash.h>
 #include <osquery/tables.h>
 
+#include "osquery/filesystem/walker.h"
+
 namespace fs = boost::filesystem;
 
 namespace osquery {
 namespace tables {
 
-void genHashForFile(const std::string& path,
-                    const std::string& dir,
-                    QueryContext& context,
-                    QueryData& results) {
+/// Files to hash, and the directory column of each, for a single query.
+struct HashTargets {
+  std::vector<std::string> paths;
+  std::vector<std::string> directories;
+
+  void add(const std::string& path, const std::string& dir) {
+    paths.push_back(path);
+    directories.push_back(dir);
+  }
+};
+
+/// Digest columns and their hash types.
+const std::vector<std::pair<std::string, HashType>> kHashColumns = {
+    {"md5", HASH_TYPE_MD5},
+    {"sha1", HASH_TYPE_SHA1},
+    {"sha256", HASH_TYPE_SHA256},
+};
+
+/// Check if a cached row includes every requested digest.
+static bool isHashCached(QueryContext& context,
+                         const std::string& path,
+                         int mask) {
+  if (!context.isCached(path)) {
+    return false;
+  }
+
+  const auto& r = context.getCache(path);
+  for (const auto& column : kHashColumns) {
+    if ((mask & column.second) && r.count(column.first) == 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void genHashForFiles(const HashTargets& targets,
+                     QueryContext& context,
+                     QueryData& results) {
+  // Only compute the digests the query reads.
+  int mask = 0;
+  for (const auto& column : kHashColumns) {
+    if (context.isColumnUsed(column.first)) {
+      mask |= column.second;
+    }
+  }
+
+  // Uncached files are hashed together, concurrently.
+  std::vector<std::string> uncached;
+  for (const auto& path : targets.paths) {
+    if (!isHashCached(context, path, mask)) {
+      uncached.push_back(path);
+    }
+  }
+  auto hashes = (mask != 0) ? hashMultiFromFiles(mask, uncached)
+                            : std::vector<MultiHashes>(
+                                  uncached.size(), MultiHashes{0, "", "", ""});
+
   // Must provide the path, filename, directory separate from boost path->string
   // helpers to match any explicit (query-parsed) predicate constraints.
-  Row r;
-  if (context.isCached(path)) {
-    r = context.getCache(path);
-  } else {
-    auto hashes = hashMultiFromFile(
-        HASH_TYPE_MD5 | HASH_TYPE_SHA1 | HASH_TYPE_SHA256, path);
-
-    r["path"] = path;
-    r["directory"] = dir;
-    r["md5"] = std::move(hashes.md5);
-    r["sha1"] = std::move(hashes.sha1);
-    r["sha256"] = std::move(hashes.sha256);
-    context.setCache(path, r);
+  for (size_t i = 0, hashed = 0; i < targets.paths.size(); i++) {
+    const auto& path = targets.paths[i];
+    Row r;
+    if (hashed < uncached.size() && uncached[hashed] == path) {
+      auto& hash = hashes[hashed++];
+      if (hash.mask != mask) {
+        // The query's byte budget was exhausted.
+        continue;
+      }
+      r["path"] = path;
+      r["directory"] = targets.directories[i];
+      if (mask & HASH_TYPE_MD5) {
+        r["md5"] = std::move(hash.md5);
+      }
+      if (mask & HASH_TYPE_SHA1) {
+        r["sha1"] = std::move(hash.sha1);
+      }
+      if (mask & HASH_TYPE_SHA256) {
+        r["sha256"] = std::move(hash.sha256);
+      }
+      context.setCache(path, r);
+    } else if (context.isCached(path)) {
+      r = context.getCache(path);
+    } else {
+      continue;
+    }
+    results.push_back(r);
   }
-  results.push_back(r);
 }
 
 QueryData genHash(QueryContext& context) {
   QueryData results;
+  HashTargets targets;
   boost::system::error_code ec;
 
   // The query must provide a predicate with constraints including path or
@@ -73,7 +142,7 @@ QueryData genHash(QueryContext& context) {
       continue;
     }
 
-    genHashForFile(path_string, path.parent_path().string(), context, results);
+    targets.add(path_string, path.parent_path().string());
   }
 
   // Now loop through constraints using the directory column constraint.
@@ -102,16 +171,22 @@ QueryData genHash(QueryContext& context) {
     }
 
     // Iterate over the directory files and generate a hash for each regular
-    // file.
-    boost::filesystem::directory_iterator begin(directory), end;
-    for (; begin != end; ++begin) {
-      if (boost::filesystem::is_regular_file(begin->path(), ec)) {
-        genHashForFile(
-            begin->path().string(), directory_string, context, results);
-      }
-    }
+    // file, or symlink to a regular file.
+    WalkOptions options;
+    options.max_depth = 1;
+    options.threads = 1;
+    DirectoryWalker walker(options);
+    walker.walk({directory_string}, ([&](const WalkEntry& entry) {
+                  if (entry.isRegularFile() ||
+                      (S_ISLNK(entry.info.st_mode) &&
+                       boost::filesystem::is_regular_file(entry.path, ec))) {
+                    targets.add(entry.path, directory_string);
+                  }
+                  return true;
+                }));
   }
 
+  genHashForFiles(targets, context, results);
   return results;
 }
 }
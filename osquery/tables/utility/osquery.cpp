@@ -10,6 +10,7 @@
 
 #include <osquery/config.h>
 #include <osquery/core.h>
+#include <osquery/database.h>
 #include <osquery/events.h>
 #include <osquery/extensions.h>
 #include <osquery/filesystem.h>
@@ -21,6 +22,8 @@
 #include <osquery/system.h>
 #include <osquery/tables.h>
 
+#include "osquery/config/parsers/decorators.h"
+#include "osquery/core/conversions.h"
 #include "osquery/core/process.h"
 
 namespace osquery {
@@ -45,11 +48,20 @@ QueryData genOsqueryEvents(QueryContext& context) {
       r["subscriptions"] = INTEGER(pubref->numSubscriptions());
       r["events"] = INTEGER(pubref->numEvents());
       r["refreshes"] = INTEGER(pubref->restartCount());
-      r["active"] = (pubref->hasStarted() && !pubref->isEnding()) ? "1" : "0";
+      r["overflows"] = INTEGER(pubref->overflowCount());
+      r["coalesced"] = INTEGER(pubref->coalescedCount());
+      r["events_per_second"] = INTEGER(pubref->eventsPerSecond());
+      r["active"] = ((pubref->hasStarted() || pubref->hasReactor()) &&
+                     !pubref->isEnding())
+                        ? "1"
+                        : "0";
     } else {
       r["subscriptions"] = "0";
       r["events"] = "0";
       r["refreshes"] = "0";
+      r["overflows"] = "0";
+      r["coalesced"] = "0";
+      r["events_per_second"] = "0";
       r["active"] = "-1";
     }
     results.push_back(r);
@@ -60,8 +72,11 @@ QueryData genOsqueryEvents(QueryContext& context) {
     Row r;
     r["name"] = subscriber;
     r["type"] = "subscriber";
-    // Subscribers will never 'restart'.
+    // Subscribers will never 'restart', overflow, or coalesce.
     r["refreshes"] = "0";
+    r["overflows"] = "0";
+    r["coalesced"] = "0";
+    r["events_per_second"] = "0";
 
     auto subref = EventFactory::getEventSubscriber(subscriber);
     if (subref != nullptr) {
@@ -173,6 +188,38 @@ QueryData genOsqueryRegistry(QueryContext& context) {
   return results;
 }
 
+void genExtensionCallStats(const std::string& path, Row& r) {
+  ExtensionCallStats stats;
+  getExtensionCallStats(path, stats);
+  r["calls"] = BIGINT(stats.calls);
+  r["failures"] = BIGINT(stats.failures);
+  r["reconnects"] = BIGINT(stats.reconnects);
+  r["connections"] = INTEGER(stats.idle);
+  r["latency_p50"] = BIGINT(stats.percentile(0.5));
+  r["latency_p99"] = BIGINT(stats.percentile(0.99));
+
+  std::vector<std::string> buckets;
+  for (size_t i = 0; i < stats.latency.size(); i++) {
+    if (stats.latency[i] == 0) {
+      continue;
+    }
+    // The last bucket has no upper bound.
+    auto bound = (i < kExtensionLatencyBuckets.size())
+                     ? std::to_string(kExtensionLatencyBuckets[i])
+                     : "inf";
+    buckets.push_back(bound + ":" + std::to_string(stats.latency[i]));
+  }
+  r["latency_histogram"] = osquery::join(buckets, ",");
+}
+
+void genExtensionServerStats(const ExtensionServerStats& stats, Row& r) {
+  r["requests"] = BIGINT(stats.requests);
+  r["throttled"] = BIGINT(stats.throttled);
+  r["queue_wait"] =
+      BIGINT((stats.requests == 0) ? 0 : stats.wait / stats.requests);
+  r["queue_max"] = INTEGER(stats.max_queued);
+}
+
 QueryData genOsqueryExtensions(QueryContext& context) {
   QueryData results;
 
@@ -186,6 +233,11 @@ QueryData genOsqueryExtensions(QueryContext& context) {
       r["sdk_version"] = extension.second.sdk_version;
       r["path"] = getExtensionSocket(extension.first);
       r["type"] = (extension.first == 0) ? "core" : "extension";
+      genExtensionCallStats(r["path"], r);
+
+      ExtensionServerStats server_stats;
+      getExtensionServerStats(extension.first, server_stats);
+      genExtensionServerStats(server_stats, r);
       results.push_back(r);
     }
   }
@@ -199,6 +251,8 @@ QueryData genOsqueryExtensions(QueryContext& context) {
     r["sdk_version"] = module.second.sdk_version;
     r["path"] = module.second.path;
     r["type"] = "module";
+    genExtensionCallStats("", r);
+    genExtensionServerStats(ExtensionServerStats(), r);
     results.push_back(r);
   }
 
@@ -265,5 +319,66 @@ QueryData genOsquerySchedule(QueryContext& context) {
       });
   return results;
 }
+
+QueryData genOsqueryDecorators(QueryContext& context) {
+  QueryData results;
+  for (const auto& performance : getDecoratorPerformance()) {
+    Row r;
+    r["source"] = SQL_TEXT(performance.source);
+    r["type"] = SQL_TEXT(kDecorationPointKeys.at(performance.point));
+    r["query"] = SQL_TEXT(performance.query);
+    r["executions"] = BIGINT(performance.executions);
+    r["last_executed"] = BIGINT(performance.last_executed);
+    r["wall_time"] = BIGINT(performance.wall_time);
+    results.push_back(r);
+  }
+  return results;
+}
+
+QueryData genOsqueryRocksDBStats(QueryContext& context) {
+  QueryData results;
+  if (Registry::getActive("database") == "rocksdb") {
+    getDatabaseStats(results);
+  }
+  return results;
+}
+
+QueryData genOsqueryQueryProfile(QueryContext& context) {
+  QueryData results;
+  for (const auto& profile : QueryProfiler::history()) {
+    Row r;
+    r["id"] = BIGINT(profile.id);
+    r["name"] = SQL_TEXT(profile.name);
+    r["query"] = SQL_TEXT(profile.query);
+    r["time"] = BIGINT(profile.time);
+    r["wall_time"] = BIGINT(profile.wall_time);
+    r["rows_returned"] = BIGINT(profile.rows);
+    r["serialize_time"] = BIGINT(profile.serialize_time);
+    r["diff_time"] = BIGINT(profile.diff_time);
+    r["log_time"] = BIGINT(profile.log_time);
+
+    // Each execution has a row for every table it scanned.
+    r["table_name"] = "";
+    r["filters"] = "0";
+    r["rows_generated"] = "0";
+    r["filter_time"] = "0";
+    r["constraints"] = "";
+    if (profile.tables.empty()) {
+      results.push_back(r);
+    }
+
+    for (const auto& table : profile.tables) {
+      r["table_name"] = SQL_TEXT(table.table);
+      r["filters"] = BIGINT(table.filters);
+      r["rows_generated"] = BIGINT(table.rows);
+      r["filter_time"] = BIGINT(table.time);
+      std::vector<std::string> constraints(table.constraints.begin(),
+                                           table.constraints.end());
+      r["constraints"] = SQL_TEXT(osquery::join(constraints, ", "));
+      results.push_back(r);
+    }
+  }
+  return results;
+}
 }
 }
@@ -93,6 +93,7 @@ TABLE_ATTRIBUTES = {
     "cacheable": "CACHEABLE",
     "utility": "UTILITY",
     "kernel_required": "KERNEL_REQUIRED",
+    "volatile": "VOLATILE",
 }
 
 